@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as 
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+// Forwarding table lookup benchmark
+//
+// Compares looking up the destinations of a batch of packets one by one,
+// as LookupRoute does per packet, with ForwardingTable::LookupBatch, for
+// tables of different sizes. Both must return the same entries.
+//
+// ./waf --run "eslr-forwarding-bench --sizes=16,64,10000 --batch=32 --batches=100000"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/eslr-module.h"
+#include "ns3/system-wall-clock-ms.h"
+
+using namespace ns3;
+using namespace ns3::eslr;
+
+NS_LOG_COMPONENT_DEFINE ("ESLRForwardingBench");
+
+static void
+RunBenchmark (uint32_t nPrefixes, uint32_t batchSize, uint32_t nBatches, bool directIndex)
+{
+  ForwardingTable table;
+  Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+
+  // /24 and /30 prefixes, as assigned in the examples, and a default route
+  std::vector<Ipv4Address> networks;
+  table.AddEntry (Ipv4Address::GetZero (), Ipv4Mask::GetZero (), Ipv4Address ("192.168.0.1"), 1, 1);
+  for (uint32_t i = 0; i < nPrefixes; i++)
+  {
+    bool subnet = (i % 2 == 1);
+    Ipv4Address network ((10u << 24) | (i << (subnet ? 2 : 8)));
+    Ipv4Mask mask (subnet ? "255.255.255.252" : "255.255.255.0");
+    table.AddEntry (network.CombineMask (mask), mask, Ipv4Address ("192.168.0.2"), 1 + i % 4, 1);
+    networks.push_back (network.CombineMask (mask));
+  }
+  table.EnableDirectIndex (directIndex);
+
+  std::vector<Ipv4Address> destinations (batchSize * 64);
+  for (uint32_t i = 0; i < destinations.size (); i++)
+  {
+    uint32_t network = networks[rng->GetInteger (0, networks.size () - 1)].Get ();
+    destinations[i] = Ipv4Address (network | rng->GetInteger (0, 3));
+  }
+
+  std::vector<const ForwardingEntry*> single (batchSize);
+  std::vector<const ForwardingEntry*> batched (batchSize);
+  uint32_t nGroups = destinations.size () / batchSize;
+  uint64_t checksum = 0;
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t b = 0; b < nBatches; b++)
+  {
+    const Ipv4Address *batch = &destinations[(b % nGroups) * batchSize];
+    for (uint32_t i = 0; i < batchSize; i++)
+    {
+      single[i] = table.Lookup (batch[i], 0);
+    }
+    checksum += (single[0] != 0);
+  }
+  int64_t singleMs = clock.End ();
+
+  clock.Start ();
+  for (uint32_t b = 0; b < nBatches; b++)
+  {
+    const Ipv4Address *batch = &destinations[(b % nGroups) * batchSize];
+    table.LookupBatch (batch, batchSize, &batched[0]);
+    checksum += (batched[0] != 0);
+  }
+  int64_t batchMs = clock.End ();
+
+  for (uint32_t g = 0; g < nGroups; g++)
+  {
+    const Ipv4Address *batch = &destinations[g * batchSize];
+    table.LookupBatch (batch, batchSize, &batched[0]);
+    for (uint32_t i = 0; i < batchSize; i++)
+    {
+      NS_ABORT_MSG_UNLESS (table.Lookup (batch[i], 0) == batched[i], "The lookups do not agree");
+    }
+  }
+
+  std::cout << nPrefixes << " prefixes" << (directIndex ? " (direct index)" : "") << ", " 
+            << nBatches << " batches of " << batchSize << ": "
+            << "per packet " << singleMs << " ms, "
+            << "batched " << batchMs << " ms"
+            << " [" << checksum << "]" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string sizes = "16,64,10000";
+  uint32_t batchSize = 32;
+  uint32_t nBatches = 100000;
+  bool directIndex = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "Comma separated numbers of prefixes", sizes);
+  cmd.AddValue ("batch", "Number of destinations per batch", batchSize);
+  cmd.AddValue ("batches", "Number of batches", nBatches);
+  cmd.AddValue ("directIndex", "Use the direct index of the forwarding table", directIndex);
+  cmd.Parse (argc, argv);
+
+  std::istringstream sizeList (sizes);
+  std::string size;
+  while (std::getline (sizeList, size, ','))
+  {
+    RunBenchmark (std::atoi (size.c_str ()), batchSize, nBatches, directIndex);
+  }
+  return 0;
+}
@@ -0,0 +1,270 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#include <algorithm>
+
+#include "eslr-control-pacer.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/udp-header.h"
+
+NS_LOG_COMPONENT_DEFINE ("ESLRControlPacer");
+
+namespace ns3 {
+namespace eslr {
+
+std::ostream & operator << (std::ostream &os, const PacerStatistics &statistics)
+{
+  os << "queued " << statistics.queueDepth <<
+        " (max " << statistics.maxQueueDepth << ")" <<
+        " sent " << statistics.sent <<
+        " delayed " << statistics.delayed <<
+        " dropped " << statistics.drops;
+  return os;
+}
+
+ControlPacer::ControlPacer () : m_rate (DataRate (0)),
+                                m_burst (0),
+                                m_maxQueueSize (0)
+{
+  /*cstrctr*/
+}
+
+ControlPacer::~ControlPacer ()
+{
+  Clear ();
+}
+
+void
+ControlPacer::SetRate (DataRate rate)
+{
+  NS_LOG_FUNCTION (this << rate);
+
+  for (Pacers::iterator it = m_pacers.begin (); it != m_pacers.end (); it++)
+  {
+    Refill (it->second);
+  }
+  m_rate = rate;
+}
+
+void
+ControlPacer::SetBurst (uint32_t burst)
+{
+  NS_LOG_FUNCTION (this << burst);
+
+  m_burst = burst;
+  for (Pacers::iterator it = m_pacers.begin (); it != m_pacers.end (); it++)
+  {
+    it->second.tokens = std::min<double> (it->second.tokens, m_burst);
+  }
+}
+
+void
+ControlPacer::Send (uint32_t interface,
+                    Ptr<Socket> socket,
+                    Ptr<Packet> packet,
+                    Ipv4Address destination,
+                    uint16_t port,
+                    bool urgent)
+{
+  NS_LOG_FUNCTION (this << interface << packet << destination << port << urgent);
+
+  if (m_rate.GetBitRate () == 0)
+  {
+    socket->SendTo (packet, 0, InetSocketAddress (destination, port));
+    return;
+  }
+
+  InterfacePacer &pacer = GetPacer (interface);
+  Refill (pacer);
+
+  QueuedPacket queued;
+  queued.socket = socket;
+  queued.packet = packet->Copy ();
+  queued.destination = destination;
+  queued.port = port;
+
+  // an urgent packet only waits behind the other urgent packets
+  bool waiting = urgent ? !pacer.urgent.empty () : (!pacer.urgent.empty () || !pacer.normal.empty ());
+  if (!waiting && HasTokens (pacer, GetCost (packet)))
+  {
+    Transmit (pacer, queued);
+    return;
+  }
+
+  if (pacer.urgent.size () + pacer.normal.size () >= m_maxQueueSize)
+  {
+    if (!urgent || pacer.normal.empty ())
+    {
+      Drop (interface, pacer, packet);
+      return;
+    }
+    Ptr<Packet> replaced = pacer.normal.back ().packet;
+    pacer.normal.pop_back ();
+    Drop (interface, pacer, replaced);
+  }
+
+  if (urgent)
+    pacer.urgent.push_back (queued);
+  else
+    pacer.normal.push_back (queued);
+
+  pacer.statistics.delayed++;
+  pacer.statistics.queueDepth = pacer.urgent.size () + pacer.normal.size ();
+  pacer.statistics.maxQueueDepth = std::max (pacer.statistics.maxQueueDepth, pacer.statistics.queueDepth);
+  NS_LOG_LOGIC ("ESLR: " << pacer.statistics.queueDepth << " control packets wait on " << interface);
+
+  ScheduleRelease (interface, pacer);
+}
+
+PacerStatistics
+ControlPacer::GetStatistics (uint32_t interface) const
+{
+  Pacers::const_iterator it = m_pacers.find (interface);
+  return (it == m_pacers.end ()) ? PacerStatistics () : it->second.statistics;
+}
+
+uint32_t
+ControlPacer::GetQueueDepth (uint32_t interface) const
+{
+  return GetStatistics (interface).queueDepth;
+}
+
+uint64_t
+ControlPacer::GetDrops (uint32_t interface) const
+{
+  return GetStatistics (interface).drops;
+}
+
+void
+ControlPacer::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (Pacers::iterator it = m_pacers.begin (); it != m_pacers.end (); it++)
+  {
+    it->second.release.Cancel ();
+  }
+  m_pacers.clear ();
+}
+
+ControlPacer::InterfacePacer&
+ControlPacer::GetPacer (uint32_t interface)
+{
+  Pacers::iterator it = m_pacers.find (interface);
+  if (it == m_pacers.end ())
+  {
+    it = m_pacers.insert (std::make_pair (interface, InterfacePacer ())).first;
+    it->second.tokens = m_burst;
+    it->second.lastUpdate = Simulator::Now ();
+  }
+  return it->second;
+}
+
+void
+ControlPacer::Refill (InterfacePacer &pacer) const
+{
+  Time now = Simulator::Now ();
+  double elapsed = (now - pacer.lastUpdate).GetSeconds ();
+  pacer.tokens = std::min<double> (m_burst, pacer.tokens + elapsed * m_rate.GetBitRate () / 8.0);
+  pacer.lastUpdate = now;
+}
+
+uint32_t
+ControlPacer::GetCost (Ptr<const Packet> packet) const
+{
+  return packet->GetSize () + Ipv4Header ().GetSerializedSize () + UdpHeader ().GetSerializedSize ();
+}
+
+bool
+ControlPacer::HasTokens (const InterfacePacer &pacer, uint32_t cost) const
+{
+  // the pacing was disabled while the packets were waiting
+  if (m_rate.GetBitRate () == 0)
+    return true;
+  return pacer.tokens >= std::min (cost, m_burst);
+}
+
+void
+ControlPacer::Release (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+
+  Pacers::iterator it = m_pacers.find (interface);
+  if (it == m_pacers.end ())
+    return;
+
+  InterfacePacer &pacer = it->second;
+  Refill (pacer);
+
+  while (!pacer.urgent.empty () || !pacer.normal.empty ())
+  {
+    std::deque<QueuedPacket> &queue = pacer.urgent.empty () ? pacer.normal : pacer.urgent;
+    if (!HasTokens (pacer, GetCost (queue.front ().packet)))
+      break;
+
+    QueuedPacket queued = queue.front ();
+    queue.pop_front ();
+    Transmit (pacer, queued);
+  }
+  pacer.statistics.queueDepth = pacer.urgent.size () + pacer.normal.size ();
+
+  ScheduleRelease (interface, pacer);
+}
+
+void
+ControlPacer::ScheduleRelease (uint32_t interface, InterfacePacer &pacer)
+{
+  if (pacer.release.IsRunning () || (pacer.urgent.empty () && pacer.normal.empty ()))
+    return;
+
+  const QueuedPacket &head = pacer.urgent.empty () ? pacer.normal.front () : pacer.urgent.front ();
+  double missing = std::min (GetCost (head.packet), m_burst) - pacer.tokens;
+  Time delay = Seconds (0);
+  if (m_rate.GetBitRate () > 0)
+    delay = Seconds (std::max (missing, 0.0) * 8.0 / m_rate.GetBitRate ());
+
+  // one more nanosecond, so that the rounding of the delay never leaves the bucket short
+  pacer.release = Simulator::Schedule (delay + NanoSeconds (1), &ControlPacer::Release, this, interface);
+}
+
+void
+ControlPacer::Transmit (InterfacePacer &pacer, const QueuedPacket &queued)
+{
+  pacer.tokens -= GetCost (queued.packet);
+  pacer.statistics.sent++;
+  queued.socket->SendTo (queued.packet, 0, InetSocketAddress (queued.destination, queued.port));
+}
+
+void
+ControlPacer::Drop (uint32_t interface, InterfacePacer &pacer, Ptr<const Packet> packet)
+{
+  NS_LOG_LOGIC ("ESLR: control packet queue of " << interface << " is full, drop " << *packet);
+
+  pacer.statistics.drops++;
+  if (!m_drop.IsNull ())
+    m_drop (packet, interface);
+}
+
+} // end of eslr namespace
+} // end of ns3 namespace
@@ -0,0 +1,279 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#ifndef ESLR_CONTROL_PACER_H
+#define ESLR_CONTROL_PACER_H
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <stdint.h>
+
+#include "ns3/callback.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/socket.h"
+
+namespace ns3 {
+namespace eslr {
+
+/**
+ * \brief Counters of the control packets paced on an interface.
+ */
+struct PacerStatistics
+{
+  PacerStatistics () : queueDepth (0),
+                       maxQueueDepth (0),
+                       sent (0),
+                       delayed (0),
+                       drops (0)
+  {
+    /*cstrctr*/
+  }
+
+  uint32_t queueDepth; //!< number of packets waiting for tokens
+  uint32_t maxQueueDepth; //!< largest number of packets that waited at once
+  uint64_t sent; //!< number of packets handed to the socket
+  uint64_t delayed; //!< number of packets that waited for tokens
+  uint64_t drops; //!< number of packets dropped as the queue was full
+};
+
+/**
+ * \brief Stream insertion operator.
+ *
+ * \param os the reference to the output stream
+ * \param statistics the pacer counters
+ * \returns the reference to the output stream
+ */
+std::ostream & operator << (std::ostream &os, const PacerStatistics &statistics);
+
+/**
+ * \brief Token-bucket pacer of the ESLR control packets.
+ *
+ * During large failures, fast-triggered updates, route pulls and triggered
+ * updates can all be sent at the same instant. The pacer keeps a token
+ * bucket per interface, filled at the configured rate up to the burst size,
+ * and releases the packets of an interface only when the bucket holds
+ * their size (with the IP and UDP headers). The packets that find no tokens
+ * wait in a queue of the interface. The urgent packets (fast-triggered
+ * updates) are released before, and may overtake, the other packets.
+ *
+ * A packet larger than the burst is released when the bucket is full, and
+ * leaves the bucket in deficit. A zero rate disables the pacing, and the
+ * packets are sent right away.
+ */
+class ControlPacer
+{
+public:
+  /// Callback invoked with a dropped packet and its interface
+  typedef Callback<void, Ptr<const Packet>, uint32_t> DropCallback;
+
+  ControlPacer ();
+  ~ControlPacer ();
+
+  /**
+   * \brief Set and Get the rate the buckets are filled at
+   * \param rate the rate (zero disables the pacing)
+   * \returns the rate
+   */
+  void SetRate (DataRate rate);
+  DataRate GetRate (void) const
+  {
+    return m_rate;
+  }
+
+  /**
+   * \brief Set and Get the size of the buckets
+   * \param burst the size, in bytes
+   * \returns the size, in bytes
+   */
+  void SetBurst (uint32_t burst);
+  uint32_t GetBurst (void) const
+  {
+    return m_burst;
+  }
+
+  /**
+   * \brief Set and Get the largest number of packets waiting on an interface
+   * \param maxQueueSize the number of packets
+   * \returns the number of packets
+   */
+  void SetMaxQueueSize (uint32_t maxQueueSize)
+  {
+    m_maxQueueSize = maxQueueSize;
+  }
+  uint32_t GetMaxQueueSize (void) const
+  {
+    return m_maxQueueSize;
+  }
+
+  /**
+   * \brief Set the callback invoked for each dropped packet
+   * \param drop the callback
+   */
+  void SetDropCallback (DropCallback drop)
+  {
+    m_drop = drop;
+  }
+
+  /**
+   * \brief Send a control packet, now or when the bucket of the interface holds its size.
+   * If the queue of the interface is full, an urgent packet replaces the latest
+   * waiting packet that is not urgent. Otherwise, the packet is dropped.
+   * \param interface the interface the packet is sent on
+   * \param socket the socket to send the packet with
+   * \param packet the packet (a copy is queued, the caller can keep using it)
+   * \param destination the destination address
+   * \param port the destination port
+   * \param urgent the packet is a fast-triggered update
+   */
+  void Send (uint32_t interface,
+             Ptr<Socket> socket,
+             Ptr<Packet> packet,
+             Ipv4Address destination,
+             uint16_t port,
+             bool urgent);
+
+  /**
+   * \brief Get the counters of an interface
+   * \param interface the interface
+   * \returns the counters (all zero if nothing was paced on the interface)
+   */
+  PacerStatistics GetStatistics (uint32_t interface) const;
+
+  /**
+   * \brief Get the number of packets waiting on an interface
+   * \param interface the interface
+   * \returns the number of packets
+   */
+  uint32_t GetQueueDepth (uint32_t interface) const;
+
+  /**
+   * \brief Get the number of packets dropped on an interface
+   * \param interface the interface
+   * \returns the number of packets
+   */
+  uint64_t GetDrops (uint32_t interface) const;
+
+  /**
+   * \brief Discard the waiting packets of all interfaces and cancel the releases.
+   * The discarded packets are not counted as drops.
+   */
+  void Clear (void);
+
+private:
+  /// A packet waiting for tokens
+  struct QueuedPacket
+  {
+    Ptr<Socket> socket; //!< the socket to send the packet with
+    Ptr<Packet> packet; //!< the packet
+    Ipv4Address destination; //!< the destination address
+    uint16_t port; //!< the destination port
+  };
+
+  /// The token bucket and the queues of an interface
+  struct InterfacePacer
+  {
+    InterfacePacer () : tokens (0)
+    {
+      /*cstrctr*/
+    }
+
+    double tokens; //!< bytes in the bucket, negative after a packet larger than the burst
+    Time lastUpdate; //!< time the bucket was last filled
+    std::deque<QueuedPacket> urgent; //!< the waiting fast-triggered updates
+    std::deque<QueuedPacket> normal; //!< the other waiting packets
+    EventId release; //!< next release of the waiting packets
+    PacerStatistics statistics; //!< counters of the interface
+  };
+
+  /// Container of the interface pacers, by interface
+  typedef std::map<uint32_t, InterfacePacer> Pacers;
+
+  /**
+   * \brief Get the pacer of an interface, created with a full bucket.
+   * \param interface the interface
+   * \returns the pacer
+   */
+  InterfacePacer& GetPacer (uint32_t interface);
+
+  /**
+   * \brief Fill the bucket for the time elapsed since the last fill.
+   * \param pacer the interface pacer
+   */
+  void Refill (InterfacePacer &pacer) const;
+
+  /**
+   * \brief Get the number of tokens a packet needs.
+   * \param packet the packet
+   * \returns the size of the packet with the IP and UDP headers
+   */
+  uint32_t GetCost (Ptr<const Packet> packet) const;
+
+  /**
+   * \brief Check whether the bucket holds enough tokens for a packet.
+   * \param pacer the interface pacer
+   * \param cost the tokens the packet needs
+   * \returns true if the packet can be sent
+   */
+  bool HasTokens (const InterfacePacer &pacer, uint32_t cost) const;
+
+  /**
+   * \brief Send the waiting packets of an interface that the bucket holds tokens for.
+   * \param interface the interface
+   */
+  void Release (uint32_t interface);
+
+  /**
+   * \brief Schedule the release of the first waiting packet of an interface.
+   * \param interface the interface
+   * \param pacer the interface pacer
+   */
+  void ScheduleRelease (uint32_t interface, InterfacePacer &pacer);
+
+  /**
+   * \brief Take the tokens of a packet and send it.
+   * \param pacer the interface pacer
+   * \param queued the packet
+   */
+  void Transmit (InterfacePacer &pacer, const QueuedPacket &queued);
+
+  /**
+   * \brief Count a dropped packet and report it.
+   * \param interface the interface
+   * \param pacer the interface pacer
+   * \param packet the packet
+   */
+  void Drop (uint32_t interface, InterfacePacer &pacer, Ptr<const Packet> packet);
+
+  Pacers m_pacers; //!< the interface pacers
+  DataRate m_rate; //!< rate the buckets are filled at (zero disables the pacing)
+  uint32_t m_burst; //!< size of the buckets, in bytes
+  uint32_t m_maxQueueSize; //!< largest number of packets waiting on an interface
+  DropCallback m_drop; //!< invoked for each dropped packet
+};
+
+} // end of eslr namespace
+} // end of ns3 namespace
+#endif /* ESLR_CONTROL_PACER_H */
@@ -32,6 +32,12 @@ namespace eslr {
   #define KAM_SIZE 15 //!< Keep-alive Message (KAM) Size
   #define SRCH_SIZE 20 //!< Server-router Communication (SRC) Size
   #define ESLR_BASE_SIZE 8 //!< ESLR Header Base Size
+  #define ESLR_SEQUENCE_SIZE 8 //!< Size of the update sequence block of the sequenced updates
+  #define ESLR_NOE_SIZE 2 //!< Size of the 16 bit NoE field of the version 2 ESLR header
+  #define ESLR_VERSION 2 //!< Version of the ESLR header sent by this implementation
+  #define ESLR_BASE_SEQUENCE_SIZE 2 //!< Size of the base sequence number of the compact RUMs
+  #define COMPACT_RUM_MAX_SIZE 18 //!< Largest compact RUM (a non-contiguous mask, the largest metric and sequence delta)
+  #define COMPACT_RUM_FULL_MASK 0xff //!< Prefix length of a compact RUM that carries the whole mask and address
 
 /**
  * Authentication types used in route management
@@ -51,6 +57,14 @@ namespace eslr {
 		HI = 0x02,
   };
 
+/**
+ * Capabilities advertised in the high bits of the KAM command
+ */
+  enum KamCapability
+  {
+    COMPACT_RUMS = 0x10, //!< The router decodes the compact RUMs
+  };
+
 /**
  * Commands used in ESLR Routing Header
  */
@@ -69,6 +83,8 @@ namespace eslr {
     NO = 0x00, //!< No. This is set when ESLR header carries KAM and SRC messages
     REQUEST = 0x01, //!< ESLR request message
     RESPONSE = 0x02, //!< ESLR response message
+    ACKNOWLEDGE = 0x03, //!< Acknowledge a sequenced periodic update
+    RESYNC = 0x04, //!< Ask for a full periodic update, as the kept advertisements diverged
   };
 
 /**
@@ -154,6 +170,14 @@ enum PrintingOption {
   N_TABLE, //!< Print the neighbor table
 };
 
+/**
+ * Forwarding table lookup methods.
+ */
+enum ForwardingLookupType {
+  TRIE_LOOKUP, //!< Longest prefix match on the prefix trie (Default state)
+  DIRECT_INDEX_LOOKUP, //!< DIR-24-8 direct index, constant time lookups for 64 MB or more per node
+};
+
 } // end of eslr namespace
 } // end of ns3 namespace
 #endif /* DEFINITION */
@@ -0,0 +1,171 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#include "eslr-direct-index.h"
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+
+NS_LOG_COMPONENT_DEFINE ("ESLRDirectIndex");
+
+namespace ns3 {
+namespace eslr {
+
+/// Number of first level slots
+static const uint32_t TBL24_SIZE = 1 << 24;
+/// Number of slots of a second level group
+static const uint32_t GROUP_SIZE = 256;
+
+DirectIndex::DirectIndex ()
+{
+  /*cstrctr*/
+}
+
+DirectIndex::~DirectIndex ()
+{
+  /*dstrctr*/
+}
+
+void
+DirectIndex::Allocate (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_tbl24.assign (TBL24_SIZE, MakeSlot (0, 0));
+  m_tbl8.clear ();
+}
+
+void
+DirectIndex::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> ().swap (m_tbl24);
+  std::vector<uint32_t> ().swap (m_tbl8);
+}
+
+uint32_t
+DirectIndex::GetGroup (uint32_t index)
+{
+  uint32_t slot = m_tbl24[index];
+  if (slot & GROUP_FLAG)
+    return (slot & ID_MASK) << 8;
+
+  // the group starts with the prefix of the /24 in all of its slots
+  uint32_t group = m_tbl8.size () >> 8;
+  NS_ABORT_MSG_IF (group > ID_MASK, "ESLR: DirectIndex - too many groups");
+  m_tbl8.insert (m_tbl8.end (), GROUP_SIZE, slot);
+  m_tbl24[index] = GROUP_FLAG | group;
+  return group << 8;
+}
+
+void
+DirectIndex::Insert (Ipv4Address network, uint8_t length, uint32_t id)
+{
+  NS_LOG_FUNCTION (this << network << int (length) << id);
+  NS_ASSERT (IsAllocated ());
+  NS_ASSERT (length <= 32 && id <= MAX_ID);
+
+  uint32_t address = network.Get ();
+  uint32_t value = MakeSlot (id, length);
+
+  if (length <= 24)
+  {
+    uint32_t first = (length == 0) ? 0 : ((address >> 8) & ~((TBL24_SIZE >> length) - 1));
+    uint32_t count = TBL24_SIZE >> length;
+    for (uint32_t index = first; index < first + count; index++)
+    {
+      uint32_t &slot = m_tbl24[index];
+      if (slot & GROUP_FLAG)
+      {
+        uint32_t group = (slot & ID_MASK) << 8;
+        for (uint32_t i = group; i < group + GROUP_SIZE; i++)
+        {
+          if (GetLength (m_tbl8[i]) <= length)
+            m_tbl8[i] = value;
+        }
+      }
+      else if (GetLength (slot) <= length)
+        slot = value;
+    }
+  }
+  else
+  {
+    uint32_t group = GetGroup (address >> 8);
+    uint32_t count = 1 << (32 - length);
+    uint32_t first = group + ((address & 0xff) & ~(count - 1));
+    for (uint32_t i = first; i < first + count; i++)
+    {
+      if (GetLength (m_tbl8[i]) <= length)
+        m_tbl8[i] = value;
+    }
+  }
+}
+
+void
+DirectIndex::Remove (Ipv4Address network, uint8_t length, uint32_t id, uint32_t coverId, uint8_t coverLength)
+{
+  NS_LOG_FUNCTION (this << network << int (length) << id << coverId << int (coverLength));
+  NS_ASSERT (IsAllocated ());
+  NS_ASSERT (coverLength < length || (coverId == 0 && coverLength == 0));
+
+  uint32_t address = network.Get ();
+  uint32_t removed = MakeSlot (id, length);
+  uint32_t value = MakeSlot (coverId, coverLength);
+
+  // only the slots that still refer to the removed prefix are rewritten,
+  // the slots of longer prefixes are kept.
+  if (length <= 24)
+  {
+    uint32_t first = (length == 0) ? 0 : ((address >> 8) & ~((TBL24_SIZE >> length) - 1));
+    uint32_t count = TBL24_SIZE >> length;
+    for (uint32_t index = first; index < first + count; index++)
+    {
+      uint32_t &slot = m_tbl24[index];
+      if (slot & GROUP_FLAG)
+      {
+        uint32_t group = (slot & ID_MASK) << 8;
+        for (uint32_t i = group; i < group + GROUP_SIZE; i++)
+        {
+          if (m_tbl8[i] == removed)
+            m_tbl8[i] = value;
+        }
+      }
+      else if (slot == removed)
+        slot = value;
+    }
+  }
+  else
+  {
+    uint32_t slot = m_tbl24[address >> 8];
+    if (!(slot & GROUP_FLAG))
+      return;
+    uint32_t group = (slot & ID_MASK) << 8;
+    uint32_t count = 1 << (32 - length);
+    uint32_t first = group + ((address & 0xff) & ~(count - 1));
+    for (uint32_t i = first; i < first + count; i++)
+    {
+      if (m_tbl8[i] == removed)
+        m_tbl8[i] = value;
+    }
+  }
+}
+
+}// end of namespace eslr
+}// end of namespace ns3
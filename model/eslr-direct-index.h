@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#ifndef ESLR_DIRECT_INDEX_H
+#define ESLR_DIRECT_INDEX_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+namespace eslr {
+
+/**
+ * \brief A DIR-24-8 style direct index of IPv4 prefixes.
+ *
+ * The index maps each address to the identifier of the longest prefix that
+ * covers it, with at most two array reads. The first level has one slot per
+ * /24 (2^24 slots). A slot either holds the identifier of the longest prefix
+ * of at most 24 bits that covers the /24, or refers to a second level group
+ * of 256 slots, one per address of the /24, which is created when a prefix
+ * longer than 24 bits is added in the /24.
+ *
+ * Each slot keeps the length of its prefix as well, so that prefixes are
+ * added and removed by rewriting only the slots they cover.
+ *
+ * The first level takes 64 MB, and each group 1 KB. The memory is only
+ * allocated when the index is enabled.
+ *
+ * Identifiers are given by the user. The identifier 0 means no prefix,
+ * and identifiers have to be smaller than 2^24.
+ */
+class DirectIndex
+{
+public:
+  /// The largest identifier that can be stored
+  static const uint32_t MAX_ID = 0x00ffffff;
+
+  DirectIndex ();
+  ~DirectIndex ();
+
+  /**
+   * \brief Allocate the first level. All addresses map to no prefix.
+   */
+  void Allocate (void);
+
+  /**
+   * \brief Release the memory of the index.
+   */
+  void Clear (void);
+
+  /**
+   * \returns true if the index is allocated
+   */
+  bool IsAllocated (void) const
+  {
+    return !m_tbl24.empty ();
+  }
+
+  /**
+   * \brief Add a prefix. The slots covered by the prefix and not covered
+   * by a longer prefix are set to the prefix.
+   * \param network the network address of the prefix
+   * \param length the prefix length
+   * \param id the identifier of the prefix
+   */
+  void Insert (Ipv4Address network, uint8_t length, uint32_t id);
+
+  /**
+   * \brief Remove a prefix. The slots that refer to the prefix are set to
+   * the given covering prefix.
+   * \param network the network address of the prefix
+   * \param length the prefix length
+   * \param id the identifier of the prefix
+   * \param coverId the identifier of the longest prefix that covers the removed prefix (0 if none)
+   * \param coverLength the length of the covering prefix
+   */
+  void Remove (Ipv4Address network, uint8_t length, uint32_t id, uint32_t coverId, uint8_t coverLength);
+
+  /**
+   * \brief Return the identifier of the longest prefix that covers an address.
+   * \param destination the address
+   * \returns the identifier, 0 if no prefix covers the address
+   */
+  uint32_t Lookup (Ipv4Address destination) const
+  {
+    uint32_t address = destination.Get ();
+    uint32_t slot = m_tbl24[address >> 8];
+    if (slot & GROUP_FLAG)
+      slot = m_tbl8[((slot & ID_MASK) << 8) | (address & 0xff)];
+    return slot & ID_MASK;
+  }
+
+  /**
+   * \returns the number of second level groups
+   */
+  uint32_t GetNGroups (void) const
+  {
+    return m_tbl8.size () >> 8;
+  }
+
+  /**
+   * \returns the memory used by the index, in bytes
+   */
+  uint64_t GetMemorySize (void) const
+  {
+    return uint64_t (m_tbl24.capacity () + m_tbl8.capacity ()) * sizeof (uint32_t);
+  }
+
+private:
+  /// The slot refers to a second level group
+  static const uint32_t GROUP_FLAG = 0x80000000;
+  /// Bits of the prefix identifier or the group index
+  static const uint32_t ID_MASK = 0x00ffffff;
+  /// Position of the prefix length
+  static const uint32_t LENGTH_SHIFT = 24;
+  /// Bits of the prefix length, after shifting
+  static const uint32_t LENGTH_MASK = 0x3f;
+
+  /**
+   * \brief Build a slot value.
+   * \param id the prefix identifier
+   * \param length the prefix length
+   * \returns the slot value
+   */
+  static uint32_t MakeSlot (uint32_t id, uint8_t length)
+  {
+    return (uint32_t (length) << LENGTH_SHIFT) | id;
+  }
+
+  /**
+   * \brief Return the prefix length of a slot value.
+   * \param slot the slot value
+   * \returns the prefix length
+   */
+  static uint8_t GetLength (uint32_t slot)
+  {
+    return (slot >> LENGTH_SHIFT) & LENGTH_MASK;
+  }
+
+  /**
+   * \brief Return the second level group of a first level slot, create it if needed.
+   * \param index the first level slot
+   * \returns the first second level slot of the group
+   */
+  uint32_t GetGroup (uint32_t index);
+
+  std::vector<uint32_t> m_tbl24; //!< first level, one slot per /24
+  std::vector<uint32_t> m_tbl8; //!< second level groups, 256 slots each
+}; // end of class DirectIndex
+
+}// end of namespace eslr
+}// end of namespace ns3
+#endif /* ESLR_DIRECT_INDEX_H */
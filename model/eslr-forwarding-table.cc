@@ -0,0 +1,476 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#include <algorithm>
+
+#include "eslr-forwarding-table.h"
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+NS_LOG_COMPONENT_DEFINE ("ESLRForwardingTable");
+
+namespace ns3 {
+namespace eslr {
+
+/**
+ * \brief Predicate used to select a forwarding entry from the prefix trie.
+ * An entry is accepted if no net-device is given, or if the entry uses
+ * the given net-device.
+ */
+struct ForwardingEntrySelector
+{
+  ForwardingEntrySelector (Ptr<NetDevice> dev) : m_dev (dev)
+  {
+    /*cstrctr*/
+  }
+
+  bool operator() (const std::list<ForwardingEntry>::iterator &it) const
+  {
+    return ((!m_dev) || (m_dev == it->device));
+  }
+
+  Ptr<NetDevice> m_dev; //!< the reference net-device (can be zero)
+};
+
+/// Largest number of prefixes matched with the linear batch scan
+static const uint32_t MAX_SCAN_PREFIXES = 64;
+
+/// Sort the prefixes from the longest to the shortest, keeping the order of equal lengths
+static bool
+IsLongerMask (const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b)
+{
+  return a.first > b.first;
+}
+
+ForwardingTable::ForwardingTable () : m_generation (0),
+                                      m_scanGeneration (0),
+                                      m_scanValid (false)
+{
+  /*cstrctr*/
+}
+
+ForwardingTable::~ForwardingTable ()
+{
+  /*dstrctr*/
+}
+
+void
+ForwardingTable::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  m_ipv4 = ipv4;
+  Refresh ();
+}
+
+void
+ForwardingTable::AddEntry (Ipv4Address destination,
+    Ipv4Mask mask,
+    Ipv4Address gateway,
+    uint32_t interface,
+    uint32_t metric)
+{
+  NS_LOG_FUNCTION (this << destination << mask << gateway << interface << metric);
+
+  ForwardingEntry entry;
+  entry.destination = destination;
+  entry.mask = mask;
+  entry.gateway = gateway;
+  entry.interface = interface;
+  entry.metric = metric;
+  entry.backupGateway = Ipv4Address::GetZero ();
+  entry.backupInterface = 0;
+  entry.backupMetric = 0;
+  Resolve (entry);
+
+  Entries::iterator it = m_entries.insert (m_entries.end (), entry);
+  m_trie.Insert (destination.CombineMask (mask), mask, it, false);
+  m_generation++;
+
+  if (IsDirectIndexEnabled ())
+    SyncDirectIndex (destination.CombineMask (mask), mask);
+}
+
+void
+ForwardingTable::RemoveEntries (Ipv4Address destination, Ipv4Mask mask)
+{
+  NS_LOG_FUNCTION (this << destination << mask);
+
+  Ipv4Address prefix = destination.CombineMask (mask);
+  const PrefixTrie<Entries::iterator>::ValueList *values = m_trie.Find (prefix, mask);
+  if (values == 0)
+    return;
+
+  // the list of the prefix is changed while removing
+  PrefixTrie<Entries::iterator>::ValueList entries (*values);
+  for (PrefixTrie<Entries::iterator>::ValueList::iterator it = entries.begin (); it != entries.end (); it++)
+  {
+    if ((*it)->destination != destination)
+      continue;
+    m_trie.Remove (prefix, mask, *it);
+    m_entries.erase (*it);
+    m_generation++;
+  }
+
+  if (IsDirectIndexEnabled ())
+    SyncDirectIndex (prefix, mask);
+}
+
+void
+ForwardingTable::SetBackup (Ipv4Address destination,
+    Ipv4Mask mask,
+    uint32_t metric,
+    Ipv4Address backupGateway,
+    uint32_t backupInterface,
+    uint32_t backupMetric)
+{
+  NS_LOG_FUNCTION (this << destination << mask << metric << backupGateway << backupInterface << backupMetric);
+
+  const PrefixTrie<Entries::iterator>::ValueList *values = m_trie.Find (destination.CombineMask (mask), mask);
+  if (values == 0 || values->empty ())
+    return;
+
+  // the lookups without a net-device return the first entry of the prefix
+  ForwardingEntry &entry = *values->front ();
+  entry.metric = metric;
+  entry.backupMetric = backupMetric;
+  if ((entry.backupGateway == backupGateway) && (entry.backupInterface == backupInterface))
+    return;
+
+  entry.backupGateway = backupGateway;
+  entry.backupInterface = backupInterface;
+  ResolveBackup (entry);
+}
+
+const ForwardingEntry*
+ForwardingTable::Lookup (Ipv4Address destination, Ptr<NetDevice> dev) const
+{
+  if (!dev && IsDirectIndexEnabled ())
+    return m_directEntries[m_directIndex.Lookup (destination)];
+
+  Entries::iterator it;
+  if (!m_trie.LongestMatch (destination, ForwardingEntrySelector (dev), it))
+    return 0;
+  return &(*it);
+}
+
+void
+ForwardingTable::LookupBatch (const Ipv4Address *destinations, uint32_t n, const ForwardingEntry **entries) const
+{
+  if (IsDirectIndexEnabled ())
+  {
+    for (uint32_t i = 0; i < n; i++)
+    {
+      entries[i] = m_directEntries[m_directIndex.Lookup (destinations[i])];
+    }
+    return;
+  }
+
+  UpdateScanArrays ();
+  if (m_scanNetworks.size () <= MAX_SCAN_PREFIXES)
+  {
+    ScanBatch (destinations, n, entries);
+    return;
+  }
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    entries[i] = Lookup (destinations[i], 0);
+  }
+}
+
+void
+ForwardingTable::UpdateScanArrays (void) const
+{
+  if (m_scanValid && m_scanGeneration == m_generation)
+    return;
+
+  m_scanValid = true;
+  m_scanGeneration = m_generation;
+  m_scanNetworks.clear ();
+  m_scanMasks.clear ();
+  m_scanEntries.clear ();
+
+  // the first entry of each prefix, as the trie returns it
+  std::vector<std::pair<uint32_t, uint32_t> > order;
+  std::vector<const ForwardingEntry*> firsts;
+  std::map<uint64_t, bool> seen;
+  for (Entries::const_iterator it = m_entries.begin (); it != m_entries.end (); it++)
+  {
+    Ipv4Address prefix = it->destination.CombineMask (it->mask);
+    if (!seen.insert (std::make_pair (GetPrefixKey (prefix, it->mask), true)).second)
+      continue;
+
+    const PrefixTrie<Entries::iterator>::ValueList *values = m_trie.Find (prefix, it->mask);
+    NS_ASSERT (values != 0 && !values->empty ());
+    order.push_back (std::make_pair (it->mask.Get (), firsts.size ()));
+    firsts.push_back (&(*values->front ()));
+    if (firsts.size () > MAX_SCAN_PREFIXES)
+      break;
+  }
+
+  // contiguous masks compare as their lengths
+  std::stable_sort (order.begin (), order.end (), IsLongerMask);
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator it = order.begin (); it != order.end (); it++)
+  {
+    const ForwardingEntry *entry = firsts[it->second];
+    m_scanMasks.push_back (it->first);
+    m_scanNetworks.push_back (entry->destination.Get () & it->first);
+    m_scanEntries.push_back (entry);
+  }
+}
+
+void
+ForwardingTable::ScanBatch (const Ipv4Address *destinations, uint32_t n, const ForwardingEntry **entries) const
+{
+  uint32_t nPrefixes = m_scanNetworks.size ();
+  uint32_t i = 0;
+
+#ifdef __SSE2__
+  // Four destinations are compared against each prefix at once.
+  // The prefixes are the longest first, so the first match of a lane is its longest match.
+  for (; i + 4 <= n; i += 4)
+  {
+    uint32_t addresses[4] = { destinations[i].Get (), destinations[i + 1].Get (), 
+                              destinations[i + 2].Get (), destinations[i + 3].Get () };
+    __m128i dst = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (addresses));
+    int32_t found[4] = { -1, -1, -1, -1 };
+    int pending = 0xf;
+
+    for (uint32_t p = 0; p < nPrefixes && pending; p++)
+    {
+      __m128i masked = _mm_and_si128 (dst, _mm_set1_epi32 (m_scanMasks[p]));
+      __m128i match = _mm_cmpeq_epi32 (masked, _mm_set1_epi32 (m_scanNetworks[p]));
+      int hits = _mm_movemask_ps (_mm_castsi128_ps (match)) & pending;
+      for (int lane = 0; hits; lane++, hits >>= 1)
+      {
+        if (hits & 1)
+        {
+          found[lane] = p;
+          pending &= ~(1 << lane);
+        }
+      }
+    }
+
+    for (uint32_t lane = 0; lane < 4; lane++)
+    {
+      entries[i + lane] = (found[lane] < 0) ? 0 : m_scanEntries[found[lane]];
+    }
+  }
+#endif
+
+  // the scalar fallback, also for the rest of the batch
+  for (; i < n; i++)
+  {
+    uint32_t address = destinations[i].Get ();
+    entries[i] = 0;
+    for (uint32_t p = 0; p < nPrefixes; p++)
+    {
+      if ((address & m_scanMasks[p]) == m_scanNetworks[p])
+      {
+        entries[i] = m_scanEntries[p];
+        break;
+      }
+    }
+  }
+}
+
+void
+ForwardingTable::Refresh (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (Entries::iterator it = m_entries.begin (); it != m_entries.end (); it++)
+  {
+    Resolve (*it);
+  }
+  m_generation++;
+}
+
+void
+ForwardingTable::Clear (void)
+{
+  m_trie.Clear ();
+  m_entries.clear ();
+  m_generation++;
+
+  m_directIndex.Clear ();
+  m_directIds.clear ();
+  m_directEntries.clear ();
+  m_freeDirectIds.clear ();
+}
+
+uint64_t
+ForwardingTable::GetMemorySize (void) const
+{
+  // the entries are list nodes, and each of them keeps a route
+  uint64_t bytes = uint64_t (m_entries.size ()) * (sizeof (ForwardingEntry) + 2 * sizeof (void*) + sizeof (Ipv4Route));
+  // the b-routes, kept on the first entry of their prefix
+  for (Entries::const_iterator it = m_entries.begin (); it != m_entries.end (); it++)
+  {
+    if (it->backupRoute != 0)
+      bytes += sizeof (Ipv4Route);
+  }
+  bytes += m_trie.GetMemorySize ();
+  bytes += m_directIndex.GetMemorySize ();
+  bytes += m_directIds.size () * (sizeof (std::map<uint64_t, uint32_t>::value_type) + 4 * sizeof (void*));
+  bytes += m_directEntries.capacity () * sizeof (const ForwardingEntry*);
+  bytes += m_freeDirectIds.capacity () * sizeof (uint32_t);
+  bytes += (m_scanNetworks.capacity () + m_scanMasks.capacity ()) * sizeof (uint32_t);
+  bytes += m_scanEntries.capacity () * sizeof (const ForwardingEntry*);
+  return bytes;
+}
+
+void
+ForwardingTable::EnableDirectIndex (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+
+  m_directIndex.Clear ();
+  m_directIds.clear ();
+  m_directEntries.clear ();
+  m_freeDirectIds.clear ();
+
+  if (!enable)
+    return;
+
+  m_directIndex.Allocate ();
+  m_directEntries.push_back (0); // the identifier 0 is no entry
+  for (Entries::iterator it = m_entries.begin (); it != m_entries.end (); it++)
+  {
+    SyncDirectIndex (it->destination.CombineMask (it->mask), it->mask);
+  }
+}
+
+void
+ForwardingTable::SyncDirectIndex (Ipv4Address prefix, Ipv4Mask mask)
+{
+  uint64_t key = GetPrefixKey (prefix, mask);
+  uint8_t length = mask.GetPrefixLength ();
+  std::map<uint64_t, uint32_t>::iterator id = m_directIds.find (key);
+  const PrefixTrie<Entries::iterator>::ValueList *values = m_trie.Find (prefix, mask);
+
+  if (values == 0 || values->empty ())
+  {
+    if (id == m_directIds.end ())
+      return;
+
+    // the slots of the prefix go to the longest prefix that covers it
+    uint32_t coverId = 0;
+    uint8_t coverLength = 0;
+    for (int coverLen = length - 1; coverLen >= 0; coverLen--)
+    {
+      Ipv4Mask coverMask (coverLen == 0 ? 0 : (0xffffffff << (32 - coverLen)));
+      std::map<uint64_t, uint32_t>::const_iterator cover = 
+          m_directIds.find (GetPrefixKey (prefix.CombineMask (coverMask), coverMask));
+      if (cover != m_directIds.end ())
+      {
+        coverId = cover->second;
+        coverLength = coverLen;
+        break;
+      }
+    }
+
+    m_directIndex.Remove (prefix, length, id->second, coverId, coverLength);
+    m_directEntries[id->second] = 0;
+    m_freeDirectIds.push_back (id->second);
+    m_directIds.erase (id);
+    return;
+  }
+
+  if (id != m_directIds.end ())
+  {
+    m_directEntries[id->second] = &(*values->front ());
+    return;
+  }
+
+  uint32_t newId;
+  if (!m_freeDirectIds.empty ())
+  {
+    newId = m_freeDirectIds.back ();
+    m_freeDirectIds.pop_back ();
+  }
+  else
+  {
+    newId = m_directEntries.size ();
+    NS_ABORT_MSG_IF (newId > DirectIndex::MAX_ID, "ESLR: ForwardingTable - too many prefixes for the direct index");
+    m_directEntries.push_back (0);
+  }
+
+  m_directIds[key] = newId;
+  m_directEntries[newId] = &(*values->front ());
+  m_directIndex.Insert (prefix, length, newId);
+}
+
+void
+ForwardingTable::Resolve (ForwardingEntry &entry) const
+{
+  ResolveBackup (entry);
+
+  if (m_ipv4 == 0)
+  {
+    // resolved when the IPv4 pointer is set
+    entry.device = 0;
+    entry.route = 0;
+    return;
+  }
+
+  entry.device = m_ipv4->GetNetDevice (entry.interface);
+
+  // A new route object is built, as the IPv4 layer may still hold the previous one.
+  entry.route = Create<Ipv4Route> ();
+  entry.route->SetDestination (entry.destination);
+  entry.route->SetGateway (entry.gateway);
+  entry.route->SetOutputDevice (entry.device);
+
+  // As the packet is going to be forwarded in to the next hop, while finding the source address,
+  // the address scope is set as global.
+  entry.route->SetSource (m_ipv4->SelectSourceAddress (entry.device,
+      entry.destination,
+      Ipv4InterfaceAddress::GLOBAL));
+}
+
+void
+ForwardingTable::ResolveBackup (ForwardingEntry &entry) const
+{
+  if ((m_ipv4 == 0) || (entry.backupGateway == Ipv4Address::GetZero ()))
+  {
+    entry.backupDevice = 0;
+    entry.backupRoute = 0;
+    return;
+  }
+
+  entry.backupDevice = m_ipv4->GetNetDevice (entry.backupInterface);
+
+  // the flows already on the previous b-route keep their route object
+  entry.backupRoute = Create<Ipv4Route> ();
+  entry.backupRoute->SetDestination (entry.destination);
+  entry.backupRoute->SetGateway (entry.backupGateway);
+  entry.backupRoute->SetOutputDevice (entry.backupDevice);
+  entry.backupRoute->SetSource (m_ipv4->SelectSourceAddress (entry.backupDevice,
+      entry.destination,
+      Ipv4InterfaceAddress::GLOBAL));
+}
+
+}// end of namespace eslr
+}// end of namespace ns3
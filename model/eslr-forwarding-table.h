@@ -0,0 +1,287 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#ifndef ESLR_FORWARDING_TABLE_H
+#define ESLR_FORWARDING_TABLE_H
+
+#include <list>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/eslr-prefix-trie.h"
+#include "ns3/eslr-direct-index.h"
+
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/net-device.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+namespace eslr {
+
+/**
+ * \brief A forwarding entry: what the data plane needs to forward a packet.
+ */
+struct ForwardingEntry
+{
+  Ipv4Address destination; //!< the destination of the route
+  Ipv4Mask mask; //!< the network mask of the destination
+  Ipv4Address gateway; //!< the next hop
+  uint32_t interface; //!< the output interface
+  Ptr<NetDevice> device; //!< the net-device of the output interface
+  Ptr<Ipv4Route> route; //!< the prebuilt route handed to the IPv4 layer
+  uint32_t metric; //!< the metric of the route
+  Ipv4Address backupGateway; //!< the next hop of the b-route (zero if there is no b-route)
+  uint32_t backupInterface; //!< the output interface of the b-route
+  uint32_t backupMetric; //!< the metric of the b-route
+  Ptr<NetDevice> backupDevice; //!< the net-device of the b-route output interface
+  Ptr<Ipv4Route> backupRoute; //!< the prebuilt b-route (zero if there is no b-route)
+};
+
+/**
+ * \brief The forwarding table (FIB) of the ESLR.
+ *
+ * The routing table (RIB) keeps every route record together with its
+ * timers and states. The forwarding table only keeps the VALID routes of
+ * the main table, with the output device and the source address already
+ * resolved. The routing table updates the entries of a destination
+ * whenever the main table changes, therefore packet forwarding neither
+ * walks the routing table nor checks route states, and its cost does not
+ * depend on the backup table.
+ *
+ * The entries of a prefix are kept in the order of the main table.
+ * The first entry of a prefix also keeps the b-route of the destination,
+ * if any, so that the multipath forwarding needs no routing table lookup.
+ *
+ * Optionally, the first entry of each prefix is also kept in a DIR-24-8
+ * direct index, which answers the lookups that do not specify a net-device
+ * with at most two array reads. The index is updated with the entries.
+ */
+class ForwardingTable
+{
+public:
+  ForwardingTable ();
+  ~ForwardingTable ();
+
+  /**
+   * \brief Set the IPv4 pointer used to resolve the devices and the source addresses.
+   * The already added entries are resolved again.
+   * \param ipv4 the IPv4 pointer
+   */
+  void SetIpv4 (Ptr<Ipv4> ipv4);
+
+  /**
+   * \brief Add an entry after the existing entries of its prefix.
+   * \param destination the destination of the route
+   * \param mask the network mask of the destination
+   * \param gateway the next hop
+   * \param interface the output interface
+   * \param metric the metric of the route
+   */
+  void AddEntry (Ipv4Address destination,
+      Ipv4Mask mask,
+      Ipv4Address gateway,
+      uint32_t interface,
+      uint32_t metric);
+
+  /**
+   * \brief Set the metric and the b-route of the first entry of a prefix.
+   * The entry keeps its route and the generation does not change, as the
+   * routes handed out before are still valid. The b-route is rebuilt only
+   * if its next hop changes.
+   * \param destination the destination of the routes
+   * \param mask the network mask of the destination
+   * \param metric the metric of the entry
+   * \param backupGateway the next hop of the b-route (zero to remove the b-route)
+   * \param backupInterface the output interface of the b-route
+   * \param backupMetric the metric of the b-route
+   */
+  void SetBackup (Ipv4Address destination,
+      Ipv4Mask mask,
+      uint32_t metric,
+      Ipv4Address backupGateway,
+      uint32_t backupInterface,
+      uint32_t backupMetric);
+
+  /**
+   * \brief Remove all the entries of a destination.
+   * \param destination the destination of the routes
+   * \param mask the network mask of the destination
+   */
+  void RemoveEntries (Ipv4Address destination, Ipv4Mask mask);
+
+  /**
+   * \brief Find the entry to forward a packet with.
+   * The longest matching prefix is selected. If a net-device is given,
+   * only the entries using that device are considered.
+   * \param destination the destination address of the packet
+   * \param dev the output net-device (can be zero)
+   * \returns the entry, or 0 if no entry matches
+   */
+  const ForwardingEntry* Lookup (Ipv4Address destination, Ptr<NetDevice> dev) const;
+
+  /**
+   * \brief Find the entries to forward a batch of packets with.
+   * The result is the same as calling Lookup without a net-device for
+   * each destination. When the direct index is enabled, it is used.
+   * Otherwise, small tables are matched with a linear scan that compares
+   * several destinations against each prefix at once (SSE2 when available,
+   * scalar otherwise), and larger tables with the prefix trie.
+   * \param destinations the destination addresses
+   * \param n the number of destinations
+   * \param entries the returned entries (0 if no entry matches), n of them
+   */
+  void LookupBatch (const Ipv4Address *destinations, uint32_t n, const ForwardingEntry **entries) const;
+
+  /**
+   * \brief Enable or disable the direct index.
+   * When enabled, the index is built from the existing entries.
+   * \param enable true to enable the direct index
+   */
+  void EnableDirectIndex (bool enable);
+
+  /**
+   * \returns true if the direct index is enabled
+   */
+  bool IsDirectIndexEnabled (void) const
+  {
+    return m_directIndex.IsAllocated ();
+  }
+
+  /**
+   * \returns the direct index
+   */
+  const DirectIndex& GetDirectIndex (void) const
+  {
+    return m_directIndex;
+  }
+
+  /**
+   * \brief Resolve the devices and the source addresses of all entries again,
+   * and rebuild their routes.
+   * Needed when the addresses of the interfaces change.
+   */
+  void Refresh (void);
+
+  /**
+   * \brief Remove all entries. The direct index is disabled.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Return the generation of the forwarding table.
+   * The generation changes whenever an entry is added, removed or resolved
+   * again, so that the users can validate what they cached from the table.
+   * \returns the generation
+   */
+  uint32_t GetGeneration (void) const
+  {
+    return m_generation;
+  }
+
+  /**
+   * \returns the number of entries
+   */
+  uint32_t GetNEntries (void) const
+  {
+    return m_entries.size ();
+  }
+
+  /**
+   * \returns the memory used by the entries and their indexes, in bytes (estimate)
+   */
+  uint64_t GetMemorySize (void) const;
+
+private:
+  /// The entries, the trie refers to them
+  typedef std::list<ForwardingEntry> Entries;
+
+  /// The forwarding table owns its entries, copying is not allowed
+  ForwardingTable (const ForwardingTable &);
+  ForwardingTable& operator= (const ForwardingTable &);
+
+  /**
+   * \brief Resolve the device and the source address of an entry,
+   * and build its route.
+   * \param entry the entry
+   */
+  void Resolve (ForwardingEntry &entry) const;
+
+  /**
+   * \brief Resolve the device and the source address of the b-route of an entry,
+   * and build the b-route.
+   * \param entry the entry
+   */
+  void ResolveBackup (ForwardingEntry &entry) const;
+
+  /**
+   * \brief Rebuild the flat prefix arrays used by the batch scan, if the entries changed.
+   */
+  void UpdateScanArrays (void) const;
+
+  /**
+   * \brief Match a batch of destinations with a linear scan of the flat prefix arrays.
+   * \param destinations the destination addresses
+   * \param n the number of destinations
+   * \param entries the returned entries
+   */
+  void ScanBatch (const Ipv4Address *destinations, uint32_t n, const ForwardingEntry **entries) const;
+
+  /**
+   * \brief Bring the direct index in line with the entries of a prefix.
+   * \param prefix the network address of the prefix
+   * \param mask the network mask of the prefix
+   */
+  void SyncDirectIndex (Ipv4Address prefix, Ipv4Mask mask);
+
+  /**
+   * \brief Build the key of a prefix.
+   * \param prefix the network address of the prefix
+   * \param mask the network mask of the prefix
+   * \returns the key
+   */
+  static uint64_t GetPrefixKey (Ipv4Address prefix, Ipv4Mask mask)
+  {
+    return (uint64_t (prefix.Get ()) << 32) | mask.Get ();
+  }
+
+  Ptr<Ipv4> m_ipv4; //!< IPv4 pointer
+  Entries m_entries; //!< the entries
+  PrefixTrie<Entries::iterator> m_trie; //!< longest prefix match index of the entries
+  uint32_t m_generation; //!< changes whenever the entries change
+
+  DirectIndex m_directIndex; //!< direct index of the prefixes (optional)
+  std::map<uint64_t, uint32_t> m_directIds; //!< identifiers of the prefixes in the direct index
+  std::vector<const ForwardingEntry*> m_directEntries; //!< first entry of each identifier (0 is no entry)
+  std::vector<uint32_t> m_freeDirectIds; //!< identifiers to reuse
+
+  // The flat prefix arrays are built on demand from the const lookup path.
+  mutable uint32_t m_scanGeneration; //!< the generation the flat arrays were built at
+  mutable bool m_scanValid; //!< true if the flat arrays were built
+  mutable std::vector<uint32_t> m_scanNetworks; //!< prefixes, the longest first
+  mutable std::vector<uint32_t> m_scanMasks; //!< masks of the prefixes
+  mutable std::vector<const ForwardingEntry*> m_scanEntries; //!< first entry of each prefix
+}; // end of class ForwardingTable
+
+}// end of namespace eslr
+}// end of namespace ns3
+#endif /* ESLR_FORWARDING_TABLE_H */
@@ -22,6 +22,88 @@
 
 namespace ns3 {
 namespace eslr {
+
+/**
+ * \brief Get the number of bytes of a varint.
+ * \param value the value
+ * \return the number of bytes
+ */
+static uint32_t
+GetVarintSize (uint32_t value)
+{
+  uint32_t size = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+/**
+ * \brief Write a varint, 7 bits per byte, least significant group first.
+ * \param i Buffer iterator
+ * \param value the value
+ */
+static void
+WriteVarint (Buffer::Iterator &i, uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    i.WriteU8 (uint8_t (value | 0x80));
+    value >>= 7;
+  }
+  i.WriteU8 (uint8_t (value));
+}
+
+/**
+ * \brief Read a varint.
+ * \param i Buffer iterator
+ * \return the value
+ */
+static uint32_t
+ReadVarint (Buffer::Iterator &i)
+{
+  uint32_t value = 0;
+  uint8_t byte;
+  uint8_t shift = 0;
+  do
+  {
+    byte = i.ReadU8 ();
+    if (shift < 32)
+      value |= uint32_t (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+/**
+ * \brief Zig-zag code the difference between a sequence number and the base sequence number,
+ * so that small differences of both signs take a single varint byte.
+ * \param sequence the sequence number
+ * \param baseSequence the base sequence number
+ * \return the coded difference
+ */
+static uint32_t
+EncodeSequenceDelta (uint16_t sequence, uint16_t baseSequence)
+{
+  int16_t delta = int16_t (uint16_t (sequence - baseSequence));
+  return (delta < 0) ? ((uint32_t (-(delta + 1)) << 1) | 1) : (uint32_t (delta) << 1);
+}
+
+/**
+ * \brief Recover a sequence number from a zig-zag coded difference.
+ * \param coded the coded difference
+ * \param baseSequence the base sequence number
+ * \return the sequence number
+ */
+static uint16_t
+DecodeSequenceDelta (uint32_t coded, uint16_t baseSequence)
+{
+  int32_t delta = (coded & 1) ? -int32_t (coded >> 1) - 1 : int32_t (coded >> 1);
+  return uint16_t (baseSequence + delta);
+}
+
 /**
  * ESLR RUM
 */
@@ -95,6 +177,90 @@ ESLRrum::Deserialize (Buffer::Iterator i)
   return GetSerializedSize ();
 }
 
+uint8_t
+ESLRrum::GetCompactPrefixLength () const
+{
+  uint8_t prefixLength = m_mask.GetPrefixLength ();
+  uint32_t prefixMask = (prefixLength == 0) ? 0 : (0xffffffff << (32 - prefixLength));
+  if (m_mask.Get () != prefixMask)
+    return COMPACT_RUM_FULL_MASK;
+
+  // the address bits beyond the carried bytes would be lost
+  uint32_t carriedBits = ((prefixLength + 7) / 8) * 8;
+  uint32_t carriedMask = (carriedBits == 0) ? 0 : (0xffffffff << (32 - carriedBits));
+  if ((m_destination.Get () & ~carriedMask) != 0)
+    return COMPACT_RUM_FULL_MASK;
+
+  return prefixLength;
+}
+
+uint32_t 
+ESLRrum::GetCompactSize (uint16_t baseSequence) const
+{
+  uint8_t prefixLength = GetCompactPrefixLength ();
+  uint32_t addressSize = (prefixLength == COMPACT_RUM_FULL_MASK) ? 8 : (prefixLength + 7) / 8;
+
+  return 2 + addressSize + 
+         GetVarintSize (m_matric) + 
+         GetVarintSize (EncodeSequenceDelta (m_sequenceNumber, baseSequence));
+}
+
+uint32_t 
+ESLRrum::SerializeCompact (Buffer::Iterator start, uint16_t baseSequence) const
+{
+  Buffer::Iterator i = start;
+  uint8_t prefixLength = GetCompactPrefixLength ();
+
+  i.WriteU8 (m_routeTag);
+  i.WriteU8 (prefixLength);
+
+  uint8_t tmp[4];
+  m_destination.Serialize (tmp);
+  if (prefixLength == COMPACT_RUM_FULL_MASK)
+  {
+    i.WriteHtonU32 (m_mask.Get ());
+    i.Write (tmp, 4);
+  }
+  else
+  {
+    i.Write (tmp, (prefixLength + 7) / 8);
+  }
+
+  WriteVarint (i, m_matric);
+  WriteVarint (i, EncodeSequenceDelta (m_sequenceNumber, baseSequence));
+
+  return i.GetDistanceFrom (start);
+}
+
+uint32_t 
+ESLRrum::DeserializeCompact (Buffer::Iterator start, uint16_t baseSequence)
+{
+  Buffer::Iterator i = start;
+
+  m_routeTag = i.ReadU8 ();
+  uint8_t prefixLength = i.ReadU8 ();
+
+  uint8_t tmp[4] = {0, 0, 0, 0};
+  if (prefixLength == COMPACT_RUM_FULL_MASK)
+  {
+    m_mask = i.ReadNtohU32 ();
+    i.Read (tmp, 4);
+  }
+  else
+  {
+    if (prefixLength > 32)
+      prefixLength = 32;
+    m_mask = Ipv4Mask ((prefixLength == 0) ? 0 : (0xffffffff << (32 - prefixLength)));
+    i.Read (tmp, (prefixLength + 7) / 8);
+  }
+  m_destination = Ipv4Address::Deserialize (tmp);
+
+  m_matric = ReadVarint (i);
+  m_sequenceNumber = DecodeSequenceDelta (ReadVarint (i), baseSequence);
+
+  return i.GetDistanceFrom (start);
+}
+
 std::ostream & operator << (std::ostream & os, const ESLRrum & RUM)
 {
   RUM.Print (os);
@@ -108,6 +274,7 @@ std::ostream & operator << (std::ostream & os, const ESLRrum & RUM)
 NS_OBJECT_ENSURE_REGISTERED (KAMHeader);
 
 KAMHeader::KAMHeader(): m_command (0),
+                        m_capabilities (0),
                         m_authType (0),
                         m_authData (0),
 												m_identifier (0),
@@ -148,7 +315,7 @@ KAMHeader::GetSerializedSize () const
 void 
 KAMHeader::Serialize (Buffer::Iterator i) const
 {
- 	i.WriteU8 (m_command);
+ 	i.WriteU8 (m_capabilities | m_command);
   i.WriteU8 (m_authType);
   i.WriteHtonU16 (m_authData);
 	i.WriteU8 (m_identifier);
@@ -165,6 +332,8 @@ uint32_t
 KAMHeader::Deserialize (Buffer::Iterator i)
 {
   m_command = i.ReadU8 ();
+  m_capabilities = m_command & 0xf0;
+  m_command &= 0x0f;
   m_authType = i.ReadU8 ();
   m_authData = i.ReadNtohU16 ();
 	m_identifier = i.ReadU8 ();
@@ -274,10 +443,16 @@ NS_OBJECT_ENSURE_REGISTERED (ESLRRoutingHeader);
 ESLRRoutingHeader::ESLRRoutingHeader () : m_command (0),
                                           m_ruType (0),
                                           m_reqType (0),
+                                          m_version (ESLR_VERSION),
                                           m_noe (0),
                                           m_authType (0),
                                           m_authData (0),
-																					m_advertisementType (0)
+																					m_advertisementType (0),
+                                          m_updateSequence (0),
+                                          m_nMessages (0),
+                                          m_digest (0),
+                                          m_baseSequence (0),
+                                          m_compactSize (0)
 { /*Constructor*/ }
 
 TypeId ESLRRoutingHeader::GetTypeId (void)
@@ -296,7 +471,8 @@ TypeId ESLRRoutingHeader::GetInstanceTypeId (void) const
 void 
 ESLRRoutingHeader::Print (std::ostream & os) const
 {
-  os << "Command " << int (m_command);
+  os << "Version " << int (m_version);
+  os << " Command " << int (m_command);
   os << " Route Update Type " << int (m_ruType);
   os << " Route Update Request Type  " << int (m_reqType);
   
@@ -318,6 +494,17 @@ ESLRRoutingHeader::Print (std::ostream & os) const
 		os << " The routes are possibly connected routes ";
 	else if (GetDbit ())
 		os << " The routes are possibly poisoned routes "; 
+
+  if (GetSequenced ())
+  {
+    os << " Update Sequence " << m_updateSequence;
+    os << " Number of Messages " << m_nMessages;
+    os << " Digest " << m_digest;
+    if (GetDelta ())
+      os << " A Delta Update ";
+  }
+  if (GetCompact ())
+    os << " Compact RUMs, Base Sequence " << m_baseSequence;
   
   if (m_command == RU)
   {
@@ -360,15 +547,18 @@ ESLRRoutingHeader::GetSerializedSize () const
   
   if (m_command == RU) // Get the size of the Route Update packet
   {
-    return ESLR_BASE_SIZE + m_rumList.size () * rum.GetSerializedSize ();
+    uint32_t sequenceSize = GetSequenced () ? ESLR_SEQUENCE_SIZE : 0;
+    if (GetCompact ())
+      return GetBaseSize () + sequenceSize + ESLR_BASE_SEQUENCE_SIZE + m_compactSize;
+    return GetBaseSize () + sequenceSize + m_rumList.size () * rum.GetSerializedSize ();
   }
   else if (m_command == KAM) // Get the size of the Hello/Keep Alive Message packet
   {
-    return ESLR_BASE_SIZE + m_helloList.size () * kam.GetSerializedSize ();
+    return GetBaseSize () + m_helloList.size () * kam.GetSerializedSize ();
   }
   else if (m_command == SRC) // Get the size of the Server-Router Communication packet
   {
-    return ESLR_BASE_SIZE + m_serverList.size () * src.GetSerializedSize ();
+    return GetBaseSize () + m_serverList.size () * src.GetSerializedSize ();
   }
   
   return 0; // return 0 if the message miss matches. 
@@ -379,16 +569,37 @@ ESLRRoutingHeader::Serialize (Buffer::Iterator start) const
 {
   Buffer::Iterator i = start;
 
-  i.WriteU8 (m_command);
+  // the version 1 header has no version bits
+  uint8_t version = (m_version >= 2) ? m_version : 0;
+  i.WriteU8 ((version << 4) | m_command);
   i.WriteU8 (m_ruType);
   i.WriteU8 (m_reqType);
-  i.WriteU8 (m_noe);
+  i.WriteU8 (m_noe > 0xff ? 0xff : m_noe);
   i.WriteU8 (m_advertisementType);
   i.WriteU8 (m_authType);
   i.WriteHtonU16 (m_authData);
+  if (m_version >= 2)
+    i.WriteHtonU16 (m_noe);
 
   if (m_command == RU) // Get the size of the Route Update packet
   {
+    if (GetSequenced ())
+    {
+      i.WriteHtonU16 (m_updateSequence);
+      i.WriteHtonU16 (m_nMessages);
+      i.WriteHtonU32 (m_digest);
+    }
+    if (GetCompact ())
+    {
+      i.WriteHtonU16 (m_baseSequence);
+      for (std::list<ESLRrum>::const_iterator iter = m_rumList.begin (); 
+           iter != m_rumList.end (); 
+           iter ++)
+      {
+        i.Next (iter->SerializeCompact (i, m_baseSequence));
+      }
+      return;
+    }
     for (std::list<ESLRrum>::const_iterator iter = m_rumList.begin (); 
 				 iter != m_rumList.end (); 
 				 iter ++)
@@ -426,9 +637,12 @@ ESLRRoutingHeader::Deserialize (Buffer::Iterator start)
 
   uint8_t temp;
   temp = i.ReadU8 ();
-  if ((temp == RU) || (temp == KAM) || (temp == SRC))
+  uint8_t version = temp >> 4;
+  temp &= 0x0f;
+  if (((temp == RU) || (temp == KAM) || (temp == SRC)) && (version <= ESLR_VERSION))
   {
     m_command = temp;
+    m_version = (version == 0) ? 1 : version;
   }
   else
   {
@@ -442,14 +656,44 @@ ESLRRoutingHeader::Deserialize (Buffer::Iterator start)
   m_advertisementType = i.ReadU8 ();
   m_authType = i.ReadU8 ();
   m_authData = i.ReadNtohU16 ();
+  if (m_version >= 2)
+    m_noe = i.ReadNtohU16 ();
 
-  uint8_t numberofMessages = 0;
+  uint32_t numberofMessages = 0;
 
   if (m_command == RU) // Get the size of the Route Update packet
   {
-    numberofMessages = (i.GetSize () - ESLR_BASE_SIZE) / RUM_SIZE;
+    uint32_t sequenceSize = 0;
+    if (GetSequenced ())
+    {
+      m_updateSequence = i.ReadNtohU16 ();
+      m_nMessages = i.ReadNtohU16 ();
+      m_digest = i.ReadNtohU32 ();
+      sequenceSize = ESLR_SEQUENCE_SIZE;
+    }
+    if (GetCompact ())
+    {
+      // the compact RUMs differ in size, they can only be counted by the version 2 NoE
+      if (m_version < 2)
+        return 0;
+
+      m_baseSequence = i.ReadNtohU16 ();
+      for (uint32_t n = 0; n < m_noe; n++)
+      {
+        ESLRrum rum;
+        i.Next (rum.DeserializeCompact (i, m_baseSequence));
+        m_compactSize += rum.GetCompactSize (m_baseSequence);
+        m_rumList.push_back (rum);
+      }
+      return GetSerializedSize ();
+    }
+    // the version 1 NoE field can not count more than 255 RUMs, the RUMs are counted from the size
+    if (m_version >= 2)
+      numberofMessages = m_noe;
+    else
+      numberofMessages = (i.GetSize () - GetBaseSize () - sequenceSize) / RUM_SIZE;
 
-		for (uint8_t n = 0; n<numberofMessages; n++)
+		for (uint32_t n = 0; n<numberofMessages; n++)
     {
       ESLRrum rum;
       i.Next (rum.Deserialize (i));
@@ -459,9 +703,9 @@ ESLRRoutingHeader::Deserialize (Buffer::Iterator start)
   }
   else if (m_command == KAM) // Get the size of the Hello/Keep Alive Message packet
   {
-    numberofMessages = (i.GetSize () - ESLR_BASE_SIZE) / KAM_SIZE;
+    numberofMessages = (i.GetSize () - GetBaseSize ()) / KAM_SIZE;
 
-		for (uint8_t n=0; n<numberofMessages; n++)
+		for (uint32_t n=0; n<numberofMessages; n++)
     {
       KAMHeader kam;
       i.Next (kam.Deserialize (i));
@@ -471,9 +715,9 @@ ESLRRoutingHeader::Deserialize (Buffer::Iterator start)
   }
   else if (m_command == SRC) // Get the size of the Server-Router Communication packet
   {
-    numberofMessages = (i.GetSize () - ESLR_BASE_SIZE) / SRCH_SIZE;
+    numberofMessages = (i.GetSize () - GetBaseSize ()) / SRCH_SIZE;
 
-		for (uint8_t n=0; n<numberofMessages; n++)
+		for (uint32_t n=0; n<numberofMessages; n++)
     {
       SRCHeader src;
       i.Next (src.Deserialize (i));
@@ -491,10 +735,24 @@ ESLRRoutingHeader::Deserialize (Buffer::Iterator start)
 void 
 ESLRRoutingHeader::AddRum (ESLRrum rum)
 {
+  if (m_rumList.empty ())
+    m_baseSequence = rum.GetSequenceNo ();
+  m_compactSize += rum.GetCompactSize (m_baseSequence);
   m_rumList.push_back (rum);
   SetNoe ();
 }
 
+void 
+ESLRRoutingHeader::SetBaseSequence (uint16_t sequence)
+{
+  m_baseSequence = sequence;
+  m_compactSize = 0;
+  for (std::list<ESLRrum>::const_iterator it = m_rumList.begin (); it != m_rumList.end (); it++)
+  {
+    m_compactSize += it->GetCompactSize (m_baseSequence);
+  }
+}
+
 void 
 ESLRRoutingHeader::DeleteRum (ESLRrum rum)
 {
@@ -505,12 +763,15 @@ ESLRRoutingHeader::DeleteRum (ESLRrum rum)
       m_rumList.erase (it);
     }
   }    
+  SetBaseSequence (m_baseSequence);
 }
 
 void 
 ESLRRoutingHeader::ClearRums ()
 {
   m_rumList.clear ();
+  m_noe = 0;
+  m_compactSize = 0;
 }
 
 std::list<ESLRrum> 
@@ -26,6 +26,7 @@
 #include "eslr-definition.h"
 
 #include "ns3/header.h"
+#include "ns3/assert.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
@@ -55,6 +56,20 @@ namespace eslr {
 			C 		:		Connected routes
 			D 		:		Poisoned routes
 			<tag>	:		For route conversions
+
+	--------------------------Compact RUM--------------------------
+		+---------------+---------------+-----------------------------+
+		|      Tag      |  Prefix_Len   | Address (Prefix_Len/8 bytes)~
+		+---------------+---------------+-----------------------------+
+		~ Metric (varint) ~ Seq# - Base Seq# (zig-zag varint) ~
+		+-------------------------------------------------------------+
+		The compact RUMs are carried only by the version 2 headers with the K bit set, and only 
+		to the neighbors that advertised the COMPACT_RUMS capability.
+		Only the bytes of the address that the prefix covers are carried. If the mask is 
+		not contiguous or the address has bits beyond those bytes, Prefix_Len is 
+		COMPACT_RUM_FULL_MASK and the 4 byte mask and the 4 byte address follow.
+		A varint carries 7 bits per byte, least significant group first; the high bit of 
+		a byte is set when more bytes follow.
 */
 class ESLRrum : public Header
 {
@@ -94,6 +109,29 @@ public:
    */
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
+  /**
+   * \brief Get the size of the compact encoding of the RUM.
+   * \param baseSequence the base sequence number of the message
+   * \return size
+   */
+  uint32_t GetCompactSize (uint16_t baseSequence) const;
+
+  /**
+   * \brief Serialize the RUM in the compact encoding.
+   * \param start Buffer iterator
+   * \param baseSequence the base sequence number of the message
+   * \return the number of bytes written
+   */
+  uint32_t SerializeCompact (Buffer::Iterator start, uint16_t baseSequence) const;
+
+  /**
+   * \brief Deserialize a RUM in the compact encoding.
+   * \param start Buffer iterator
+   * \param baseSequence the base sequence number of the message
+   * \return the number of bytes read
+   */
+  uint32_t DeserializeCompact (Buffer::Iterator start, uint16_t baseSequence);
+
   /**
    * \brief Get and Set the Sequence number.
    * \param Sequence-number
@@ -189,6 +227,12 @@ public:
 	}
 
 private:
+  /**
+   * \brief Get the prefix length that the compact encoding carries.
+   * \return the prefix length, or COMPACT_RUM_FULL_MASK if the whole mask and address are carried
+   */
+  uint8_t GetCompactPrefixLength () const;
+
   uint16_t m_sequenceNumber; //!< sequence number
   uint32_t m_matric; //!< metric (time to reach the destination)
   Ipv4Address m_destination; //!< destination network/host address
@@ -213,7 +257,7 @@ std::ostream & operator << (std::ostream &os, const ESLRrum &h);
 		|      0        |      1        |      2        |      3      |
 		0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
 		+---------------+---------------+---------------+-------------+
-		|		Command		  |		Auth_Type		|						Auth_Data				  |
+		|	Cap	|	Cmd	  |		Auth_Type		|						Auth_Data				  |
 		+---------------+---------------+---------------+-------------+
 		|		Identifier	|		Not_Use			| 				Neighbor_ID				  |
 		+---------------+---------------+---------------+-------------+
@@ -221,6 +265,7 @@ std::ostream & operator << (std::ostream &os, const ESLRrum &h);
 		+---------------+---------------+---------------+-------------+
 		|						     						 NetMask						  					  |
 		+---------------+---------------+---------------+-------------+
+		Cap	:	capabilities of the sender (eslr::KamCapability), zero for the older routers
 */
 class KAMHeader : public Header
 {
@@ -278,6 +323,20 @@ public:
     return eslr::KamHeaderCommand (m_command);
 	}
 
+  /**
+   * \brief Get and Set whether the sender decodes the compact RUMs.
+   * \param flag the sender decodes the compact RUMs
+   * \return true if the sender decodes the compact RUMs
+   */
+  void SetCompactRums (bool flag)
+  {
+    (flag) ? m_capabilities |= eslr::COMPACT_RUMS : m_capabilities &= ~eslr::COMPACT_RUMS;
+  }
+  bool GetCompactRums () const
+  {
+    return (m_capabilities & eslr::COMPACT_RUMS);
+  }
+
   /**
    * \brief Get and Set Authentication Type.
    * \param authType the authentication type
@@ -364,6 +423,7 @@ public:
 
 private:
   uint8_t m_command;  //!< message command
+  uint8_t m_capabilities;  //!< capabilities of the sender
   uint8_t m_authType;  //!< authentication type
   uint16_t m_authData;  //!< authentication data
 	uint8_t m_identifier;	//!< Neighbor Identifier; a randomly generate number
@@ -556,10 +616,18 @@ std::ostream & operator << (std::ostream & os, const SRCHeader & h);
 		|      0        |      1        |      2        |      3      |
 		0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
 		+---------------+---------------+---------------+-------------+
-		|    Command    |   RU_Command  |    REQ_Type   |    NoE      |
+		|  Ver  |  Cmd  |   RU_Command  |    REQ_Type   |    NoE      |
+		+---------------+---------------+---------------+-------------+
+		|FT|P|T|C|D|S|Dt|K|	Auth_Type	|	 					Auth_Data				  |
+		+---------------+---------------+---------------+-------------+
+		|           NoE (16 bits)       |  (version 2 only)
+		+---------------+---------------+
+		|        Update_Sequence        |       Number_of_Messages      |  (only if S is set)
 		+---------------+---------------+---------------+-------------+
-		|FT|P|T|C|D|not |	 Auth_Type	  |	 					Auth_Data				  |
+		|                           Digest                            |  (only if S is set)
 		+---------------+---------------+---------------+-------------+
+		|         Base_Sequence         |  (only if K is set)
+		+---------------+---------------+
 		|                              		                          	|
 		~							   							 RUM							  						~
 		|                                							  							|
@@ -570,6 +638,14 @@ std::ostream & operator << (std::ostream & os, const SRCHeader & h);
 		T				: Trig. Update
 		C				: Connected routes
 		D				: Disconnected routes
+		S				: Sequenced update, the update sequence block follows
+		Dt			: Delta update, only the routes changed since the acknowledged update are carried
+		K				: Compact RUMs, the sequence numbers are coded against Base_Sequence (version 2 only)
+	Version
+		The version 1 header has no version (the Ver bits are zero) and an 8 bit NoE, 
+		therefore, a message can not carry more than 255 RUMs.
+		The version 2 header carries the whole NoE in a 16 bit field. The 8 bit NoE 
+		field carries the NoE up to 255.
 */
 class ESLRRoutingHeader : public Header
 {
@@ -660,7 +736,7 @@ public:
    * \brief Set method directly get the number of RUMs in the RUM list
    * \returns the number of RUMs in the message
    */
-  uint8_t GetNoe () const
+  uint16_t GetNoe () const
   {
     return m_noe;
   }
@@ -669,6 +745,39 @@ public:
     m_noe = m_rumList.size();
   }
 
+  /**
+   * \brief Set the number of RUMs, when the RUMs are already encoded in the packet payload
+   * that follows the header, instead of being added to the RUM list.
+   * \param noe the number of RUMs in the payload
+   */
+  void SetNoe (uint16_t noe)
+  {
+    m_noe = noe;
+  }
+
+  /**
+   * \brief Set and Get the version of the header
+   * \param version the version (1 or 2)
+   * \returns the version
+   */
+  void SetVersion (uint8_t version)
+  {
+    NS_ASSERT (version == 1 || version == 2);
+    m_version = version;
+  }
+  uint8_t GetVersion () const
+  {
+    return m_version;
+  }
+
+  /**
+   * \returns the largest number of RUMs the NoE field of this version can count
+   */
+  uint16_t GetMaxNoe () const
+  {
+    return (m_version >= 2) ? 0xffff : 0xff;
+  }
+
 	/**
 	 * Get and Set the advertisement type
 	 * Fast Trig. Update
@@ -722,6 +831,87 @@ public:
     return (m_advertisementType & (1 << 4));
   }
 
+  void SetSequenced (bool flag)
+  {
+    (flag) ? m_advertisementType |= (1 << 5) :  m_advertisementType &= ~(1 << 5);
+  }
+  bool GetSequenced (void) const
+  {
+    return (m_advertisementType & (1 << 5));
+  }
+
+  void SetDelta (bool flag)
+  {
+    (flag) ? m_advertisementType |= (1 << 6) :  m_advertisementType &= ~(1 << 6);
+  }
+  bool GetDelta (void) const
+  {
+    return (m_advertisementType & (1 << 6));
+  }
+
+  void SetCompact (bool flag)
+  {
+    (flag) ? m_advertisementType |= (1 << 7) :  m_advertisementType &= ~(1 << 7);
+  }
+  bool GetCompact (void) const
+  {
+    return (m_advertisementType & (1 << 7));
+  }
+
+  /**
+   * \brief Set and Get the sequence number the compact RUMs are coded against.
+   * The first RUM added to the message sets the base sequence number.
+   * \param sequence the base sequence number
+   * \returns the base sequence number
+   */
+  void SetBaseSequence (uint16_t sequence);
+  uint16_t GetBaseSequence (void) const
+  {
+    return m_baseSequence;
+  }
+
+  /**
+   * \brief Set and Get the sequence number of the periodic update (sequenced updates only)
+   * \param sequence the sequence number
+   * \returns the sequence number
+   */
+  void SetUpdateSequence (uint16_t sequence)
+  {
+    m_updateSequence = sequence;
+  }
+  uint16_t GetUpdateSequence (void) const
+  {
+    return m_updateSequence;
+  }
+
+  /**
+   * \brief Set and Get the number of messages of the periodic update (sequenced updates only)
+   * \param nMessages the number of messages
+   * \returns the number of messages
+   */
+  void SetNMessages (uint16_t nMessages)
+  {
+    m_nMessages = nMessages;
+  }
+  uint16_t GetNMessages (void) const
+  {
+    return m_nMessages;
+  }
+
+  /**
+   * \brief Set and Get the digest of the routes advertised to the interface (sequenced updates only)
+   * \param digest the digest
+   * \returns the digest
+   */
+  void SetDigest (uint32_t digest)
+  {
+    m_digest = digest;
+  }
+  uint32_t GetDigest (void) const
+  {
+    return m_digest;
+  }
+
 	void SetAdvertisementTypeZero (void)
 	{
 		m_advertisementType = 0;
@@ -817,13 +1007,27 @@ public:
   std::list<SRCHeader> GetSrcList (void) const;
 
 private:
+  /**
+   * \returns the size of the header without the update sequence block and the messages
+   */
+  uint32_t GetBaseSize () const
+  {
+    return ESLR_BASE_SIZE + ((m_version >= 2) ? ESLR_NOE_SIZE : 0);
+  }
+
   uint8_t m_command; //!< command type
   uint8_t m_ruType; //!< advertisement type
   uint8_t m_reqType; //!< request type
-  uint8_t m_noe;	//!< number of RUMs are in the message
+  uint8_t m_version; //!< version of the header
+  uint16_t m_noe;	//!< number of RUMs are in the message
   uint8_t m_authType;	//!< Authentication Type
   uint16_t m_authData;	//!< number of RUMs are in the message
-	uint8_t m_advertisementType;	//!< |Fast Trig|Periodic|Trig|Connected|Disconnected|NT|
+	uint8_t m_advertisementType;	//!< |Fast Trig|Periodic|Trig|Connected|Disconnected|Sequenced|Delta|Compact|
+  uint16_t m_updateSequence; //!< sequence number of the periodic update
+  uint16_t m_nMessages; //!< number of messages of the periodic update
+  uint32_t m_digest; //!< digest of the routes advertised to the interface
+  uint16_t m_baseSequence; //!< sequence number the compact RUMs are coded against
+  uint32_t m_compactSize; //!< size of the RUMs of the list in the compact encoding
 
   std::list<ESLRrum> m_rumList; //!< list of the RUMs in the message
   std::list<KAMHeader> m_helloList; //!< list of the RUMs in the message
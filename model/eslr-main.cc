@@ -18,6 +18,7 @@
 * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
 */
 
+#include <algorithm>
 #include <iomanip>
 #include <string>
 
@@ -37,6 +38,8 @@
 #include "ns3/boolean.h"
 #include "ns3/double.h"
 #include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/hash.h"
 #include "ns3/node-list.h"
 #include "ns3/timer.h"
 #include "ns3/channel.h"
@@ -51,7 +54,11 @@ NS_OBJECT_ENSURE_REGISTERED (EslrRoutingProtocol);
 EslrRoutingProtocol::EslrRoutingProtocol() :  m_ipv4 (0),
                                               m_initialized (false),
                                               m_protocolMessages (0),
-																							m_neighborTable ()
+																							m_neighborTable (),
+                                              m_routeCacheGeneration (0),
+                                              m_routeCacheHits (0),
+                                              m_routeCacheMisses (0),
+                                              m_updateSequence (0)
 {
   m_rng = CreateObject<UniformRandomVariable> ();
 }
@@ -110,6 +117,10 @@ TypeId EslrRoutingProtocol::GetTypeId (void)
                     MakeEnumChecker ( MAIN_R_TABLE, "MainRoutingTable",
                                       N_TABLE, "NeighborTable",
                                       BACKUP_R_TABLE, "BackupRoutingTable"))
+    .AddAttribute ( "MemoryReportInterval", "Time between two reports of the memory footprint (zero disables the reports).",
+                    TimeValue (Seconds (0)),
+                    MakeTimeAccessor (&EslrRoutingProtocol::m_memoryReportInterval),
+                    MakeTimeChecker ())
     .AddAttribute ( "DebugPrintingDuration", "Time gap between two debug messages.",
                     TimeValue (Seconds(20)),
                     MakeTimeAccessor (&EslrRoutingProtocol::m_printDuration),
@@ -126,6 +137,63 @@ TypeId EslrRoutingProtocol::GetTypeId (void)
 			 							UintegerValue (1),
 										MakeUintegerAccessor (&EslrRoutingProtocol::m_K3),
 										MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ( "ForwardingLookup", "How the forwarding table is looked up (\"DirectIndex\" allocates a 64 MiB tbl24 array per node).",
+                    EnumValue (TRIE_LOOKUP),
+                    MakeEnumAccessor (&EslrRoutingProtocol::m_forwardingLookup),
+                    MakeEnumChecker (TRIE_LOOKUP, "Trie",
+                                      DIRECT_INDEX_LOOKUP, "DirectIndex"))
+    .AddAttribute ( "DeltaUpdates", "Send only the routes changed since the update acknowledged by the neighbors in the periodic updates.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&EslrRoutingProtocol::m_deltaUpdates),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "CompactUpdates", "Send the compact RUMs to the neighbors that advertise them in their KAMs.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&EslrRoutingProtocol::m_compactUpdates),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "RouteAggregation", "Summarize the contiguous prefixes that share a gateway in the route updates.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&EslrRoutingProtocol::m_routeAggregation),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "AggregationMetricError", "Largest relative metric difference among the routes of a summary.",
+                    DoubleValue (0.1),
+                    MakeDoubleAccessor (&EslrRoutingProtocol::m_aggregationMetricError),
+                    MakeDoubleChecker<double> (0.0))
+    .AddAttribute ( "Multipath", "Share the flows between the main route and a close enough backup route.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&EslrRoutingProtocol::m_multipath),
+                    MakeBooleanChecker ())
+    .AddAttribute ( "MultipathMetricRatio", "Largest backup route metric, relative to the main route metric, for multipath.",
+                    DoubleValue (1.2),
+                    MakeDoubleAccessor (&EslrRoutingProtocol::m_multipathMetricRatio),
+                    MakeDoubleChecker<double> (1.0))
+    .AddAttribute ( "MultipathFlowTableSize", "Maximum number of flows whose paths are remembered.",
+                    UintegerValue (1024),
+                    MakeUintegerAccessor (&EslrRoutingProtocol::m_flowTableSize),
+                    MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ( "RouteCacheSize", "Maximum number of destinations kept in the route cache (0, the default, disables the cache).",
+                    UintegerValue (0),
+                    MakeUintegerAccessor (&EslrRoutingProtocol::m_routeCacheSize),
+                    MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ( "RouteCacheHits", "Number of route lookups answered by the route cache.",
+                      MakeTraceSourceAccessor (&EslrRoutingProtocol::m_routeCacheHits))
+    .AddTraceSource ( "RouteCacheMisses", "Number of route lookups that missed the route cache.",
+                      MakeTraceSourceAccessor (&EslrRoutingProtocol::m_routeCacheMisses))
+    .AddAttribute ( "ControlRate", "Rate of the ESLR packets sent on an interface (zero disables the pacing).",
+                    DataRateValue (DataRate ("0bps")),
+                    MakeDataRateAccessor (&EslrRoutingProtocol::m_controlRate),
+                    MakeDataRateChecker ())
+    .AddAttribute ( "ControlBurst", "Bytes of ESLR packets an interface can send at once.",
+                    UintegerValue (3000),
+                    MakeUintegerAccessor (&EslrRoutingProtocol::m_controlBurst),
+                    MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ( "ControlQueueSize", "Largest number of ESLR packets waiting for the pacer of an interface.",
+                    UintegerValue (100),
+                    MakeUintegerAccessor (&EslrRoutingProtocol::m_controlQueueSize),
+                    MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ( "MemoryUsage", "Memory footprint of the routing tables and of the neighbor table.",
+                      MakeTraceSourceAccessor (&EslrRoutingProtocol::m_memoryUsageTrace))
+    .AddTraceSource ( "ControlDrop", "ESLR packet dropped as the pacer queue of its interface was full.",
+                      MakeTraceSourceAccessor (&EslrRoutingProtocol::m_controlDropTrace))
 
   ;
   return tid;
@@ -153,6 +221,12 @@ EslrRoutingProtocol::DoInitialize ()
 
   m_routing.AssignStream (m_stream);
 	m_routing.AssignIpv4 (m_ipv4);
+  m_routing.SetForwardingLookup (m_forwardingLookup);
+
+  m_controlPacer.SetRate (m_controlRate);
+  m_controlPacer.SetBurst (m_controlBurst);
+  m_controlPacer.SetMaxQueueSize (m_controlQueueSize);
+  m_controlPacer.SetDropCallback (MakeCallback (&EslrRoutingProtocol::ControlPacketDropped, this));
 
   // build the socket and interface list
   // NOTE:
@@ -223,6 +297,9 @@ EslrRoutingProtocol::DoInitialize ()
   delay = m_periodicUpdateDelay + Seconds (m_rng->GetValue (0, m_periodicUpdateDelay.GetSeconds ()));
   m_nextPeriodicUpdate = Simulator::Schedule (delay, &EslrRoutingProtocol::SendPeriodicUpdate, this);
   
+  if (m_memoryReportInterval.IsStrictlyPositive ())
+    m_memoryReportEvent = Simulator::Schedule (m_memoryReportInterval, &EslrRoutingProtocol::ReportMemoryUsage, this);
+
 //  // Initialize the periodic debug counter
 //  m_countingEvent = Simulator::Schedule (m_printDuration, &EslrRoutingProtocol::PrintStats, this); 
     
@@ -238,6 +315,15 @@ EslrRoutingProtocol::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
 
+  for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++ )
+  {
+    if (m_controlRate.GetBitRate () > 0)
+      NS_LOG_INFO ("ESLR: control packets of interface " << iter->second << " " << 
+                   m_controlPacer.GetStatistics (iter->second));
+  }
+  // the waiting packets hold the sockets
+  m_controlPacer.Clear ();
+
   for (SocketListI iter = m_sendSocketList.begin (); iter != m_sendSocketList.end (); iter++ )
   {
     iter->first->Close ();
@@ -255,10 +341,30 @@ EslrRoutingProtocol::DoDispose ()
   m_nextPeriodicUpdate.Cancel ();
   m_nextPeriodicUpdate = EventId ();
 
+  m_memoryReportEvent.Cancel ();
+  m_memoryReportEvent = EventId ();
+
   m_ipv4 = 0;
 
+  m_routeCache.clear ();
+  m_routeCacheOrder.clear ();
+  m_flowTable.clear ();
+  m_flowOrder.clear ();
+  m_advertisedSummaries.clear ();
+  m_routeChanges.clear ();
+  m_acknowledgedUpdates.clear ();
+  m_neighborAdvertisements.clear ();
+  m_localAddresses.clear ();
+
+  MemoryUsage routing, neighbors;
+  GetMemoryUsage (routing, neighbors);
+  NS_LOG_INFO ("ESLR: routing tables " << routing << "; neighbor table " << neighbors);
+
   m_neighborTable.DoDispose ();
 
+  NS_LOG_INFO ("ESLR: route entries allocated " << m_routing.GetEntryPool ().GetNAllocations () <<
+               ", heap allocations " << m_routing.GetEntryPool ().GetNHeapAllocations ());
+
   m_routing.DoDispose ();
 }
 
@@ -267,6 +373,8 @@ EslrRoutingProtocol::NotifyInterfaceUp (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
 
+  UpdateLocalAddresses ();
+
   for (uint32_t i = 0; i < m_ipv4->GetNAddresses (interface); i++)
   {
     Ipv4InterfaceAddress iface = m_ipv4->GetAddress (interface,i);
@@ -365,6 +473,8 @@ void
 EslrRoutingProtocol::NotifyInterfaceDown (uint32_t interface)
 {
   NS_LOG_FUNCTION (this << interface);
+
+  UpdateLocalAddresses ();
   
   // NOTE:
   // All routes that are referring this interface has to remove from both routing tables, 
@@ -447,7 +557,7 @@ EslrRoutingProtocol::NotifyInterfaceDown (uint32_t interface)
         // send it via link local broadcast
         NS_LOG_LOGIC ("ESLR: Send a fast triggered update to " << it->first->GetNeighborAddress ());
         Ipv4Address broadAddress = it->first->GetNeighborAddress ().GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());
-        it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+        SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, true);
 
 				p->RemoveHeader (hdr);
 				hdr.ClearRums ();
@@ -500,12 +610,7 @@ EslrRoutingProtocol::PullRoutes (uint32_t interface)
       {
         // In case number of destination addresses exceeds the header size
         // Calculating the Number of RUMs that can add to the ESLR Routing Header
-        uint16_t mtu = m_ipv4->GetMtu (it->first->GetInterface ());
-        uint16_t maxRum = (mtu - 
-                           Ipv4Header ().GetSerializedSize () - 
-                           UdpHeader ().GetSerializedSize () - 
-                           ESLRRoutingHeader ().GetSerializedSize ()
-                          ) / ESLRrum ().GetSerializedSize ();
+        uint16_t maxRum = GetMaxRums (it->first->GetInterface (), false);
 
         Ptr<Packet> p = Create<Packet> ();
         SocketIpTtlTag tag;
@@ -539,7 +644,7 @@ EslrRoutingProtocol::PullRoutes (uint32_t interface)
             
             // send it via link local broadcast
             Ipv4Address broadAddress = it->first->GetNeighborAddress ().GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());
-            it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+            SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
             p->RemoveHeader (hdr);
             hdr.ClearRums ();
           }
@@ -551,11 +656,11 @@ EslrRoutingProtocol::PullRoutes (uint32_t interface)
           
           // send it via link local broadcast  
           Ipv4Address broadAddress = it->first->GetNeighborAddress ().GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());   
-          it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+          SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
         }
       }
     }    
-    // Finally clear out the created table instance of the main routing table.
+    // Finally clear out the instance, the routes are owned by the main routing table.
     routes.clear ();
     // Clear the temporary neighbor table instance
     tempNeighbor.clear ();
@@ -567,6 +672,10 @@ EslrRoutingProtocol::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress
 {
   NS_LOG_FUNCTION (this << " interface " << interface << " address " << address);
 
+  // the source addresses of the forwarding entries may change
+  m_routing.RefreshForwardingTable ();
+  UpdateLocalAddresses ();
+
   if (!m_ipv4->IsUp (interface))
   {
     return;
@@ -599,6 +708,10 @@ EslrRoutingProtocol::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddre
 {
   NS_LOG_FUNCTION (this << " interface " << interface << " address " << address);
 
+  // the source addresses of the forwarding entries may change
+  m_routing.RefreshForwardingTable ();
+  UpdateLocalAddresses ();
+
   if (!m_ipv4->IsUp (interface))
   {
     return;
@@ -644,6 +757,21 @@ EslrRoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
   }
 }
 
+void 
+EslrRoutingProtocol::UpdateLocalAddresses ()
+{
+  NS_LOG_FUNCTION (this);
+
+  m_localAddresses.clear ();
+  for (uint32_t j = 0; j < m_ipv4->GetNInterfaces (); j++)
+  {
+    for (uint32_t i = 0; i < m_ipv4->GetNAddresses (j); i++)
+    {
+      m_localAddresses.insert (m_ipv4->GetAddress (j, i).GetLocal ().Get ());
+    }
+  }
+}
+
 void 
 EslrRoutingProtocol::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
 {
@@ -691,6 +819,7 @@ EslrRoutingProtocol::SendHelloMessageForInterface (uint32_t interface)
 
   KAMHeader helloHdr;
   helloHdr.SetCommand (eslr::HELLO);
+  helloHdr.SetCompactRums (m_compactUpdates);
   helloHdr.SetAuthType (eslr::PLAIN_TEXT); // Administrator needs to decide the authentication type
   helloHdr.SetAuthData (1234); // Administrator needs to decide the authentication phrase
   helloHdr.SetNeighborID ((uint16_t)genarateNeighborID ());
@@ -709,7 +838,7 @@ EslrRoutingProtocol::SendHelloMessageForInterface (uint32_t interface)
   p->AddHeader (hdr);
 
   NS_LOG_LOGIC ("ESLR: SendTo: " << iface.GetBroadcast () << " " << *p);
-	GetSocketForInterface (interface)->SendTo (p, 0, InetSocketAddress (iface.GetBroadcast (), ESLR_BROAD_PORT)); 
+	SendControlPacket (GetSocketForInterface (interface), p, iface.GetBroadcast (), ESLR_BROAD_PORT, false); 
 }
 
 void 
@@ -736,6 +865,7 @@ EslrRoutingProtocol::SendHelloMessage ()
     uint32_t interface = iter->second;
 
     helloHdr.SetCommand (eslr::HELLO); 
+    helloHdr.SetCompactRums (m_compactUpdates);
     helloHdr.SetAuthType (eslr::PLAIN_TEXT); // Administrator needs to decide the authentication type
     helloHdr.SetAuthData (1234); // Administrator needs to decide the authentication phrase
     helloHdr.SetNeighborID ((uint16_t)genarateNeighborID ());
@@ -757,7 +887,7 @@ EslrRoutingProtocol::SendHelloMessage ()
     {
       NS_LOG_LOGIC ("ESLR: SendTo: " << iface.GetBroadcast () << " " << *p);
  
-      iter->first->SendTo (p, 0, InetSocketAddress (iface.GetBroadcast (), ESLR_BROAD_PORT));
+      SendControlPacket (iter->first, p, iface.GetBroadcast (), ESLR_BROAD_PORT, false);
       p->RemoveHeader (hdr);
       hdr.ClearKams ();
     }		
@@ -803,6 +933,7 @@ void EslrRoutingProtocol::sendKams ()
   	hdr.SetAuthData (it->first->GetAuthData ());
 
     kamHdr.SetCommand (eslr::HI);
+    kamHdr.SetCompactRums (m_compactUpdates);
     kamHdr.SetAuthType (it->first->GetAuthType ());
     kamHdr.SetAuthData (it->first->GetAuthData ());
     kamHdr.SetNeighborID ((uint16_t)genarateNeighborID ());
@@ -823,7 +954,7 @@ void EslrRoutingProtocol::sendKams ()
 
     // send it via link local broadcast
     Ipv4Address broadAddress = iface.GetBroadcast ();
-    it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_BROAD_PORT));
+    SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_BROAD_PORT, false);
 
       p->RemoveHeader (hdr);
       hdr.ClearKams ();		
@@ -871,6 +1002,27 @@ EslrRoutingProtocol::SendPeriodicUpdate (void)
   if (m_nextTriggeredUpdate.IsRunning ())
     m_nextTriggeredUpdate.Cancel ();
 
+  if (m_deltaUpdates)
+  {
+    // forget the update states of the lost neighbors
+    NeighborTable::NeighborI neighborRecord;
+    for (AcknowledgedUpdates::iterator ack = m_acknowledgedUpdates.begin (); ack != m_acknowledgedUpdates.end (); )
+    {
+      if (m_neighborTable.FindNeighborForAddress (ack->first, neighborRecord))
+        ack++;
+      else
+        m_acknowledgedUpdates.erase (ack++);
+    }
+    for (NeighborAdvertisementsMap::iterator advertised = m_neighborAdvertisements.begin (); 
+         advertised != m_neighborAdvertisements.end (); )
+    {
+      if (m_neighborTable.FindNeighborForAddress (advertised->first, neighborRecord))
+        advertised++;
+      else
+        m_neighborAdvertisements.erase (advertised++);
+    }
+  }
+
   DoSendRouteUpdate (eslr::PERIODIC);
 
   Time delay = m_periodicUpdateDelay + Seconds (m_rng->GetValue (0, m_periodicUpdateDelay.GetSeconds ()));
@@ -882,118 +1034,297 @@ EslrRoutingProtocol::DoSendRouteUpdate (eslr::UpdateType updateType)
 {
   NS_LOG_FUNCTION (this);
 
-  ESLRRoutingHeader hdr;
+  // acquiring an instance of the neighbor table
+  NeighborTable::NeighborTableInstance tempNeighbor;
+  m_neighborTable.ReturnNeighborTable (tempNeighbor);
+  NeighborTable::NeighborI it;
 
-  if (updateType == eslr::PERIODIC)
+  // the routes to be advertised
+  // NOTE:
+  //  Nothing is copied, the routes are read from the live M-table.
+  //  The table does not change while the update messages are generated.
+  //  The routes are advertised from the oldest to the newest route.
+  //  Triggered updates only take the changed routes from the changed route 
+  //  list of the table, instead of scanning the whole table.
+  //  With the route aggregation, the summaries depend on the unchanged routes too,
+  //  therefore the whole table is read and the unchanged RUMs are left out later.
+  std::vector<const RoutingTableEntry*> routes;
+  if ((updateType == eslr::PERIODIC) || m_routeAggregation)
   {
-    NS_LOG_LOGIC ("ESLR: Periodic Update");
-		hdr.SetPeriodicUpdate (true);    
+    const RoutingTable::RoutingTableInstance &mainTable = m_routing.GetMainRoutingTable ();
+    routes.reserve (mainTable.size ());
+    for (RoutingTable::RoutesCRI rtIter = mainTable.rbegin (); rtIter != mainTable.rend (); rtIter++)
+    {
+      routes.push_back (rtIter->first);
+    }
   }
-  else if (updateType == eslr::TRIGGERED)  
+  else
+    m_routing.GetChangedRoutes (routes);
+  std::vector<const RoutingTableEntry*>::const_iterator rtIter;
+
+  // The RUMs are built and encoded once for all the neighbors.
+  // The payloads of an interface are assembled from the encoded RUMs, leaving out
+  // the split-horizon routes of the interface, and shared by the neighbors of the 
+  // interface. Only the ESLR header, that carries the authentication data of 
+  // the neighbor, is written per neighbor.
+  std::vector<ESLRrum> rums;
+  std::vector<Ipv4Address> gateways;
+  std::vector<uint32_t> interfaces;
+  std::vector<bool> changed;
+  rums.reserve (routes.size ());
+  gateways.reserve (routes.size ());
+  interfaces.reserve (routes.size ());
+  changed.reserve (routes.size ());
+
+  for (rtIter = routes.begin (); rtIter != routes.end (); rtIter++)
   {
-    NS_LOG_LOGIC ("ESLR: Triggered Update");
-  		hdr.SetTrigUpdate (true);
+    bool isLocalHost = (((*rtIter)->GetDestNetwork () == "127.0.0.1") && 
+                        ((*rtIter)->GetDestNetworkMask () == Ipv4Mask::GetOnes ()));
+
+    // NOTE:  
+    //    Route about the local host is omitted.
+    //    Only changed routes are considered to reduce the advertisement packet size.
+    bool routeChanged = ((updateType == eslr::PERIODIC) || (*rtIter)->GetRouteChanged ());
+    if ((isLocalHost) || 
+        (!routeChanged && !m_routeAggregation) ||
+        ((*rtIter)->GetValidity () == eslr::INVALID)) // ignore the invalid route. 
+      continue;
+
+    ESLRrum rum;
+    if ((*rtIter)->GetValidity () == eslr::VALID)
+    {
+      rum.SetCbit (true);
+    }
+    else if ((*rtIter)->GetValidity () == eslr::DISCONNECTED)
+    {
+      rum.SetDbit (true);
+    } 
+    rum.SetSequenceNo (m_routing.GetAdvertisedSequenceNo (*rtIter));           
+    rum.SetMatric ((*rtIter)->GetMetric ());
+    rum.SetDestAddress ((*rtIter)->GetDestNetwork ());
+    rum.SetDestMask ((*rtIter)->GetDestNetworkMask ());
+
+    rums.push_back (rum);
+    gateways.push_back ((*rtIter)->GetGateway ());
+    interfaces.push_back ((*rtIter)->GetInterface ());
+    changed.push_back (routeChanged);
   }
 
-  // acquiring an instance of the neighbor table
-  NeighborTable::NeighborTableInstance tempNeighbor;
-  m_neighborTable.ReturnNeighborTable (tempNeighbor);
-  NeighborTable::NeighborI it;
+  // With the delta periodic updates, the update each route last changed in is kept.
+  // A periodic update carries the routes that changed since the oldest update 
+  // acknowledged by the neighbors of the interface.
+  bool sequenced = (m_deltaUpdates && updateType == eslr::PERIODIC);
+  if (m_deltaUpdates)
+    RecordRouteChanges (routes, updateType);
+
+  // The routes that left the advertised set are withdrawn by D-bit RUMs, that follow
+  // the advertised routes. Only the delta updates carry them, a full update replaces
+  // the advertisements the neighbors keep.
+  uint32_t nAdvertised = rums.size ();
+  if (sequenced && !m_routeAggregation)
+  {
+    std::set<uint64_t> advertisedKeys;
+    for (uint32_t i = 0; i < nAdvertised; i++)
+    {
+      advertisedKeys.insert (GetRumKey (rums[i]));
+    }
+    for (RouteChanges::const_iterator change = m_routeChanges.begin (); change != m_routeChanges.end (); change++)
+    {
+      if ((change->second.validity != eslr::INVALID) || 
+          (advertisedKeys.find (change->first) != advertisedKeys.end ()))
+        continue;
 
-  // acquiring an instance of the main routing table
-  // NOTE:
-  //  This instance is a separately created fresh instance of the M-table. 
-  //  remove it after you use it.
-  //  Done to accelerate the accessibility of the main routing table.
-	//  However, in ns-3, this method does not do any effect to the performance, 
-	//  hence it increases the memory usage.
-	//  In order to use this method more effective, we have to use threading.
-  RoutingTable::RoutingTableInstance tempMainTable;
-  m_routing.ReturnRoutingTable (tempMainTable, eslr::MAIN);
-  RoutingTable::RoutesI rtIter;
+      ESLRrum rum;
+      rum.SetDbit (true);
+      rum.SetDestAddress (Ipv4Address (uint32_t (change->first >> 32)));
+      rum.SetDestMask (Ipv4Mask (uint32_t (change->first)));
+      rums.push_back (rum);
+      gateways.push_back (Ipv4Address::GetZero ());
+      interfaces.push_back (0xffffffff); // no interface, never split-horizoned
+      changed.push_back (true);
+    }
+  }
+
+  std::vector<uint8_t> encoded;
+  if (!m_routeAggregation)
+    EncodeRums (rums, encoded);
+
+  // the update of each interface, built for the first neighbor of the interface
+  typedef std::map<uint32_t, InterfaceUpdate> InterfaceUpdates;
+  InterfaceUpdates interfaceUpdates;
 
   for (it = tempNeighbor.begin ();  it != tempNeighbor.end (); it++)
   {
     uint32_t interface = it->first->GetInterface ();
 
+    if (m_interfaceExclusions.find (interface) != m_interfaceExclusions.end ())
+      continue;
+
     Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol> ();
     Ipv4InterfaceAddress iface = l3->GetAddress (interface,0);
 
-    if (m_interfaceExclusions.find (interface) == m_interfaceExclusions.end ())
+    InterfaceUpdates::iterator update = interfaceUpdates.find (interface);
+    if (update == interfaceUpdates.end ())
     {
+      update = interfaceUpdates.insert (std::make_pair (interface, InterfaceUpdate ())).first;
+      update->second.compact = UseCompactRums (interface);
+
       // Calculating the Number of RUMs that can add to the ESLR Routing Header
-      uint16_t mtu = m_ipv4->GetMtu (interface);
-      uint16_t maxRum = (mtu - 
-                         Ipv4Header ().GetSerializedSize () - 
-                         UdpHeader ().GetSerializedSize () - 
-                         ESLRRoutingHeader ().GetSerializedSize ()
-                        ) / ESLRrum ().GetSerializedSize ();
-
-      Ptr<Packet> p = Create<Packet> ();
+      uint16_t maxRum = GetMaxRums (interface, sequenced);
+
+      // Calculating the space left for the compact RUMs
+      uint32_t compactSpace = 0;
+      if (update->second.compact)
+      {
+        ESLRRoutingHeader hdr;
+        hdr.SetCommand (eslr::RU);
+        hdr.SetSequenced (sequenced);
+        hdr.SetCompact (true);
+        uint32_t space = GetUpdateSpace (interface);
+        compactSpace = (space > hdr.GetSerializedSize ()) ? space - hdr.GetSerializedSize () : 0;
+      }
+
+      // NOTE:  
+      //    All split-horizon routes are omitted.
+      std::vector<uint32_t> selected;
+      selected.reserve (rums.size ());
+      for (uint32_t i = 0; i < rums.size (); i++)
+      {
+        bool splitHorizoning = (interfaces[i] == interface);
+        if (m_splitHorizonStrategy != (SPLIT_HORIZON && splitHorizoning))
+          selected.push_back (i);
+      }
+
+      if (m_routeAggregation)
+      {
+        // the summaries depend on the routes left after the split-horizon, 
+        // the RUMs of the interface are summarized and encoded on their own
+        // NOTE: the summaries do not map to the route changes, summarized updates are never deltas
+        std::vector<ESLRrum> interfaceRums;
+        std::vector<Ipv4Address> interfaceGateways;
+        std::vector<bool> interfaceChanged;
+        for (uint32_t i = 0; i < selected.size (); i++)
+        {
+          interfaceRums.push_back (rums[selected[i]]);
+          interfaceGateways.push_back (gateways[selected[i]]);
+          interfaceChanged.push_back (changed[selected[i]]);
+        }
+        Summaries summaries;
+        AggregateRums (interfaceRums, interfaceGateways, interfaceChanged, summaries);
+        WithdrawSummaries (interface, summaries, interfaceRums, interfaceChanged);
+
+        // a triggered update only carries the changed RUMs
+        if (updateType != eslr::PERIODIC)
+        {
+          uint32_t kept = 0;
+          for (uint32_t i = 0; i < interfaceRums.size (); i++)
+          {
+            if (interfaceChanged[i])
+              interfaceRums[kept++] = interfaceRums[i];
+          }
+          interfaceRums.resize (kept);
+        }
+
+        std::vector<uint8_t> interfaceEncoded;
+        EncodeRums (interfaceRums, interfaceEncoded);
+        selected.resize (interfaceRums.size ());
+        for (uint32_t i = 0; i < selected.size (); i++)
+        {
+          selected[i] = i;
+        }
+        if (sequenced)
+          update->second.digest = GetDigest (interfaceRums, selected);
+        if (update->second.compact)
+          BuildCompactPayloads (interfaceRums, selected, compactSpace, update->second.payloads);
+        else
+          BuildUpdatePayloads (interfaceRums, interfaceEncoded, selected, maxRum, update->second.payloads);
+      }
+      else
+      {
+        if (sequenced)
+        {
+          update->second.digest = GetDigest (rums, selected);
+
+          uint32_t acknowledged;
+          if (GetAcknowledgedUpdate (tempNeighbor, interface, acknowledged))
+          {
+            // only the routes changed after the acknowledged update are sent
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < selected.size (); i++)
+            {
+              RouteChanges::const_iterator change = m_routeChanges.find (GetRumKey (rums[selected[i]]));
+              if ((change == m_routeChanges.end ()) || (change->second.update > acknowledged))
+                selected[kept++] = selected[i];
+            }
+            NS_LOG_LOGIC ("ESLR: delta update on " << interface << " carries " << kept << " of " << selected.size () << " RUMs");
+            selected.resize (kept);
+            update->second.delta = true;
+          }
+          else
+          {
+            // a full update carries no withdrawal
+            while (!selected.empty () && selected.back () >= nAdvertised)
+              selected.pop_back ();
+          }
+        }
+        if (update->second.compact)
+          BuildCompactPayloads (rums, selected, compactSpace, update->second.payloads);
+        else
+          BuildUpdatePayloads (rums, encoded, selected, maxRum, update->second.payloads);
+      }
+
+      // a sequenced update is sent even if no route changed, it refreshes the routes of the neighbors
+      if (sequenced && update->second.payloads.empty ())
+      {
+        UpdatePayload payload;
+        payload.rums = Create<Packet> ();
+        update->second.payloads.push_back (payload);
+      }
+    }
+
+    const std::vector<UpdatePayload> &payloads = update->second.payloads;
+    for (std::vector<UpdatePayload>::const_iterator payload = payloads.begin (); 
+         payload != payloads.end (); 
+         payload++)
+    {
+      Ptr<Packet> p = payload->rums->Copy ();
       SocketIpTtlTag tag;
       p->RemovePacketTag (tag);
       tag.SetTtl (0);
       p->AddPacketTag (tag);
 
+      ESLRRoutingHeader hdr;
+      if (updateType == eslr::PERIODIC)
+        hdr.SetPeriodicUpdate (true);    
+      else if (updateType == eslr::TRIGGERED)  
+        hdr.SetTrigUpdate (true);
       hdr.SetCommand (eslr::RU);
       hdr.SetRuCommand (eslr::RESPONSE);
       hdr.SetRoutingTableRequestType (eslr::NON);
       hdr.SetAuthType (it->first->GetAuthType ()); // The Authentication type registered to the Nbr
       hdr.SetAuthData (it->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
-
-      for (rtIter = tempMainTable.begin (); rtIter != tempMainTable.end (); rtIter++)
+      hdr.SetCbit (payload->cBit);
+      hdr.SetDbit (payload->dBit);
+      hdr.SetNoe (payload->noe);
+      if (update->second.compact)
       {
-        bool splitHorizoning = (rtIter->first->GetInterface () == interface);
-
-        bool isLocalHost = ((rtIter->first->GetDestNetwork () == "127.0.0.1") && 
-                            (rtIter->first->GetDestNetworkMask () == Ipv4Mask::GetOnes ()));
-
-        // NOTE:  
-        //    All split-horizon routes are omitted.
-        //    Route about the local host is omitted.
-        //    Only changed routes are considered to reduce the advertisement packet size.
-        if ((m_splitHorizonStrategy != (SPLIT_HORIZON && splitHorizoning)) && 
-            (!isLocalHost) &&
-            (updateType == eslr::PERIODIC || rtIter->first->GetRouteChanged ()))
-        { 
-          ESLRrum rum;
-          if (rtIter->first->GetValidity () == eslr::INVALID)
-            continue; // ignore the invalid route. 
-          else if (rtIter->first->GetValidity () == eslr::VALID)
-          {
-            hdr.SetCbit (true);
-						rum.SetCbit (true);
-          }
-          else if (rtIter->first->GetValidity () == eslr::DISCONNECTED)
-          {
-            hdr.SetDbit (true);
-						rum.SetDbit (true);
-          } 
-					rum.SetSequenceNo (rtIter->first->GetSequenceNo () + 1);           
-          rum.SetMatric (rtIter->first->GetMetric ());
-          rum.SetDestAddress (rtIter->first->GetDestNetwork ());
-          rum.SetDestMask (rtIter->first->GetDestNetworkMask ());
-
-          hdr.AddRum (rum);
-        }
-        if (hdr.GetNoe () == maxRum)
-        {
-          p->AddHeader (hdr);
-          NS_LOG_LOGIC ("SendTo: " << *p);
-          
-          // send it via link local broadcast
-          it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (iface.GetBroadcast (), ESLR_MULT_PORT));
-          p->RemoveHeader (hdr);
-          hdr.ClearRums ();
-        }
+        hdr.SetCompact (true);
+        hdr.SetBaseSequence (payload->baseSequence);
       }
-      if (hdr.GetNoe () > 0)
+      if (sequenced)
       {
-        p->AddHeader (hdr);
-        NS_LOG_LOGIC ("SendTo: " << *p);
-        // send it via link local broadcast     
-        it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (iface.GetBroadcast (), ESLR_MULT_PORT));
+        hdr.SetSequenced (true);
+        hdr.SetDelta (update->second.delta);
+        hdr.SetUpdateSequence (uint16_t (m_updateSequence));
+        hdr.SetNMessages (payloads.size ());
+        hdr.SetDigest (update->second.digest);
       }
+
+      p->AddHeader (hdr);
+      NS_LOG_LOGIC ("SendTo: " << *p);
+      
+      // send it via link local broadcast
+      SendControlPacket (it->first->GetSocket (), p, iface.GetBroadcast (), ESLR_MULT_PORT, false);
     }
   }
   
@@ -1002,13 +1333,587 @@ EslrRoutingProtocol::DoSendRouteUpdate (eslr::UpdateType updateType)
   
   // In order to synchronize the SeqNo of local routes, increment those.
   m_routing.IncrementSeqNo ();
-  
-  // Finally clear out the created table instance of the main routing table.
-  tempMainTable.clear ();
   // Clear the temporary neighbor table instance
   tempNeighbor.clear ();
 }
 
+void
+EslrRoutingProtocol::EncodeRums (const std::vector<ESLRrum> &rums, std::vector<uint8_t> &encoded) const
+{
+  NS_LOG_FUNCTION (this << rums.size ());
+
+  encoded.clear ();
+  if (rums.empty ())
+    return;
+
+  Buffer buffer;
+  buffer.AddAtStart (rums.size () * RUM_SIZE);
+  Buffer::Iterator i = buffer.Begin ();
+  for (std::vector<ESLRrum>::const_iterator rum = rums.begin (); rum != rums.end (); rum++)
+  {
+    rum->Serialize (i);
+    i.Next (RUM_SIZE);
+  }
+
+  encoded.resize (buffer.GetSize ());
+  buffer.CopyData (&encoded[0], encoded.size ());
+}
+
+uint16_t
+EslrRoutingProtocol::GetMaxRums (uint32_t interface, bool sequenced) const
+{
+  ESLRRoutingHeader hdr;
+  hdr.SetCommand (eslr::RU);
+  hdr.SetSequenced (sequenced);
+
+  uint32_t space = GetUpdateSpace (interface);
+  if (space <= hdr.GetSerializedSize ())
+    return 1;
+
+  uint32_t maxRum = (space - hdr.GetSerializedSize ()) / ESLRrum ().GetSerializedSize ();
+  return std::max<uint32_t> (1, std::min<uint32_t> (maxRum, hdr.GetMaxNoe ()));
+}
+
+uint32_t
+EslrRoutingProtocol::GetUpdateSpace (uint32_t interface) const
+{
+  uint32_t mtu = m_ipv4->GetMtu (interface);
+  uint32_t overhead = Ipv4Header ().GetSerializedSize () + UdpHeader ().GetSerializedSize ();
+
+  return (mtu > overhead) ? mtu - overhead : 0;
+}
+
+bool
+EslrRoutingProtocol::IsUpdateFull (const ESLRRoutingHeader &hdr, uint32_t interface, uint16_t maxRum) const
+{
+  if (!hdr.GetCompact ())
+    return hdr.GetNoe () == maxRum;
+
+  // the size of the next compact RUM is not known, leave the space for the largest one
+  return (hdr.GetNoe () > 0) && 
+         ((hdr.GetNoe () == hdr.GetMaxNoe ()) || 
+          (hdr.GetSerializedSize () + COMPACT_RUM_MAX_SIZE > GetUpdateSpace (interface)));
+}
+
+bool
+EslrRoutingProtocol::UseCompactRums (uint32_t interface) const
+{
+  return m_compactUpdates && m_neighborTable.IsCompactInterface (interface);
+}
+
+void
+EslrRoutingProtocol::BuildCompactPayloads (const std::vector<ESLRrum> &rums, 
+                                           const std::vector<uint32_t> &selected, 
+                                           uint32_t space, 
+                                           std::vector<UpdatePayload> &payloads) const
+{
+  NS_LOG_FUNCTION (this << selected.size () << space);
+
+  uint16_t maxNoe = ESLRRoutingHeader ().GetMaxNoe ();
+  std::vector<uint32_t>::const_iterator first = selected.begin ();
+  while (first != selected.end ())
+  {
+    // the RUMs of a payload are coded against the sequence number of its first RUM
+    UpdatePayload payload;
+    payload.baseSequence = rums[*first].GetSequenceNo ();
+
+    uint32_t size = 0;
+    std::vector<uint32_t>::const_iterator last = first;
+    for (; last != selected.end () && payload.noe < maxNoe; last++)
+    {
+      uint32_t rumSize = rums[*last].GetCompactSize (payload.baseSequence);
+      if (payload.noe > 0 && size + rumSize > space)
+        break;
+      size += rumSize;
+      payload.cBit |= rums[*last].GetCbit ();
+      payload.dBit |= rums[*last].GetDbit ();
+      payload.noe++;
+    }
+
+    Buffer buffer;
+    buffer.AddAtStart (size);
+    Buffer::Iterator i = buffer.Begin ();
+    for (; first != last; first++)
+    {
+      i.Next (rums[*first].SerializeCompact (i, payload.baseSequence));
+    }
+
+    std::vector<uint8_t> bytes (size);
+    buffer.CopyData (&bytes[0], size);
+    payload.rums = Create<Packet> (&bytes[0], size);
+    payloads.push_back (payload);
+  }
+}
+
+void
+EslrRoutingProtocol::BuildUpdatePayloads (const std::vector<ESLRrum> &rums, 
+                                          const std::vector<uint8_t> &encoded, 
+                                          const std::vector<uint32_t> &selected, 
+                                          uint16_t maxRum, 
+                                          std::vector<UpdatePayload> &payloads) const
+{
+  NS_LOG_FUNCTION (this << selected.size () << maxRum);
+
+  std::vector<uint8_t> bytes;
+  bytes.reserve (std::min<uint32_t> (selected.size (), maxRum) * RUM_SIZE);
+  UpdatePayload payload;
+
+  for (std::vector<uint32_t>::const_iterator index = selected.begin (); index != selected.end (); index++)
+  {
+    const uint8_t *rum = &encoded[*index * RUM_SIZE];
+    bytes.insert (bytes.end (), rum, rum + RUM_SIZE);
+    payload.cBit |= rums[*index].GetCbit ();
+    payload.dBit |= rums[*index].GetDbit ();
+    payload.noe++;
+
+    if (payload.noe == maxRum)
+    {
+      payload.rums = Create<Packet> (&bytes[0], bytes.size ());
+      payloads.push_back (payload);
+      payload = UpdatePayload ();
+      bytes.clear ();
+    }
+  }
+  if (payload.noe > 0)
+  {
+    payload.rums = Create<Packet> (&bytes[0], bytes.size ());
+    payloads.push_back (payload);
+  }
+}
+
+void
+EslrRoutingProtocol::RecordRouteChanges (const std::vector<const RoutingTableEntry*> &routes, eslr::UpdateType updateType)
+{
+  NS_LOG_FUNCTION (this << routes.size ());
+
+  // A change is recorded against the first periodic update that carries it.
+  // NOTE:
+  //    The changed flag of a route is not used, the refresh of a main route from
+  //    its backup route sets it without changing what is advertised. 
+  //    Only a change of the advertised content is recorded.
+  // The periodic updates list the whole table, therefore the deleted routes are dropped.
+  uint32_t update = (updateType == eslr::PERIODIC) ? ++m_updateSequence : m_updateSequence + 1;
+
+  RouteChanges current;
+  for (std::vector<const RoutingTableEntry*>::const_iterator route = routes.begin (); route != routes.end (); route++)
+  {
+    uint64_t key = GetPrefixKey ((*route)->GetDestNetwork (), (*route)->GetDestNetworkMask ());
+    RouteChanges::const_iterator last = m_routeChanges.find (key);
+
+    RouteChange change;
+    change.metric = (*route)->GetMetric ();
+    change.validity = (*route)->GetValidity ();
+    if ((last != m_routeChanges.end ()) && 
+        (last->second.metric == change.metric) && 
+        (last->second.validity == change.validity))
+      change.update = last->second.update;
+    else
+      change.update = update; // a new route, or a new content
+
+    if (updateType == eslr::PERIODIC)
+      current[key] = change;
+    else
+      m_routeChanges[key] = change;
+  }
+
+  if (updateType == eslr::PERIODIC)
+  {
+    // A route that left the table is kept as withdrawn, until all the neighbors 
+    // acknowledged an update that carried the withdrawal.
+    bool acknowledged = !m_acknowledgedUpdates.empty ();
+    uint32_t oldest = 0;
+    for (AcknowledgedUpdates::const_iterator ack = m_acknowledgedUpdates.begin (); ack != m_acknowledgedUpdates.end (); ack++)
+    {
+      if ((ack == m_acknowledgedUpdates.begin ()) || (ack->second < oldest))
+        oldest = ack->second;
+    }
+
+    for (RouteChanges::const_iterator last = m_routeChanges.begin (); last != m_routeChanges.end (); last++)
+    {
+      if (current.find (last->first) != current.end ())
+        continue;
+
+      RouteChange withdrawal = last->second;
+      if (withdrawal.validity != eslr::INVALID)
+      {
+        withdrawal.validity = eslr::INVALID;
+        withdrawal.update = update;
+      }
+      if (acknowledged && (withdrawal.update > oldest))
+        current[last->first] = withdrawal;
+    }
+    m_routeChanges.swap (current);
+  }
+}
+
+bool
+EslrRoutingProtocol::GetAcknowledgedUpdate (const NeighborTable::NeighborTableInstance &neighbors, 
+                                            uint32_t interface, 
+                                            uint32_t &acknowledged) const
+{
+  NS_LOG_FUNCTION (this << interface);
+
+  bool found = false;
+  for (NeighborTable::NeighborCI it = neighbors.begin (); it != neighbors.end (); it++)
+  {
+    if ((it->first->GetInterface () != interface) || (it->first->GetValidity () != eslr::VALID))
+      continue;
+
+    AcknowledgedUpdates::const_iterator ack = m_acknowledgedUpdates.find (it->first->GetNeighborAddress ());
+    if (ack == m_acknowledgedUpdates.end ())
+      return false; // the neighbor needs a full update
+
+    if (!found || ack->second < acknowledged)
+      acknowledged = ack->second;
+    found = true;
+  }
+  return found;
+}
+
+/// Hash the route a RUM advertises (network, mask and metric)
+static uint32_t
+GetRumDigest (const ESLRrum &rum)
+{
+  uint8_t buffer[12];
+  rum.GetDestAddress ().Serialize (buffer);
+  Ipv4Address (rum.GetDestMask ().Get ()).Serialize (buffer + 4);
+  uint32_t metric = rum.GetMatric ();
+  buffer[8] = (metric >> 24) & 0xff;
+  buffer[9] = (metric >> 16) & 0xff;
+  buffer[10] = (metric >> 8) & 0xff;
+  buffer[11] = metric & 0xff;
+  return Hash32 (reinterpret_cast<const char*> (buffer), sizeof (buffer));
+}
+
+uint32_t
+EslrRoutingProtocol::GetDigest (const std::vector<ESLRrum> &rums, const std::vector<uint32_t> &selected) const
+{
+  // the DISCONNECTED routes are not kept by the neighbors, they are not in the digest
+  uint32_t digest = 0;
+  for (std::vector<uint32_t>::const_iterator index = selected.begin (); index != selected.end (); index++)
+  {
+    if (!rums[*index].GetDbit ())
+      digest ^= GetRumDigest (rums[*index]);
+  }
+  return digest;
+}
+
+void
+EslrRoutingProtocol::HandleSequencedUpdate (ESLRRoutingHeader hdr, Ipv4Address senderAddress, uint32_t incomingInterface)
+{
+  NS_LOG_FUNCTION (this << senderAddress << incomingInterface);
+
+  NeighborAdvertisements &advertised = m_neighborAdvertisements[senderAddress];
+
+  if (hdr.GetSequenced () && (!advertised.receiving || advertised.sequence != hdr.GetUpdateSequence ()))
+  {
+    // the first message of a periodic update
+    advertised.receiving = true;
+    advertised.sequence = hdr.GetUpdateSequence ();
+    advertised.nReceived = 0;
+    advertised.carried.clear ();
+    if (!hdr.GetDelta ())
+      advertised.rums.clear ();
+  }
+
+  // keep the latest advertisement of each prefix
+  std::list<ESLRrum> rums = hdr.GetRumList ();
+  for (std::list<ESLRrum>::const_iterator it = rums.begin (); it != rums.end (); it++)
+  {
+    uint64_t key = GetRumKey (*it);
+    if (hdr.GetSequenced ())
+      advertised.carried.insert (key);
+    if (it->GetDbit ())
+      advertised.rums.erase (key);
+    else
+      advertised.rums[key] = *it;
+  }
+
+  HandleRouteResponses (hdr, senderAddress, incomingInterface);
+
+  if (!hdr.GetSequenced ())
+    return; // triggered updates are not acknowledged
+
+  advertised.nReceived++;
+  if (advertised.nReceived < hdr.GetNMessages ())
+    return;
+  advertised.receiving = false;
+
+  uint32_t digest = 0;
+  for (NeighborAdvertisements::Rums::const_iterator it = advertised.rums.begin (); it != advertised.rums.end (); it++)
+  {
+    digest ^= GetRumDigest (it->second);
+  }
+
+  if (digest != hdr.GetDigest ())
+  {
+    // The kept advertisements diverged from the table of the neighbor, start over with a full update.
+    // They are not replayed, as they may hold the routes the neighbor withdrew.
+    NS_LOG_DEBUG ("ESLR: the digest of " << senderAddress << " does not match, asking for a full update");
+    advertised.rums.clear ();
+    advertised.carried.clear ();
+    SendUpdateAcknowledgement (senderAddress, eslr::RESYNC, hdr.GetUpdateSequence (), digest);
+    return;
+  }
+
+  if (hdr.GetDelta ())
+  {
+    // The routes that did not change are not carried by a delta update.
+    // They are refreshed from the kept advertisements, as if a full update was received.
+    // The routes carried by the update were already handled.
+    ESLRRoutingHeader refresh;
+    for (NeighborAdvertisements::Rums::const_iterator it = advertised.rums.begin (); it != advertised.rums.end (); it++)
+    {
+      if (advertised.carried.find (it->first) == advertised.carried.end ())
+        refresh.AddRum (it->second);
+    }
+    HandleRouteResponses (refresh, senderAddress, incomingInterface);
+  }
+  advertised.carried.clear ();
+
+  SendUpdateAcknowledgement (senderAddress, eslr::ACKNOWLEDGE, hdr.GetUpdateSequence (), digest);
+}
+
+void
+EslrRoutingProtocol::SendUpdateAcknowledgement (Ipv4Address neighbor, 
+                                                eslr::EslrHeaderRUCommand command, 
+                                                uint16_t sequence, 
+                                                uint32_t digest)
+{
+  NS_LOG_FUNCTION (this << neighbor << command << sequence);
+
+  NeighborTable::NeighborI neighborRecord;
+  if (!m_neighborTable.FindValidNeighborForAddress (neighbor, neighborRecord))
+  {
+    NS_LOG_LOGIC ("ESLR: No valid neighbor found for " << neighbor << ", returning!.");
+    return;
+  }
+
+  Ptr<Packet> p = Create<Packet> ();
+  SocketIpTtlTag tag;
+  p->RemovePacketTag (tag);
+  tag.SetTtl (0);
+  p->AddPacketTag (tag);
+
+  ESLRRoutingHeader hdr;
+  hdr.SetCommand (eslr::RU);
+  hdr.SetRuCommand (command);
+  hdr.SetRoutingTableRequestType (eslr::NON);
+  hdr.SetAuthType (neighborRecord->first->GetAuthType ()); // The Authentication type registered to the Nbr
+  hdr.SetAuthData (neighborRecord->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
+  hdr.SetSequenced (true);
+  hdr.SetUpdateSequence (sequence);
+  hdr.SetDigest (digest);
+
+  p->AddHeader (hdr);
+  NS_LOG_LOGIC ("SendTo: " << *p);
+
+  // the acknowledgements are sent to the neighbor only
+  SendControlPacket (neighborRecord->first->GetSocket (), p, neighbor, ESLR_MULT_PORT, false);
+}
+
+void
+EslrRoutingProtocol::HandleUpdateAcknowledgement (ESLRRoutingHeader hdr, Ipv4Address senderAddress)
+{
+  NS_LOG_FUNCTION (this << senderAddress << hdr);
+
+  if (!hdr.GetSequenced ())
+    return;
+
+  if (hdr.GetRuCommand () == eslr::RESYNC)
+  {
+    // the next periodic update of the interface is a full update
+    NS_LOG_DEBUG ("ESLR: " << senderAddress << " asked for a full update");
+    m_acknowledgedUpdates.erase (senderAddress);
+    return;
+  }
+
+  // the sequence number is carried in 16 bits, it is taken relative to the last periodic update
+  uint16_t age = uint16_t (m_updateSequence) - hdr.GetUpdateSequence ();
+  if (age > m_updateSequence)
+    return;
+  uint32_t acknowledged = m_updateSequence - age;
+
+  AcknowledgedUpdates::iterator ack = m_acknowledgedUpdates.find (senderAddress);
+  if (ack == m_acknowledgedUpdates.end ())
+    m_acknowledgedUpdates[senderAddress] = acknowledged;
+  else if (ack->second < acknowledged)
+    ack->second = acknowledged;
+}
+
+/// Build the key of a prefix, ordered by the prefix length first
+static uint64_t
+GetAggregationKey (uint32_t length, uint32_t network)
+{
+  return (uint64_t (length) << 32) | network;
+}
+
+/// Return the mask of a prefix length
+static Ipv4Mask
+GetMaskOfLength (uint32_t length)
+{
+  return Ipv4Mask (length == 0 ? 0 : (0xffffffff << (32 - length)));
+}
+
+void 
+EslrRoutingProtocol::AggregateRums (std::vector<ESLRrum> &rums, 
+                                    std::vector<Ipv4Address> &gateways, 
+                                    std::vector<bool> &changed, 
+                                    Summaries &summaries)
+{
+  NS_LOG_FUNCTION (this << rums.size ());
+
+  // (prefix length, network) -> position of a VALID RUM
+  typedef std::map<uint64_t, uint32_t> Prefixes;
+  Prefixes prefixes;
+  std::set<uint64_t> broken; // prefixes of the DISCONNECTED routes
+  std::vector<bool> merged (rums.size (), false);
+  std::vector<bool> summarized (rums.size (), false);
+  std::vector<uint32_t> minMetrics (rums.size ());
+
+  for (uint32_t i = 0; i < rums.size (); i++)
+  {
+    minMetrics[i] = rums[i].GetMatric ();
+    uint64_t key = GetAggregationKey (rums[i].GetDestMask ().GetPrefixLength (), rums[i].GetDestAddress ().Get ());
+    if (rums[i].GetDbit ())
+      broken.insert (key); // the broken routes are advertised as they are
+    else
+      prefixes[key] = i;
+  }
+
+  // Merge the sibling prefixes, from the longest to the shortest.
+  // A summary takes the place of its lower half, and can be merged again at the next length.
+  for (uint32_t length = 32; length > 0; length--)
+  {
+    Prefixes::iterator prefix = prefixes.lower_bound (GetAggregationKey (length, 0));
+    Prefixes::iterator last = prefixes.lower_bound (GetAggregationKey (length + 1, 0));
+    while (prefix != last)
+    {
+      uint32_t network = uint32_t (prefix->first);
+      uint32_t bit = 1u << (32 - length);
+      uint64_t parent = GetAggregationKey (length - 1, network);
+      Prefixes::iterator sibling = prefixes.end ();
+      if (((network & bit) == 0) && 
+          (prefixes.find (parent) == prefixes.end ()) && 
+          (broken.find (parent) == broken.end ()))
+        sibling = prefixes.find (GetAggregationKey (length, network | bit));
+
+      if (sibling == prefixes.end ())
+      {
+        prefix++;
+        continue;
+      }
+
+      uint32_t lower = prefix->second;
+      uint32_t upper = sibling->second;
+      uint32_t maxMetric = std::max (rums[lower].GetMatric (), rums[upper].GetMatric ());
+      uint32_t minMetric = std::min (minMetrics[lower], minMetrics[upper]);
+
+      if ((gateways[lower] != gateways[upper]) || 
+          (maxMetric > minMetric * (1.0 + m_aggregationMetricError)))
+      {
+        prefix++;
+        continue;
+      }
+
+      // the summary advertises the worst metric of the merged routes
+      rums[lower].SetDestAddress (Ipv4Address (network));
+      rums[lower].SetDestMask (GetMaskOfLength (length - 1));
+      rums[lower].SetMatric (maxMetric);
+      rums[lower].SetSequenceNo (std::max (rums[lower].GetSequenceNo (), rums[upper].GetSequenceNo ()));
+      minMetrics[lower] = minMetric;
+      changed[lower] = changed[lower] || changed[upper];
+      summarized[lower] = true;
+      merged[upper] = true;
+
+      prefixes[parent] = lower;
+      Prefixes::iterator next = prefix;
+      next++;
+      if (next == sibling)
+        next++;
+      prefixes.erase (sibling);
+      prefixes.erase (prefix);
+      prefix = next;
+    }
+  }
+
+  summaries.clear ();
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < rums.size (); i++)
+  {
+    if (merged[i])
+      continue;
+    if (summarized[i])
+      summaries[GetRumKey (rums[i])] = rums[i];
+    rums[kept] = rums[i];
+    gateways[kept] = gateways[i];
+    changed[kept] = changed[i];
+    kept++;
+  }
+  NS_LOG_LOGIC ("ESLR: aggregated " << rums.size () << " RUMs in to " << kept);
+  rums.resize (kept);
+  gateways.resize (kept);
+  changed.resize (kept);
+}
+
+void
+EslrRoutingProtocol::WithdrawSummaries (uint32_t interface, 
+                                        const Summaries &summaries, 
+                                        std::vector<ESLRrum> &rums, 
+                                        std::vector<bool> &changed)
+{
+  NS_LOG_FUNCTION (this << interface << summaries.size ());
+
+  Summaries &advertised = m_advertisedSummaries[interface];
+
+  std::set<uint64_t> keys;
+  for (uint32_t i = 0; i < rums.size (); i++)
+  {
+    keys.insert (GetRumKey (rums[i]));
+  }
+
+  // the summaries advertised before and not produced anymore
+  std::vector<ESLRrum> dropped;
+  for (Summaries::const_iterator old = advertised.begin (); old != advertised.end (); old++)
+  {
+    if (summaries.find (old->first) == summaries.end ())
+      dropped.push_back (old->second);
+  }
+
+  // The routes a dropped summary covered are advertised again, as the neighbors 
+  // only knew them through the summary. So are the new summaries.
+  for (uint32_t i = 0; i < rums.size (); i++)
+  {
+    uint64_t key = GetRumKey (rums[i]);
+    if ((summaries.find (key) != summaries.end ()) && (advertised.find (key) == advertised.end ()))
+      changed[i] = true;
+
+    for (std::vector<ESLRrum>::const_iterator summary = dropped.begin (); summary != dropped.end (); summary++)
+    {
+      if ((rums[i].GetDestMask ().GetPrefixLength () >= summary->GetDestMask ().GetPrefixLength ()) && 
+          (rums[i].GetDestAddress ().CombineMask (summary->GetDestMask ()) == summary->GetDestAddress ()))
+        changed[i] = true;
+    }
+  }
+
+  // A dropped summary is withdrawn, unless its prefix is still advertised as a route
+  for (std::vector<ESLRrum>::const_iterator summary = dropped.begin (); summary != dropped.end (); summary++)
+  {
+    if (keys.find (GetRumKey (*summary)) != keys.end ())
+      continue;
+
+    NS_LOG_LOGIC ("ESLR: withdraw the summary " << summary->GetDestAddress () << 
+                  "/" << summary->GetDestMask ().GetPrefixLength () << " on " << interface);
+    ESLRrum withdrawal = *summary;
+    withdrawal.SetCbit (false);
+    withdrawal.SetDbit (true);
+    rums.push_back (withdrawal);
+    changed.push_back (true);
+  }
+
+  advertised = summaries;
+}
+
 void 
 EslrRoutingProtocol::Receive (Ptr<Socket> socket)
 {
@@ -1119,6 +2024,11 @@ EslrRoutingProtocol::Receive (Ptr<Socket> socket)
 						std::cout << m_nodeId << " received a Fast triggered update message from " << senderAddress << std::endl;					
 						HandleFastTrigUpdates (hdr, senderAddress, ipInterfaceIndex);
 					}
+					else if (m_deltaUpdates && (hdr.GetPeriodicUpdate () || hdr.GetTrigUpdate ()))
+					{
+						// the advertisements of the neighbor are kept to complete the delta updates
+						HandleSequencedUpdate (hdr, senderAddress, ipInterfaceIndex);
+					}
 					else if (hdr.GetPeriodicUpdate () || hdr.GetTrigUpdate () || hdr.GetAdvertisementType () == 0)
 					{
 						// For periodic, triggered, and route response messages, ESLR shares the same method
@@ -1136,6 +2046,20 @@ EslrRoutingProtocol::Receive (Ptr<Socket> socket)
           return;           
         }	
       }      
+      else if ((hdr.GetRuCommand () == eslr::ACKNOWLEDGE) || (hdr.GetRuCommand () == eslr::RESYNC))
+      {
+        if ((neighborRecord->first->GetValidity () == eslr::VALID) &&
+             (hdr.GetAuthType () == neighborRecord->first->GetAuthType ()) &&
+             (hdr.GetAuthData () == neighborRecord->first->GetAuthData ()))
+        {
+          HandleUpdateAcknowledgement (hdr, senderAddress);
+        }
+        else
+        {
+          NS_LOG_LOGIC ("ESLR:Authentication FAILED for " << senderAddress);
+          return;           
+        }	
+      }
     }
     else
     {
@@ -1255,7 +2179,7 @@ EslrRoutingProtocol::HandleFastTrigUpdates (ESLRRoutingHeader hdr, Ipv4Address s
                 NS_LOG_LOGIC ("ESLR: Send a fast triggered update to " << itNbr->first->GetNeighborAddress ());
                 
                 Ipv4Address broadAddress = itNbr->first->GetNeighborAddress ().GetSubnetDirectedBroadcast (itNbr->first->GetNeighborMask ());
-                itNbr->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+                SendControlPacket (itNbr->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, true);
 
 				        p->RemoveHeader (hdrSend);
 								hdrSend.ClearRums ();
@@ -1371,6 +2295,7 @@ EslrRoutingProtocol::HandleKamRequests (ESLRRoutingHeader hdr, Ipv4Address sende
                                                                     receivedSocket, iter->GetAuthType (),
                                                                     iter->GetAuthData (), iter->GetIdentifier (),
 																																		eslr::VOID);
+				newNeighbor->SetCompactRums (iter->GetCompactRums ());
 				m_neighborTable.AddVoidNeighbor (newNeighbor, m_neighborTimeoutDelay);
 
 				NS_LOG_DEBUG ("ESLR: Send a Hello message to newly discovered neighbor");
@@ -1390,6 +2315,7 @@ EslrRoutingProtocol::HandleKamRequests (ESLRRoutingHeader hdr, Ipv4Address sende
 
 				KAMHeader helloHdr;
 				helloHdr.SetCommand (eslr::HELLO);
+				helloHdr.SetCompactRums (m_compactUpdates);
     		helloHdr.SetAuthType (iter->GetAuthType ());
     		helloHdr.SetAuthData (iter->GetAuthData ());
 		    helloHdr.SetNeighborID ((uint16_t)genarateNeighborID ());
@@ -1407,7 +2333,7 @@ EslrRoutingProtocol::HandleKamRequests (ESLRRoutingHeader hdr, Ipv4Address sende
 				if (m_interfaceExclusions.find (incomingInterface) == m_interfaceExclusions.end ())
 				{
 					NS_LOG_LOGIC ("ESLR: Send a hello message to: " << iface.GetBroadcast () << " " << *p);
-					receivedSocket->SendTo (p, 0, InetSocketAddress (iface.GetBroadcast (), ESLR_BROAD_PORT));
+					SendControlPacket (receivedSocket, p, iface.GetBroadcast (), ESLR_BROAD_PORT, false);
 				}
   
 				// REQ procedure
@@ -1437,12 +2363,11 @@ EslrRoutingProtocol::HandleKamRequests (ESLRRoutingHeader hdr, Ipv4Address sende
 				if (m_interfaceExclusions.find (incomingInterface) == m_interfaceExclusions.end ())
 				{
 					NS_LOG_LOGIC ("ESLR: Send a REQ message to: " << iface.GetBroadcast () << " " << *req);
-					receivedSocket->SendTo (req, 
-																	0, 
-																	InetSocketAddress (
-																	iter->GetGateway ().GetSubnetDirectedBroadcast (
-																	iter->GetGatewayMask ()), 
-																	ESLR_MULT_PORT));
+					SendControlPacket (receivedSocket, 
+														 req, 
+														 iter->GetGateway ().GetSubnetDirectedBroadcast (iter->GetGatewayMask ()), 
+														 ESLR_MULT_PORT, 
+														 false);
 				}
 			}
 			else if (iter->Getcommand () == HI)// ESLR KAM messages
@@ -1472,6 +2397,7 @@ EslrRoutingProtocol::HandleKamRequests (ESLRRoutingHeader hdr, Ipv4Address sende
 																										 neighborRecord->first->GetAuthData (),
 																										 neighborRecord->first->GetIdentifier (),
 					 																					 eslr::VALID);
+					existingNeighbor->SetCompactRums (iter->GetCompactRums ());
 					 																				 
 					m_neighborTable.UpdateNeighbor (existingNeighbor, m_neighborTimeoutDelay, 
           	                              m_garbageCollectionDelay);	
@@ -1536,6 +2462,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
                                                    neighborRecord->first->GetAuthType (),
                                                    neighborRecord->first->GetAuthData (),
                                                    eslr::VALID);
+      existingNeighbor->SetCompactRums (neighborRecord->first->GetCompactRums ());
 
       m_neighborTable.UpdateNeighbor (existingNeighbor, m_neighborTimeoutDelay,
                                           m_garbageCollectionDelay);		
@@ -1543,17 +2470,12 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
 			// Send the Entire MTable to the newly discovered neighbor 
 			NS_LOG_DEBUG ("ESLR: Send routing table to " << senderAddress);
     	
-			// acquiring an instance of the main routing table
-    	RoutingTable::RoutingTableInstance tempMainTable;
-    	m_routing.ReturnRoutingTable (tempMainTable, eslr::MAIN);
-    	RoutingTable::RoutesI rtIter;
+			// read only view of the main routing table
+    	const RoutingTable::RoutingTableInstance &mainTable = m_routing.GetMainRoutingTable ();
+    	RoutingTable::RoutesCRI rtIter;
     	
 			// Calculating the Number of RUMs that can add to the ESLR Routing Header
-    	uint16_t mtu = m_ipv4->GetMtu (incomingInterface);
-    	uint16_t maxRum = (mtu - 
-    	                   Ipv4Header ().GetSerializedSize () - 
-     	                   UdpHeader ().GetSerializedSize () - 
-                       	 ESLRRoutingHeader ().GetSerializedSize ()) / ESLRrum ().GetSerializedSize ();
+    	uint16_t maxRum = GetMaxRums (incomingInterface, false);
 
     	Ptr<Packet> p = Create<Packet> ();
     	SocketIpTtlTag tag;
@@ -1568,8 +2490,9 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	hdr.SetAuthType (neighborRecord->first->GetAuthType ()); // The Authentication type registered to the Nbr
     	hdr.SetAuthData (neighborRecord->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
     	hdr.SetAdvertisementTypeZero ();
+    	hdr.SetCompact (UseCompactRums (incomingInterface));
 
-    	for (rtIter = tempMainTable.begin (); rtIter != tempMainTable.end (); rtIter++)
+    	for (rtIter = mainTable.rbegin (); rtIter != mainTable.rend (); rtIter++)
     	{
      		bool splitHorizoning = (rtIter->first->GetInterface () == incomingInterface);
 
@@ -1583,7 +2506,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
        	   (rtIter->first->GetValidity () == eslr::VALID))
       	{
         	ESLRrum rum;
-        	rum.SetSequenceNo (rtIter->first->GetSequenceNo () + 1);
+        	rum.SetSequenceNo (m_routing.GetAdvertisedSequenceNo (rtIter->first));
         	rum.SetMatric (rtIter->first->GetMetric ());
         	rum.SetDestAddress (rtIter->first->GetDestNetwork ());
         	rum.SetDestMask (rtIter->first->GetDestNetworkMask ());
@@ -1591,13 +2514,13 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
 
         	hdr.AddRum (rum);
       	}
-      	if (hdr.GetNoe () == maxRum)
+      	if (IsUpdateFull (hdr, incomingInterface, maxRum))
       	{
         	NS_LOG_DEBUG ("ESLR: reply to the request came from " << senderAddress);      	
         	p->AddHeader (hdr);
        		 
         	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (neighborRecord->first->GetNeighborMask ()); 
-        	neighborRecord->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_BROAD_PORT));
+        	SendControlPacket (neighborRecord->first->GetSocket (), p, broadAddress, ESLR_BROAD_PORT, false);
         	
         	p->RemoveHeader (hdr);
         	hdr.ClearRums ();
@@ -1609,11 +2532,8 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
       	p->AddHeader (hdr);
    
       	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (neighborRecord->first->GetNeighborMask ());  
-      	neighborRecord->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_BROAD_PORT));
+      	SendControlPacket (neighborRecord->first->GetSocket (), p, broadAddress, ESLR_BROAD_PORT, false);
     	}        
-  
-  		// Finally clear out the created table instance of the main routing table.
-  		tempMainTable.clear ();  
 
   		// As neighbor Discovery is finish now, schedule KAM 
   		Time sendKam = Seconds (m_rng->GetValue (0, m_kamTimer.GetSeconds ()));
@@ -1628,10 +2548,9 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
   	NeighborTable::NeighborI it;
   	bool foundNeighbor =  m_neighborTable.FindValidNeighborForAddress (senderAddress, it);
   
-  	// acquiring an instance of the main routing table
-  	RoutingTable::RoutingTableInstance tempMainTable;
-  	m_routing.ReturnRoutingTable (tempMainTable, eslr::MAIN);
-  	RoutingTable::RoutesI rtIter;  
+  	// read only view of the main routing table
+  	const RoutingTable::RoutingTableInstance &mainTable = m_routing.GetMainRoutingTable ();
+  	RoutingTable::RoutesCRI rtIter;  
   
   	if (!foundNeighbor)
   	{
@@ -1656,6 +2575,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	hdr.SetRoutingTableRequestType (eslr::NON);
     	hdr.SetAuthType (it->first->GetAuthType ()); // The Authentication type registered to the Nbr
     	hdr.SetAuthData (it->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
+    	hdr.SetCompact (UseCompactRums (incomingInterface));
     
     	// find the route record matches the destination address given in the RUM
     	// in this case the valid routes are only considered.
@@ -1673,7 +2593,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     
     	ESLRrum rum;
 
-    	rum.SetSequenceNo (foundRoute->first->GetSequenceNo () + 1);
+    	rum.SetSequenceNo (m_routing.GetAdvertisedSequenceNo (foundRoute->first));
     	rum.SetMatric (foundRoute->first->GetMetric ());
    	 	rum.SetDestAddress (foundRoute->first->GetDestNetwork ());
     	rum.SetDestMask (foundRoute->first->GetDestNetworkMask ());
@@ -1684,19 +2604,14 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	NS_LOG_DEBUG ("ESLR: reply to the request came from " << senderAddress);
  
     	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());  
-    	it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));    
+    	SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);    
   	}
   	else if (reqType == eslr::NE)
   	{
     	NS_LOG_LOGIC("ESLR: " << senderAddress << " Requested set of records.");
     
     	// Calculating the Number of RUMs that can add to the ESLR Routing Header
-    	uint16_t mtu = m_ipv4->GetMtu (incomingInterface);
-    	uint16_t maxRum = (mtu - 
-                       Ipv4Header ().GetSerializedSize () - 
-                       UdpHeader ().GetSerializedSize () -  
-                       ESLRRoutingHeader ().GetSerializedSize ()
-                      ) / ESLRrum ().GetSerializedSize ();    
+    	uint16_t maxRum = GetMaxRums (incomingInterface, false);    
 
     	Ptr<Packet> p = Create<Packet> ();
     	SocketIpTtlTag tag;
@@ -1710,6 +2625,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	hdr.SetRoutingTableRequestType (eslr::NON);
     	hdr.SetAuthType (it->first->GetAuthType ()); // The Authentication type registered to the Nbr
     	hdr.SetAuthData (it->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
+    	hdr.SetCompact (UseCompactRums (incomingInterface));
 
     	RoutingTable::RoutesI foundRoute;
     	bool foundInMain;        
@@ -1730,14 +2646,14 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
       	ESLRrum rum;
 
       	// Splithorizon is not considered. 
-      	rum.SetSequenceNo (foundRoute->first->GetSequenceNo () + 1);
+      	rum.SetSequenceNo (m_routing.GetAdvertisedSequenceNo (foundRoute->first));
       	rum.SetMatric (foundRoute->first->GetMetric ());
       	rum.SetDestAddress (foundRoute->first->GetDestNetwork ());
       	rum.SetDestMask (foundRoute->first->GetDestNetworkMask ());
 
       	hdr.AddRum (rum);      
 
-      	if (hdr.GetNoe () == maxRum)
+      	if (IsUpdateFull (hdr, incomingInterface, maxRum))
       	{
         	p->AddHeader (hdr);
         
@@ -1745,7 +2661,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
         
         	// use the link local broadcast
         	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());  
-        	it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+        	SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
         
         	p->RemoveHeader (hdr);
         	hdr.ClearRums ();
@@ -1758,7 +2674,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
       
       	// use the link local broadcast
       	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());  
-      	it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+      	SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
     	} 
   	}
   	else if (reqType == eslr::ET)
@@ -1766,12 +2682,7 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	NS_LOG_LOGIC("ESLR: " << senderAddress << " Requested entire routing table.");
 
     	// Calculating the Number of RUMs that can add to the ESLR Routing Header
-    	uint16_t mtu = m_ipv4->GetMtu (incomingInterface);
-    	uint16_t maxRum = (mtu - 
-    	                   Ipv4Header ().GetSerializedSize () - 
-     	                   UdpHeader ().GetSerializedSize () - 
-                         ESLRRoutingHeader ().GetSerializedSize ()
-                         ) / ESLRrum ().GetSerializedSize ();
+    	uint16_t maxRum = GetMaxRums (incomingInterface, false);
 
     	Ptr<Packet> p = Create<Packet> ();
     	SocketIpTtlTag tag;
@@ -1785,8 +2696,9 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
     	hdr.SetRoutingTableRequestType (eslr::NON);
     	hdr.SetAuthType (it->first->GetAuthType ()); // The Authentication type registered to the Nbr
     	hdr.SetAuthData (it->first->GetAuthData ()); // The Authentication phrase registered to the Nbr
+    	hdr.SetCompact (UseCompactRums (incomingInterface));
     
-    	for (rtIter = tempMainTable.begin (); rtIter != tempMainTable.end (); rtIter++)
+    	for (rtIter = mainTable.rbegin (); rtIter != mainTable.rend (); rtIter++)
     	{
      		bool splitHorizoning = (rtIter->first->GetInterface () == incomingInterface);
 
@@ -1801,21 +2713,21 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
       	{ 
         	ESLRrum rum;
 
-        	rum.SetSequenceNo (rtIter->first->GetSequenceNo () + 1);
+        	rum.SetSequenceNo (m_routing.GetAdvertisedSequenceNo (rtIter->first));
         	rum.SetMatric (rtIter->first->GetMetric ());
         	rum.SetDestAddress (rtIter->first->GetDestNetwork ());
         	rum.SetDestMask (rtIter->first->GetDestNetworkMask ());
 
         	hdr.AddRum (rum);
       	}
-      	if (hdr.GetNoe () == maxRum)
+      	if (IsUpdateFull (hdr, incomingInterface, maxRum))
       	{
         	p->AddHeader (hdr);
         
         	NS_LOG_DEBUG ("ESLR: reply to the request came from " << senderAddress);
        		 
         	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());  
-        	it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+        	SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
         	p->RemoveHeader (hdr);
         	hdr.ClearRums ();
       	}
@@ -1826,13 +2738,10 @@ EslrRoutingProtocol::HandleRouteRequests (ESLRRoutingHeader hdr, Ipv4Address sen
       	NS_LOG_DEBUG ("ESLR: reply to the request came from " << senderAddress);
    
       	Ipv4Address broadAddress = senderAddress.GetSubnetDirectedBroadcast (it->first->GetNeighborMask ());  
-      	it->first->GetSocket ()->SendTo (p, 0, InetSocketAddress (broadAddress, ESLR_MULT_PORT));
+      	SendControlPacket (it->first->GetSocket (), p, broadAddress, ESLR_MULT_PORT, false);
     	}        
   	  // In order to synchronize the SeqNo of local routes, increment those.
   		//m_routing.IncrementSeqNo ();
-  
-  		// Finally clear out the created table instance of the main routing table.
-  		tempMainTable.clear ();  
 		}
 	}
 }
@@ -1850,9 +2759,16 @@ EslrRoutingProtocol::HandleRouteResponses (ESLRRoutingHeader hdr, Ipv4Address se
   
   std::list<ESLRrum> rums = hdr.GetRumList ();
 	bool invalidatedInMain = false, invalidatedInBakcup = false;
+
+  // Routes to new destinations are collected and added to the tables at once
+  std::vector<RoutingTableEntry> newRoutes;
   for (std::list<ESLRrum>::iterator it = rums.begin (); it != rums.end (); it++)
   {
-    if (m_routing.IsLocalRouteAvailable (it->GetDestAddress (), it->GetDestMask ()))
+    // One lookup gives the main, primary and backup routes of the destination
+    RoutingTable::RouteSet routeSet;
+    m_routing.FindRouteSet (it->GetDestAddress (), it->GetDestMask (), routeSet);
+
+    if (routeSet.hasLocalRoute)
     {
       NS_LOG_LOGIC ("ESLR: Route is about my local network. Skip the RUM");
       continue;
@@ -1879,21 +2795,13 @@ EslrRoutingProtocol::HandleRouteResponses (ESLRRoutingHeader hdr, Ipv4Address se
       uint32_t lrCost = CalculateLRCost (m_ipv4->GetNetDevice (incomingInterface));
       uint32_t slrCost = it->GetMatric () + lrCost;
 
-      RoutingTable::RoutesI primaryRoute, secondaryRoute, mainRoute;
-      bool foundPrimary, foundSecondary, foundMain;
-
-      // Find the main route
-      foundMain = m_routing.FindRouteRecord (it->GetDestAddress (), it->GetDestMask (), mainRoute, eslr::MAIN);
+      // The primary route represents the main route
+      RoutingTable::RoutesI primaryRoute = routeSet.primaryRoute;
+      bool foundPrimary = routeSet.foundPrimary;
       
-      // Find the primary route, which represents the main route
-      foundPrimary = m_routing.FindRouteInBackup (it->GetDestAddress (), 
-                                                  it->GetDestMask (), 
-                                                  primaryRoute, eslr::PRIMARY);
-      
-      // Find the backup route
-      foundSecondary = m_routing.FindRouteInBackup (it->GetDestAddress (), 
-                                                    it->GetDestMask (), 
-                                                    secondaryRoute, eslr::SECONDARY);
+      // The backup route
+      RoutingTable::RoutesI secondaryRoute = routeSet.secondaryRoute;
+      bool foundSecondary = routeSet.foundSecondary;
       
       if (!foundPrimary)// && !foundSecondary)
       {
@@ -1902,28 +2810,17 @@ EslrRoutingProtocol::HandleRouteResponses (ESLRRoutingHeader hdr, Ipv4Address se
         // specifically settling time is set to zero
         NS_LOG_LOGIC ("ESLR: New network received. Add it to both Main an Backup tables.");
 
-        AddNetworkRouteTo ( it->GetDestAddress (), 
-                            it->GetDestMask (), 
-                            senderAddress, 
-                            incomingInterface, 
-                            slrCost, 
-                            it->GetSequenceNo (), 
-                            eslr::PRIMARY, 
-                            eslr::MAIN, 
-                            m_routeTimeoutDelay, 
-                            m_garbageCollectionDelay, 
-                            Seconds (0)); 
-        AddNetworkRouteTo ( it->GetDestAddress (), 
-                            it->GetDestMask (), 
-                            senderAddress, 
-                            incomingInterface, 
-                            slrCost, 
-                            it->GetSequenceNo (), 
-                            eslr::PRIMARY, 
-                            eslr::BACKUP, 
-                            m_routeTimeoutDelay, 
-                            m_garbageCollectionDelay, 
-                            Seconds (0));                                        
+        RoutingTableEntry route (it->GetDestAddress (), 
+                                 it->GetDestMask (), 
+                                 senderAddress, 
+                                 incomingInterface);
+        route.SetValidity (eslr::VALID);
+        route.SetSequenceNo (it->GetSequenceNo ());
+        route.SetRouteType (eslr::PRIMARY);
+        route.SetMetric (uint16_t (slrCost)); // the same width as AddNetworkRouteTo
+        route.SetRouteChanged (true); 
+
+        newRoutes.push_back (route);
         continue;
       }
       else if (foundPrimary && !foundSecondary)
@@ -2049,6 +2946,11 @@ EslrRoutingProtocol::HandleRouteResponses (ESLRRoutingHeader hdr, Ipv4Address se
       }// both primary and secondary routes are there.
     } // all routes have a valid sequence number
   }
+
+  if (!newRoutes.empty ())
+  {
+    m_routing.AddNewRoutes (newRoutes, m_routeTimeoutDelay, m_garbageCollectionDelay);
+  }
 	
 	// if invalidated routes found, send an immediate triggered update	
 	if (invalidatedInMain)
@@ -2087,7 +2989,13 @@ EslrRoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<N
     NS_LOG_LOGIC ("ESLR: Multicast destination");
   }
   
-  rtEntry  = LookupRoute (destination, oif);
+  if (m_multipath && !oif)
+  {
+    // the payload is not a transport header yet, the flow is identified without the ports
+    rtEntry = LookupMultipathRoute (0, header);
+  }
+  else
+    rtEntry  = LookupRoute (destination, oif);
   
   if (rtEntry)
   {
@@ -2129,36 +3037,16 @@ EslrRoutingProtocol::RouteInput (Ptr<const Packet> p,
   }    
   
   // First find the local interfaces and forward the packet locally.
-  // Note: As T. Pecorella mentioned in the RIPng implementation,
-  // this method is also checks every interface before forwarding the packet among the local interfaces.
-  // However, if we enable the configuration option as mentioned in the \RFC{1222},
-  // this forwarding can be done bit intelligently.
+  // Note: the addresses of all interfaces are kept in a set, 
+  // which is updated whenever an interface or an address changes.
   
-  for (uint32_t j = 0; j < m_ipv4->GetNInterfaces (); j ++)
+  if (m_localAddresses.find (dstinationAddress.Get ()) != m_localAddresses.end ())
   {
-    for (uint32_t i = 0; i < m_ipv4->GetNAddresses (j); i ++)
-    {
-      Ipv4InterfaceAddress iface = m_ipv4->GetAddress (j, i);
-      Ipv4Address address = iface.GetLocal ();
+    NS_LOG_LOGIC ("ESLR: packet is for me and forwarding it for the interface " << iif);
     
-      if (address.IsEqual (header.GetDestination ()))
-      {
-        if (j == iif)
-        {
-          NS_LOG_LOGIC ("ESLR: packet is for me and forwarding it for the interface " << iif);
-        }
-        else
-        {
-          NS_LOG_LOGIC ("ESLR: packet is for me but for different interface " << j);
-        }
-        
-        lcb (p, header, iif);
-        return (retVal = true);
-      }
-      
-      NS_LOG_LOGIC ("Address " << address << " is not a match");
-    }
-  }  
+    lcb (p, header, iif);
+    return (retVal = true);
+  }
   
   // Check the input device supports IP forwarding
   if (m_ipv4->IsForwarding (iif) == false)
@@ -2172,7 +3060,7 @@ EslrRoutingProtocol::RouteInput (Ptr<const Packet> p,
   // Finally, check for route and forwad the packet to the next hop
   NS_LOG_LOGIC ("ESLR: finding a route in the routing table");
   
-  Ptr<Ipv4Route> route = LookupRoute (header.GetDestination ()); 
+  Ptr<Ipv4Route> route = m_multipath ? LookupMultipathRoute (p, header) : LookupRoute (header.GetDestination ()); 
   
   if (route != 0)
   {
@@ -2193,7 +3081,6 @@ EslrRoutingProtocol::LookupRoute (Ipv4Address address, Ptr<NetDevice> dev)
   NS_LOG_FUNCTION (this << address << dev);
   
   Ptr<Ipv4Route> rtentry = 0;
-  bool foundRoute = false;
   
   // Note: if the packet is destined for local multicasting group, 
   // the relevant interfaces has to be specified while looking up the route
@@ -2214,26 +3101,40 @@ EslrRoutingProtocol::LookupRoute (Ipv4Address address, Ptr<NetDevice> dev)
     return rtentry;      
   }
   
-  //Now, select a route from the routing table which matches the destination address and its mask
-  RoutingTable::RoutesI theRoute;
-  foundRoute = m_routing.ReturnRoute (address, dev, theRoute);
+  // Check the route cache first. The cache is used only when no net-device is specified, 
+  // and it is flushed whenever the forwarding table changes.
+  bool useCache = (!dev) && (m_routeCacheSize > 0);
+  if (useCache)
+  {
+    uint32_t generation = m_routing.GetForwardingTable ().GetGeneration ();
+    if (m_routeCacheGeneration != generation)
+    {
+      m_routeCache.clear ();
+      m_routeCacheOrder.clear ();
+      m_routeCacheGeneration = generation;
+    }
+
+    RouteCacheI cached = m_routeCache.find (address.Get ());
+    if (cached != m_routeCache.end ())
+    {
+      m_routeCacheHits++;
+      m_routeCacheOrder.splice (m_routeCacheOrder.begin (), m_routeCacheOrder, cached->second.position);
+      return cached->second.route;
+    }
+    m_routeCacheMisses++;
+  }
+
+  //Now, select a route from the forwarding table which matches the destination address and its mask
+  const ForwardingEntry *route = m_routing.GetForwardingTable ().Lookup (address, dev);
   
-  if (foundRoute)
+  if (route != 0)
   {
-    Ipv4RoutingTableEntry* route = theRoute->first;
-    uint32_t interfaceIndex = route->GetInterface ();
+    // The route is prebuilt by the forwarding table, 
+    // and rebuilt only when the next hop or the addresses change.
+    rtentry = route->route;
 
-    rtentry = Create<Ipv4Route> (); 
-    
-    rtentry->SetDestination (route->GetDest ());
-    rtentry->SetGateway (route->GetGateway ());
-    rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIndex));  
-    
-    // As the packet is going to be forwarded in to the next hop, while finding the source address, 
-    // the address scope is set as global.          
-    rtentry->SetSource (m_ipv4->SelectSourceAddress (m_ipv4->GetNetDevice (interfaceIndex), 
-                        route->GetDest (), 
-                        Ipv4InterfaceAddress::GLOBAL));
+    if (useCache)
+      CacheRoute (address.Get (), rtentry);
 
     NS_LOG_DEBUG ("ESLR: found a match for the destination " << 
                   rtentry->GetDestination () << 
@@ -2245,6 +3146,128 @@ EslrRoutingProtocol::LookupRoute (Ipv4Address address, Ptr<NetDevice> dev)
     return rtentry;
 }
 
+void
+EslrRoutingProtocol::CacheRoute (uint32_t address, Ptr<Ipv4Route> route)
+{
+  // the cache is bounded, the least recently used destination makes room for the new one
+  if (m_routeCache.size () >= m_routeCacheSize)
+  {
+    m_routeCache.erase (m_routeCacheOrder.back ());
+    m_routeCacheOrder.pop_back ();
+  }
+
+  m_routeCacheOrder.push_front (address);
+  RouteCacheRecord newRecord;
+  newRecord.route = route;
+  newRecord.position = m_routeCacheOrder.begin ();
+  m_routeCache.insert (std::make_pair (address, newRecord));
+}
+
+Ptr<Ipv4Route>
+EslrRoutingProtocol::LookupMultipathRoute (Ptr<const Packet> p, const Ipv4Header &header)
+{
+  NS_LOG_FUNCTION (this << header);
+
+  Ipv4Address destination = header.GetDestination ();
+  if (destination.IsMulticast ())
+    return LookupRoute (destination);
+
+  // The forwarding entry keeps the b-route of the destination too, 
+  // which is used if its cost is close enough to the main route.
+  const ForwardingEntry *entry = m_routing.GetForwardingTable ().Lookup (destination, 0);
+  if (entry == 0)
+    return 0;
+
+  Ptr<Ipv4Route> mainRoute = entry->route;
+  Ptr<Ipv4Route> backupRoute = 0;
+  if ((entry->backupRoute != 0) && 
+      (entry->backupMetric <= entry->metric * m_multipathMetricRatio))
+    backupRoute = entry->backupRoute;
+
+  uint32_t flow = GetFlowHash (p, header);
+
+  // A flow stays on its path as long as the path is usable, so that its packets are not reordered.
+  // This holds for the flows that started while the destination had a single path too, 
+  // they are not moved to the b-route when it becomes eligible.
+  FlowTableI cached = m_flowTable.find (flow);
+  if (cached != m_flowTable.end ())
+  {
+    Ptr<Ipv4Route> cachedRoute = cached->second.route;
+    if ((cachedRoute->GetGateway () == mainRoute->GetGateway ()) && 
+        (cachedRoute->GetOutputDevice () == mainRoute->GetOutputDevice ()))
+    {
+      TouchFlow (cached);
+      return mainRoute;
+    }
+    if ((backupRoute != 0) && 
+        (cachedRoute->GetGateway () == backupRoute->GetGateway ()) && 
+        (cachedRoute->GetOutputDevice () == backupRoute->GetOutputDevice ()))
+    {
+      TouchFlow (cached);
+      return cachedRoute;
+    }
+  }
+
+  Ptr<Ipv4Route> route = mainRoute;
+  if ((backupRoute != 0) && (flow % 2))
+    route = backupRoute;
+
+  RecordFlow (flow, route);
+
+  NS_LOG_DEBUG ("ESLR: flow " << flow << " to " << destination << " via " << route->GetGateway ());
+  return route;
+}
+
+void
+EslrRoutingProtocol::RecordFlow (uint32_t flow, Ptr<Ipv4Route> route)
+{
+  FlowTableI record = m_flowTable.find (flow);
+  if (record != m_flowTable.end ())
+  {
+    record->second.route = route;
+    TouchFlow (record);
+    return;
+  }
+
+  // the flow table is bounded, the least recently used flow makes room for the new one
+  if (m_flowTable.size () >= m_flowTableSize)
+  {
+    m_flowTable.erase (m_flowOrder.back ());
+    m_flowOrder.pop_back ();
+  }
+
+  m_flowOrder.push_front (flow);
+  FlowRecord newRecord;
+  newRecord.route = route;
+  newRecord.position = m_flowOrder.begin ();
+  m_flowTable.insert (std::make_pair (flow, newRecord));
+}
+
+void
+EslrRoutingProtocol::TouchFlow (FlowTableI record)
+{
+  m_flowOrder.splice (m_flowOrder.begin (), m_flowOrder, record->second.position);
+}
+
+uint32_t
+EslrRoutingProtocol::GetFlowHash (Ptr<const Packet> p, const Ipv4Header &header) const
+{
+  // source, destination, protocol, and the ports of UDP and TCP
+  uint8_t buffer[13] = { 0 };
+  header.GetSource ().Serialize (buffer);
+  header.GetDestination ().Serialize (buffer + 4);
+  buffer[8] = header.GetProtocol ();
+
+  const uint8_t udpProtocol = 17, tcpProtocol = 6;
+  if ((p != 0) && 
+      (header.GetProtocol () == udpProtocol || header.GetProtocol () == tcpProtocol) && 
+      (p->GetSize () >= 4))
+  {
+    p->CopyData (buffer + 9, 4);
+  }
+  return Hash32 (reinterpret_cast<const char*> (buffer), sizeof (buffer));
+}
+
 void 
 EslrRoutingProtocol::AddDefaultRouteTo (Ipv4Address nextHop, uint32_t interface)
 {
@@ -2273,15 +3296,15 @@ EslrRoutingProtocol::AddNetworkRouteTo (Ipv4Address network,
 {
   NS_LOG_FUNCTION (this << network << networkMask << nextHop << interface << metric << sequenceNo << routeType);
 
-  RoutingTableEntry* route = new RoutingTableEntry (network, networkMask, nextHop, interface);
-  route->SetValidity (eslr::VALID);
-  route->SetSequenceNo (sequenceNo);
-  route->SetRouteType (routeType);
-  route->SetMetric (metric);
-  route->SetRouteChanged (true); 
+  RoutingTableEntry route (network, networkMask, nextHop, interface);
+  route.SetValidity (eslr::VALID);
+  route.SetSequenceNo (sequenceNo);
+  route.SetRouteType (routeType);
+  route.SetMetric (metric);
+  route.SetRouteChanged (true); 
 
   NS_LOG_LOGIC (this << "ESLR: Add route: " << network << networkMask << ", to " << table); 
-  m_routing.AddRoute (route, timeoutTime, garbageCollectionTime, settlingTime, table);        
+  m_routing.AddRoute (&route, timeoutTime, garbageCollectionTime, settlingTime, table);        
 }
 
 void 
@@ -2298,16 +3321,16 @@ EslrRoutingProtocol::AddNetworkRouteTo (Ipv4Address network,
 {
   NS_LOG_FUNCTION (this << network << networkMask << interface << metric << sequenceNo << routeType);
 
-  RoutingTableEntry* route = new RoutingTableEntry (network, networkMask, interface);
-  route->SetValidity (eslr::VALID);
-  route->SetSequenceNo (sequenceNo);
-  route->SetRouteType (routeType);
-  route->SetMetric (metric);
-  route->SetRouteChanged (true); 
+  RoutingTableEntry route (network, networkMask, interface);
+  route.SetValidity (eslr::VALID);
+  route.SetSequenceNo (sequenceNo);
+  route.SetRouteType (routeType);
+  route.SetMetric (metric);
+  route.SetRouteChanged (true); 
 
   NS_LOG_LOGIC (this << "ESLR: Add route: " << network << networkMask << ", to " << table);
   
-  m_routing.AddHostRoute (route, timeoutTime, garbageCollectionTime, settlingTime, table); 
+  m_routing.AddHostRoute (&route, timeoutTime, garbageCollectionTime, settlingTime, table); 
 }
 
 void 
@@ -2329,25 +3352,25 @@ EslrRoutingProtocol::AddHostRouteTo (Ipv4Address host,
   //    are specifically set as 0. 
   //    Further, such routes are only add to the main table and those are never expire.
 
-  RoutingTableEntry* route = new RoutingTableEntry (host, interface);
+  RoutingTableEntry route (host, interface);
 
   if (host == "127.0.0.1")
   {
-    route->SetValidity (eslr::LHOST); // Neither valid nor invalid
-    route->SetRouteChanged (false);     
+    route.SetValidity (eslr::LHOST); // Neither valid nor invalid
+    route.SetRouteChanged (false);     
   }
   else
   {
-    route->SetValidity (eslr::VALID);
-    route->SetRouteChanged (true); 
+    route.SetValidity (eslr::VALID);
+    route.SetRouteChanged (true); 
   }
-  route->SetSequenceNo (sequenceNo);
-  route->SetRouteType (routeType);
-  route->SetMetric (metric);
+  route.SetSequenceNo (sequenceNo);
+  route.SetRouteType (routeType);
+  route.SetMetric (metric);
 
   NS_LOG_LOGIC ("ESLR: Add route: " << host << ", to " << table);
   
-  m_routing.AddHostRoute (route, timeoutTime, garbageCollectionTime, settlingTime, table); 
+  m_routing.AddHostRoute (&route, timeoutTime, garbageCollectionTime, settlingTime, table); 
 }
 
 void 
@@ -2392,15 +3415,15 @@ EslrRoutingProtocol::UpdateRoute (Ipv4Address network,
 {
   NS_LOG_FUNCTION (this << network << networkMask << nextHop << interface << metric << sequenceNo << routeType);
 
-  RoutingTableEntry* route = new RoutingTableEntry (network, networkMask, nextHop, interface);
-  route->SetValidity (eslr::VALID);
-  route->SetSequenceNo (sequenceNo);
-  route->SetRouteType (routeType);
-  route->SetMetric (metric);
-  route->SetRouteChanged (true); 
+  RoutingTableEntry route (network, networkMask, nextHop, interface);
+  route.SetValidity (eslr::VALID);
+  route.SetSequenceNo (sequenceNo);
+  route.SetRouteType (routeType);
+  route.SetMetric (metric);
+  route.SetRouteChanged (true); 
 
   NS_LOG_DEBUG ("ESLR: Add route: " << network << networkMask << ", to " << table); 
-  m_routing.UpdateNetworkRoute (route, timeoutTime, garbageCollectionTime, settlingTime, table);        
+  m_routing.UpdateNetworkRoute (&route, timeoutTime, garbageCollectionTime, settlingTime, table);        
 }
 
 Ptr<Socket> 
@@ -2422,6 +3445,37 @@ EslrRoutingProtocol::GetSocketForInterface (uint32_t interface)
   return (sock = 0);
 }
 
+void
+EslrRoutingProtocol::SendControlPacket (Ptr<Socket> socket, Ptr<Packet> p, Ipv4Address destination, uint16_t port, bool urgent)
+{
+  NS_LOG_FUNCTION (this << socket << p << destination << port << urgent);
+
+  int32_t interface = GetInterfaceForSocket (socket);
+  if (interface < 0)
+  {
+    // not an interface socket, nothing to pace it with
+    socket->SendTo (p, 0, InetSocketAddress (destination, port));
+    return;
+  }
+  m_controlPacer.Send (interface, socket, p, destination, port, urgent);
+}
+
+void
+EslrRoutingProtocol::ControlPacketDropped (Ptr<const Packet> p, uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << p << interface);
+
+  NS_LOG_DEBUG ("ESLR: node " << m_nodeId << " dropped a control packet on " << interface << 
+                ", " << m_controlPacer.GetStatistics (interface));
+  m_controlDropTrace (p, interface);
+}
+
+PacerStatistics
+EslrRoutingProtocol::GetControlPacerStatistics (uint32_t interface) const
+{
+  return m_controlPacer.GetStatistics (interface);
+}
+
 int32_t
 EslrRoutingProtocol::GetInterfaceForSocket (Ptr<Socket> socket)
 {
@@ -2547,6 +3601,28 @@ EslrRoutingProtocol::PrintStats ()
   m_countingEvent = Simulator::Schedule (m_printDuration, &EslrRoutingProtocol::PrintStats, this);  
 }
 
+void
+EslrRoutingProtocol::GetMemoryUsage (MemoryUsage &routing, MemoryUsage &neighbors) const
+{
+  NS_LOG_FUNCTION (this);
+
+  m_routing.GetMemoryUsage (routing);
+  m_neighborTable.GetMemoryUsage (neighbors);
+}
+
+void
+EslrRoutingProtocol::ReportMemoryUsage ()
+{
+  NS_LOG_FUNCTION (this);
+
+  MemoryUsage routing, neighbors;
+  GetMemoryUsage (routing, neighbors);
+  NS_LOG_DEBUG ("ESLR: node " << m_nodeId << " routing tables " << routing << "; neighbor table " << neighbors);
+  m_memoryUsageTrace (routing, neighbors);
+
+  m_memoryReportEvent = Simulator::Schedule (m_memoryReportInterval, &EslrRoutingProtocol::ReportMemoryUsage, this);
+}
+
 }// end of namespace eslr
 }// end of namespave ns3
 
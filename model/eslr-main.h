@@ -22,11 +22,15 @@
 
 #include <list>
 #include <map>
+#include <set>
+#include <tr1/unordered_map>
+#include <tr1/unordered_set>
 
 #include "eslr-definition.h"
 #include "eslr-neighbor.h"
 #include "eslr-headers.h"
 #include "eslr-route.h"
+#include "eslr-control-pacer.h"
 
 #include "ns3/node.h"
 #include "ns3/ipv4-routing-protocol.h"
@@ -34,6 +38,8 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/ipv4-l3-protocol.h"
 #include "ns3/inet-socket-address.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 
 #define ESLR_BROAD_PORT 275
 #define ESLR_MULT_PORT 276
@@ -103,6 +109,28 @@ public:
    */
   void AddDefaultRouteTo (Ipv4Address nextHop, uint32_t interface);
 
+  /**
+   * \brief Get the memory footprint of the routing tables and of the neighbor table.
+   * The footprints of many nodes can be added up to get the aggregate footprint.
+   *
+   * \param routing the returned footprint of the main and backup tables
+   * \param neighbors the returned footprint of the neighbor table
+   */
+  void GetMemoryUsage (MemoryUsage &routing, MemoryUsage &neighbors) const;
+
+  /// Callback signature of the MemoryUsage trace source
+  typedef void (* MemoryUsageCallback)(const MemoryUsage &routing, const MemoryUsage &neighbors);
+
+  /**
+   * \brief Get the counters of the control packets paced on an interface.
+   * \param interface the interface
+   * \returns the counters (queue depth, sent, delayed and dropped packets)
+   */
+  PacerStatistics GetControlPacerStatistics (uint32_t interface) const;
+
+  /// Callback signature of the ControlDrop trace source
+  typedef void (* ControlDropCallback)(Ptr<const Packet> packet, uint32_t interface);
+
 protected:
   /**
    * \brief Dispose this object.
@@ -180,6 +208,37 @@ private:
    */
   void HandleRouteResponses (ESLRRoutingHeader hdr, Ipv4Address senderAddress, uint32_t incomingInterface);
 
+  /**
+   * \brief Handle the periodic and triggered updates when the delta updates are on.
+   * The advertisements of the neighbor are kept, so that the routes a delta update 
+   * does not carry are refreshed from them. Once every message of a periodic update 
+   * is received, the digest of the kept advertisements is checked against the digest 
+   * of the update, and the update is acknowledged, or a full update is asked for.
+   * \param hdr message header (including RUMs)
+   * \param senderAddress sender address
+   * \param incomingInterface incoming interface
+   */
+  void HandleSequencedUpdate (ESLRRoutingHeader hdr, Ipv4Address senderAddress, uint32_t incomingInterface);
+
+  /**
+   * \brief Handle the acknowledgements and the full update requests of the neighbors
+   * \param hdr message header
+   * \param senderAddress sender address
+   */
+  void HandleUpdateAcknowledgement (ESLRRoutingHeader hdr, Ipv4Address senderAddress);
+
+  /**
+   * \brief Acknowledge a periodic update to a neighbor, or ask it for a full update
+   * \param neighbor the neighbor address
+   * \param command ACKNOWLEDGE or RESYNC
+   * \param sequence the sequence number of the periodic update
+   * \param digest the digest of the advertisements kept for the neighbor
+   */
+  void SendUpdateAcknowledgement (Ipv4Address neighbor, 
+                                  eslr::EslrHeaderRUCommand command, 
+                                  uint16_t sequence, 
+                                  uint32_t digest);
+
 	/**
 	 * \brief Generate a unique ID for the node. 
 	 * 	This ID is a hash value of (IF0's IP address + netmask + AS#) 
@@ -194,6 +253,23 @@ private:
 	 */
   Ptr<Socket> GetSocketForInterface (uint32_t interface);
 
+	/**
+	 * \brief Send an ESLR packet through the control packet pacer of the socket's interface.
+	 * \param socket the socket
+	 * \param p the packet
+	 * \param destination the destination address
+	 * \param port the destination port
+	 * \param urgent the packet is a fast-triggered update, released before the other packets
+	 */
+  void SendControlPacket (Ptr<Socket> socket, Ptr<Packet> p, Ipv4Address destination, uint16_t port, bool urgent);
+
+	/**
+	 * \brief Report a control packet dropped by the pacer to the ControlDrop trace source.
+	 * \param p the packet
+	 * \param interface the interface
+	 */
+  void ControlPacketDropped (Ptr<const Packet> p, uint32_t interface);
+
 	/**
 	 * \brief Find the interface which a socket bounded to . 
 	 * \param socket the socket
@@ -347,12 +423,208 @@ private:
   */
   Ptr<Ipv4Route> LookupRoute (Ipv4Address address, Ptr<NetDevice> dev = 0); 
   
+  /// Summaries of an interface, keyed by (network, mask)
+  typedef std::map<uint64_t, ESLRrum> Summaries;
+
+  /**
+  * \brief Summarize the RUMs of contiguous prefixes.
+  * Two sibling prefixes are replaced by their covering prefix, if their routes
+  * share a gateway and their metrics are within m_aggregationMetricError,
+  * and the covering prefix is not advertised on its own. The summary carries
+  * the largest metric and sequence number. DISCONNECTED routes are not summarized.
+  * A summary is changed if any of the merged routes changed.
+  * \param rums the RUMs, in the advertising order
+  * \param gateways the gateways of the routes of the RUMs
+  * \param changed whether the route of each RUM changed since the last update
+  * \param summaries the summaries produced
+  */
+  void AggregateRums (std::vector<ESLRrum> &rums, 
+                      std::vector<Ipv4Address> &gateways, 
+                      std::vector<bool> &changed, 
+                      Summaries &summaries);
+
+  /**
+  * \brief Withdraw the summaries an interface no longer advertises.
+  * A D-bit RUM is added for each summary advertised before and not produced anymore.
+  * The routes a withdrawn summary covered, and the new summaries, are marked changed,
+  * so that the triggered updates carry them.
+  * \param interface the interface
+  * \param summaries the summaries produced for the interface
+  * \param rums the summarized RUMs of the interface
+  * \param changed whether each RUM changed since the last update
+  */
+  void WithdrawSummaries (uint32_t interface, 
+                          const Summaries &summaries, 
+                          std::vector<ESLRrum> &rums, 
+                          std::vector<bool> &changed);
+
+  /**
+  * \brief Record the update each changed route is first advertised in by a periodic update.
+  * A route changed if the content of its RUM (network, mask, metric and validity)
+  * differs from the recorded one. A periodic update starts a new update sequence number.
+  * The routes that left the table are kept as INVALID, so that the delta updates withdraw
+  * them, until all the neighbors acknowledged the withdrawal.
+  * \param routes the routes of the update (the whole table for a periodic update)
+  * \param updateType periodic or triggered
+  */
+  void RecordRouteChanges (const std::vector<const RoutingTableEntry*> &routes, eslr::UpdateType updateType);
+
+  /**
+  * \brief Get the oldest periodic update acknowledged by the neighbors of an interface.
+  * \param neighbors the neighbors
+  * \param interface the interface
+  * \param acknowledged the returned update sequence number
+  * \returns false if a neighbor of the interface has not acknowledged any update
+  */
+  bool GetAcknowledgedUpdate (const NeighborTable::NeighborTableInstance &neighbors, 
+                              uint32_t interface, 
+                              uint32_t &acknowledged) const;
+
+  /**
+  * \brief Compute the digest of the routes advertised on an interface.
+  * \param rums the RUMs
+  * \param selected the positions of the RUMs advertised on the interface
+  * \returns the digest
+  */
+  uint32_t GetDigest (const std::vector<ESLRrum> &rums, const std::vector<uint32_t> &selected) const;
+
+  /**
+  * \brief Build the key of a prefix.
+  * \param network the network address
+  * \param mask the network mask
+  * \returns the key
+  */
+  static uint64_t GetPrefixKey (Ipv4Address network, Ipv4Mask mask)
+  {
+    return (uint64_t (network.Get ()) << 32) | mask.Get ();
+  }
+  static uint64_t GetRumKey (const ESLRrum &rum)
+  {
+    return GetPrefixKey (rum.GetDestAddress (), rum.GetDestMask ());
+  }
+
+  /**
+  * \brief The encoded RUMs of one update message, without the ESLR header.
+  * The payload is shared by all the neighbors of an interface.
+  */
+  struct UpdatePayload
+  {
+    UpdatePayload () : noe (0),
+                       baseSequence (0),
+                       cBit (false),
+                       dBit (false)
+    {
+      /*cstrctr*/
+    }
+    Ptr<Packet> rums; //!< the encoded RUMs
+    uint16_t noe; //!< number of RUMs in the payload
+    uint16_t baseSequence; //!< sequence number the compact RUMs are coded against
+    bool cBit; //!< a RUM of the payload advertises a VALID route
+    bool dBit; //!< a RUM of the payload advertises a DISCONNECTED route
+  };
+
+  /**
+  * \brief Serialize the RUMs, back to back, in the wire format.
+  * \param rums the RUMs
+  * \param encoded the returned bytes, RUM_SIZE bytes per RUM
+  */
+  void EncodeRums (const std::vector<ESLRrum> &rums, std::vector<uint8_t> &encoded) const;
+
+  /**
+  * \brief Assemble the update payloads of an interface from the encoded RUMs.
+  * \param rums the RUMs
+  * \param encoded the encoded RUMs
+  * \param selected the positions of the RUMs to be advertised on the interface, in the advertising order
+  * \param maxRum the maximum number of RUMs in a message
+  * \param payloads the returned payloads
+  */
+  void BuildUpdatePayloads (const std::vector<ESLRrum> &rums, 
+                            const std::vector<uint8_t> &encoded, 
+                            const std::vector<uint32_t> &selected, 
+                            uint16_t maxRum, 
+                            std::vector<UpdatePayload> &payloads) const;
+
+  /**
+  * \brief Assemble the update payloads of an interface in the compact RUM encoding.
+  * Each payload is coded against the sequence number of its first RUM.
+  * \param rums the RUMs
+  * \param selected the positions of the RUMs to be advertised on the interface, in the advertising order
+  * \param space the number of bytes available for the RUMs of a message
+  * \param payloads the returned payloads
+  */
+  void BuildCompactPayloads (const std::vector<ESLRrum> &rums, 
+                             const std::vector<uint32_t> &selected, 
+                             uint32_t space, 
+                             std::vector<UpdatePayload> &payloads) const;
+
+  /**
+  * \brief Calculate the number of RUMs that fit in a route update sent on an interface.
+  * \param interface the interface
+  * \param sequenced the update carries the update sequence
+  * \returns the number of RUMs, limited by the MTU and by the NoE field of the header
+  */
+  uint16_t GetMaxRums (uint32_t interface, bool sequenced) const;
+
+  /**
+  * \brief Calculate the number of bytes an ESLR message sent on an interface can take.
+  * \param interface the interface
+  * \returns the MTU of the interface less the IP and the UDP headers
+  */
+  uint32_t GetUpdateSpace (uint32_t interface) const;
+
+  /**
+  * \brief Check whether a route update can not take another RUM.
+  * \param hdr the route update
+  * \param interface the interface the update is sent on
+  * \param maxRum the maximum number of RUMs in a message with the fixed size RUMs
+  * \returns true if the update has to be sent before adding the next RUM
+  */
+  bool IsUpdateFull (const ESLRRoutingHeader &hdr, uint32_t interface, uint16_t maxRum) const;
+
+  /**
+  * \brief Check whether the RUMs sent on an interface can use the compact encoding.
+  * \param interface the interface
+  * \returns true if the compact RUMs are enabled and all the neighbors of the interface decode them
+  */
+  bool UseCompactRums (uint32_t interface) const;
+
+  /**
+  * \brief Collect the addresses of all interfaces again.
+  * Has to be called whenever an interface or an address changes.
+  */
+  void UpdateLocalAddresses ();
+
+  /**
+  * \brief look up for a forwarding route, sharing the flows among the main route and the backup route.
+  * The b-route of the destination is used if its metric is within m_multipathMetricRatio
+  * of the main route metric. The flows are hashed on the paths, and each flow keeps its path.
+  *
+  * \param p the packet, starting with the transport header (can be zero)
+  * \param header the IPv4 header of the packet
+  * \return Ipv4Route where that the given packet has to be forwarded 
+  */
+  Ptr<Ipv4Route> LookupMultipathRoute (Ptr<const Packet> p, const Ipv4Header &header);
+
+  /**
+  * \brief Hash the flow of a packet (addresses, protocol and, for UDP and TCP, the ports).
+  * \param p the packet, starting with the transport header (can be zero)
+  * \param header the IPv4 header of the packet
+  * \return the flow hash
+  */
+  uint32_t GetFlowHash (Ptr<const Packet> p, const Ipv4Header &header) const;
+
   /**
   * \brief the function developed for debugin purposes.
   * every m_printDuration the function will output number of protocol messages
   */
   void PrintStats ();
 
+  /**
+  * \brief Report the memory footprint of the tables to the MemoryUsage trace source.
+  * Repeated every m_memoryReportInterval.
+  */
+  void ReportMemoryUsage ();
+
 	/**
 	 * \brief Send Route Pull messages amoung the neighbors for disconnected routers
 	 * 				Find the routers which are invalidated because of the link disconnection
@@ -379,6 +651,7 @@ private:
   Ptr<Socket> m_recvSocket; //!< receive socket
 
   Ptr<Ipv4> m_ipv4; //!< IPv4 reference
+  std::tr1::unordered_set<uint32_t> m_localAddresses; //!< addresses of all interfaces (Ipv4Address::Get), for the local delivery
 
   std::set<uint32_t> m_interfaceExclusions; //!< Set of excluded interfaces
 
@@ -416,6 +689,12 @@ private:
 // \name for Routing Tables
 // \{
   RoutingTable m_routing; //!< the routing table instances (Main and Backup)
+  ForwardingLookupType m_forwardingLookup; //!< how the forwarding table is looked up
+  bool m_routeAggregation; //!< summarize the contiguous prefixes in the route updates
+  bool m_deltaUpdates; //!< periodic updates carry only the routes changed since the acknowledged update
+  bool m_compactUpdates; //!< send the compact RUMs to the neighbors that decode them
+  double m_aggregationMetricError; //!< largest relative metric difference within a summary
+  std::map<uint32_t, Summaries> m_advertisedSummaries; //!< the summaries last advertised on each interface
   Time m_routeTimeoutDelay; //!< Delay that determines the route is UNRESPONSIVE
   Time m_routeSettlingDelay; //!< Delay that determines a particular route is stable
   Time m_minTriggeredCooldownDelay; //!< minimum cool-down delay between two triggered updates
@@ -424,6 +703,142 @@ private:
 
   int64_t m_stream; //!< stream for the uniform random variable
 // \}
+
+// \name for the multipath forwarding
+// \{
+  /// The path of a flow
+  struct FlowRecord
+  {
+    Ptr<Ipv4Route> route; //!< the route the flow is forwarded on
+    std::list<uint32_t>::iterator position; //!< position of the flow in m_flowOrder
+  };
+
+  /// Flow table type (flow hash, path of the flow)
+  typedef std::map<uint32_t, FlowRecord> FlowTable;
+  /// Flow table type iterator
+  typedef std::map<uint32_t, FlowRecord>::iterator FlowTableI;
+
+  /**
+  * \brief Keep the path of a flow, evicting the least recently used flow if the flow table is full.
+  * \param flow the flow hash
+  * \param route the route of the flow
+  */
+  void RecordFlow (uint32_t flow, Ptr<Ipv4Route> route);
+
+  /**
+  * \brief Mark a flow as the most recently used one.
+  * \param record the flow table record of the flow
+  */
+  void TouchFlow (FlowTableI record);
+
+  bool m_multipath; //!< share the flows between the main route and the backup route
+  double m_multipathMetricRatio; //!< largest backup route metric, relative to the main route metric
+  uint32_t m_flowTableSize; //!< maximum number of flows in the flow table
+  FlowTable m_flowTable; //!< the routes of the recent flows
+  std::list<uint32_t> m_flowOrder; //!< the flows of the flow table, the most recently used first
+// \}
+
+// \name for the destination route cache
+// \{
+  /// The cached route of a destination
+  struct RouteCacheRecord
+  {
+    Ptr<Ipv4Route> route; //!< the route of the destination
+    std::list<uint32_t>::iterator position; //!< position of the destination in m_routeCacheOrder
+  };
+
+  /// Route cache type (destination address, cached route)
+  typedef std::tr1::unordered_map<uint32_t, RouteCacheRecord> RouteCache;
+  /// Route cache type iterator
+  typedef std::tr1::unordered_map<uint32_t, RouteCacheRecord>::iterator RouteCacheI;
+
+  /**
+  * \brief Keep the route of a destination, evicting the least recently used destination if the cache is full.
+  * \param address the destination address
+  * \param route the route of the destination
+  */
+  void CacheRoute (uint32_t address, Ptr<Ipv4Route> route);
+
+  RouteCache m_routeCache; //!< routes recently looked up, by destination address
+  std::list<uint32_t> m_routeCacheOrder; //!< the destinations of the route cache, the most recently used first
+  uint32_t m_routeCacheSize; //!< maximum number of cached destinations (0 disables the cache)
+  uint32_t m_routeCacheGeneration; //!< forwarding table generation the cached routes belong to
+  TracedValue<uint32_t> m_routeCacheHits; //!< number of lookups answered by the cache
+  TracedValue<uint32_t> m_routeCacheMisses; //!< number of lookups that missed the cache
+// \}
+
+// \name for the memory accounting
+// \{
+  Time m_memoryReportInterval; //!< time between two memory reports (zero disables the reports)
+  EventId m_memoryReportEvent; //!< next memory report event
+  TracedCallback<const MemoryUsage &, const MemoryUsage &> m_memoryUsageTrace; //!< memory footprint of the tables
+// \}
+
+// \name for the control packet pacing
+// \{
+  ControlPacer m_controlPacer; //!< token-bucket pacer of the control packets, per interface
+  DataRate m_controlRate; //!< rate of the control packets of an interface (zero disables the pacing)
+  uint32_t m_controlBurst; //!< bytes of control packets an interface can send at once
+  uint32_t m_controlQueueSize; //!< largest number of control packets waiting on an interface
+  TracedCallback<Ptr<const Packet>, uint32_t> m_controlDropTrace; //!< control packets dropped by the pacer
+// \}
+
+// \name for the delta periodic updates
+// \{
+  /// The update of an interface, shared by the neighbors of the interface
+  struct InterfaceUpdate
+  {
+    InterfaceUpdate () : digest (0),
+                         delta (false),
+                         compact (false)
+    {
+      /*cstrctr*/
+    }
+    std::vector<UpdatePayload> payloads; //!< the messages of the update
+    uint32_t digest; //!< digest of the routes advertised on the interface
+    bool delta; //!< the update carries only the changed routes
+    bool compact; //!< the payloads are in the compact RUM encoding
+  };
+
+  /// The advertisements received from a neighbor
+  struct NeighborAdvertisements
+  {
+    /// The latest RUM of each prefix, keyed by (network, mask)
+    typedef std::map<uint64_t, ESLRrum> Rums;
+
+    NeighborAdvertisements () : sequence (0),
+                                nReceived (0),
+                                receiving (false)
+    {
+      /*cstrctr*/
+    }
+    Rums rums; //!< the advertised routes, except the DISCONNECTED ones
+    std::set<uint64_t> carried; //!< the prefixes carried by the periodic update being received
+    uint16_t sequence; //!< sequence number of the periodic update being received
+    uint16_t nReceived; //!< number of received messages of the periodic update
+    bool receiving; //!< a periodic update is being received
+  };
+
+  /// The advertised content of a route, and the update it last changed in
+  struct RouteChange
+  {
+    uint32_t update; //!< the update the route last changed in
+    uint32_t metric; //!< the advertised metric
+    eslr::Validity validity; //!< the advertised validity
+  };
+
+  /// Last change of each route, keyed by (network, mask)
+  typedef std::map<uint64_t, RouteChange> RouteChanges;
+  /// Last periodic update acknowledged by each neighbor
+  typedef std::map<Ipv4Address, uint32_t> AcknowledgedUpdates;
+  /// Advertisements received from each neighbor
+  typedef std::map<Ipv4Address, NeighborAdvertisements> NeighborAdvertisementsMap;
+
+  uint32_t m_updateSequence; //!< sequence number of the last periodic update
+  RouteChanges m_routeChanges; //!< the update each route last changed in
+  AcknowledgedUpdates m_acknowledgedUpdates; //!< the updates acknowledged by the neighbors
+  NeighborAdvertisementsMap m_neighborAdvertisements; //!< the advertisements of the neighbors
+// \}
 };// end of the class EslrRoutingProtocol
 }// end of namespace eslr
 }// end of namespave ns3
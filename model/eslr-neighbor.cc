@@ -53,7 +53,8 @@ namespace eslr {
                                           m_authType (authType),
                                           m_authData (authData),
 																					m_identifier (identifier),
-																					m_validity (validity)
+																					m_validity (validity),
+																					m_compactRums (false)
   {
     // Constructor
   }
@@ -67,7 +68,7 @@ namespace eslr {
  * Neighbor Table
 */
 
-  NeighborTable::NeighborTable () 
+  NeighborTable::NeighborTable () : routeInstance (0)
   {
 		/*cstrctr*/
   }
@@ -84,7 +85,7 @@ namespace eslr {
   {    
     NS_LOG_FUNCTION (this << neighborEntry->GetNeighborID());
     
-    EventId invalidateEvent = Simulator::Schedule (invalidateTime, 
+    TimerId invalidateEvent = m_timers.Schedule (invalidateTime, 
 																									 &NeighborTable::InvalidateNeighbor, 
 																									 this, 
 																									 neighborEntry, 
@@ -97,7 +98,7 @@ namespace eslr {
 	{
 		NS_LOG_FUNCTION (this << neighborEntry->GetNeighborID());
 
-		EventId removeEvent = Simulator::Schedule (removeTime, 
+		TimerId removeEvent = m_timers.Schedule (removeTime, 
 																							 &NeighborTable::DeleteVoidNeighbor, 
 																							 this, 
 																							 neighborEntry);
@@ -149,7 +150,7 @@ namespace eslr {
         delete it->first;
         it->first = neighborEntry;
         it->second.Cancel ();
-        it->second = Simulator::Schedule (invalidateTime, 
+        it->second = m_timers.Schedule (invalidateTime, 
 																					&NeighborTable::InvalidateNeighbor, 
 																					this, 
 																					it->first, 
@@ -188,7 +189,7 @@ namespace eslr {
         
 				if (it->second.IsRunning ())
           it->second.Cancel ();
-        it->second = Simulator::Schedule (deleteTime, 
+        it->second = m_timers.Schedule (deleteTime, 
 																					&NeighborTable::DeleteNeighbor, 
 																					this, 
 																					it->first);
@@ -394,6 +395,37 @@ namespace eslr {
     }
   }
 
+  bool 
+  NeighborTable::IsCompactInterface (uint32_t interface) const
+  {
+		NS_LOG_FUNCTION (this << interface);
+
+    bool found = false;
+    for (NeighborCI it = m_neighborTable.begin ();  it!= m_neighborTable.end (); it++)
+    {
+      if (it->first->GetInterface () != interface)
+        continue;
+      if (!it->first->GetCompactRums ())
+        return false;
+      found = true;
+    }
+    return found;
+  }
+
+  void 
+  NeighborTable::GetMemoryUsage (MemoryUsage &usage) const
+  {
+		NS_LOG_FUNCTION (this);
+
+		usage = MemoryUsage ();
+		usage.records = m_neighborTable.size ();
+		usage.liveObjects = m_neighborTable.size ();
+		usage.pendingEvents = m_timers.GetNTimers ();
+		usage.bytes = usage.records * (sizeof (NeighborTableEntry) + 
+                                   MemoryUsage::GetNodeSize (sizeof (std::pair <NeighborTableEntry*, TimerId>), 2)) + 
+                  m_timers.GetMemorySize ();
+  }
+
   void 
   NeighborTable::PrintNeighborTable (Ptr<OutputStreamWrapper> stream) const
   {
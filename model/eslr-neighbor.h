@@ -28,6 +28,7 @@
 #include "ns3/eslr-definition.h"
 #include "ns3/eslr-headers.h"
 #include "ns3/eslr-route.h"
+#include "ns3/eslr-timer-wheel.h"
 
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-route.h"
@@ -196,6 +197,20 @@ public:
     return m_identifier;
   }
 
+  /**
+  * \brief Get and Set whether the neighbor decodes the compact RUMs
+  * \param compactRums the neighbor advertised the compact RUMs in its KAMs
+  * \returns true if the neighbor decodes the compact RUMs
+  */
+  void SetCompactRums (bool compactRums)
+  {
+    m_compactRums = compactRums;
+  }
+  bool GetCompactRums () const
+  {
+    return m_compactRums;
+  }
+
 private:
   uint16_t m_neighborID;  //!< ID of the neighbor
   Ipv4Address m_neighborAddress; //!< address of the Neighbor (this is the sender's interface IP address')
@@ -206,6 +221,7 @@ private:
   uint16_t m_authData; //!< authentication phrase
 	uint8_t m_identifier; //!< the random identifier between the neighbor
 	eslr::Validity m_validity; //!< validity of the neighbor record
+	bool m_compactRums; //!< the neighbor decodes the compact RUMs
 	  
 }; // end of class NeighborTableEntry
 
@@ -223,16 +239,16 @@ class NeighborTable
 {
 public:
   /// Container for a neighbor table entry 
-  typedef std::pair <NeighborTableEntry, EventId> NeighborTableRecord;
+  typedef std::pair <NeighborTableEntry, TimerId> NeighborTableRecord;
   
   /// Container for an instance of the neighbor table
-  typedef std::list<std::pair <NeighborTableEntry*, EventId> > NeighborTableInstance;
+  typedef std::list<std::pair <NeighborTableEntry*, TimerId> > NeighborTableInstance;
 
   /// Iterator for the Neighbor table entry container
-  typedef std::list<std::pair <NeighborTableEntry*, EventId> >::iterator NeighborI;
+  typedef std::list<std::pair <NeighborTableEntry*, TimerId> >::iterator NeighborI;
 
   /// Constant Iterator for the Neighbor table entry container
-  typedef std::list<std::pair <NeighborTableEntry*, EventId> >::const_iterator NeighborCI;
+  typedef std::list<std::pair <NeighborTableEntry*, TimerId> >::const_iterator NeighborCI;
 
   NeighborTable ();
   ~NeighborTable ();
@@ -340,12 +356,26 @@ public:
   */
   void ReturnNeighborTable (NeighborTableInstance &instance);
 
+  /**
+  * \brief Check whether all the neighbors of an interface decode the compact RUMs
+  * \param interface the interface
+  * \returns true if the interface has neighbors and all of them decode the compact RUMs
+  */
+  bool IsCompactInterface (uint32_t interface) const;
+
   /**
   * \brief Print the neighbor Table
   * \param the output stream 
   */
   void PrintNeighborTable (Ptr<OutputStreamWrapper> stream) const;
 
+  /**
+  * \brief Get the memory footprint of the neighbor table.
+	* 		The neighbor entries are allocated one by one, therefore none of them is pooled.
+  * \param usage the returned footprint
+  */
+  void GetMemoryUsage (MemoryUsage &usage) const;
+
   /**
   * \brief return if the neighbor table is empty or not
   */
@@ -356,6 +386,12 @@ public:
   */
 	void DoDispose ()
 	{
+		m_timers.Clear ();
+		// the table owns its entries
+		for (NeighborI it = m_neighborTable.begin (); it != m_neighborTable.end (); it++)
+		{
+			delete it->first;
+		}
 		m_neighborTable.clear ();
 	}
 
@@ -367,15 +403,16 @@ public:
 		m_routeTimeoutDelay = routeTimeout;
 		m_routeGarbageCollectionDelay = routeDelete;
 		m_routeSettlingDelay = routeSettling;
-		routeInstance = routingTablei;
+		routeInstance = &routingTablei;
 	}
 
 	private:
   NeighborTableInstance m_neighborTable; //!< instance of the neighbor table
+  TimerWheel m_timers; //!< the timers of the neighbor records
   Time m_routeTimeoutDelay; //!< Delay that determines the neighbor is UNRESPONSIVE
   Time m_routeGarbageCollectionDelay; //!< Delay before remove UNRESPONSIVE route/neighbor record
   Time m_routeSettlingDelay; //!< Delay that determines a particular route is stable
-	RoutingTable routeInstance; //!< the instance of both routing tables
+	RoutingTable* routeInstance; //!< the instance of both routing tables (owned by the protocol)
 }; // end of class NeighborTable
 
 } // end of eslr namespace
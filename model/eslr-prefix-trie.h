@@ -0,0 +1,289 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#ifndef ESLR_PREFIX_TRIE_H
+#define ESLR_PREFIX_TRIE_H
+
+#include <list>
+#include <stdint.h>
+
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+namespace eslr {
+
+/**
+ * \brief Binary trie over IPv4 prefixes.
+ *
+ * Each node of the trie represents one prefix (network/length) and keeps the
+ * values that were stored for that prefix. Several values may share the same
+ * prefix (e.g., a main route that is waiting to be deleted and a fresh route
+ * for the same destination), therefore every node keeps a list. The order of
+ * that list is controlled by the caller, so that it can mirror the order of
+ * the routing table the trie is indexing.
+ *
+ * Lookups walk at most 32 levels, irrespective of the number of stored
+ * prefixes. The trie only indexes values; the caller decides which stored
+ * value is usable by passing a predicate to LongestMatch ().
+ */
+template <typename T>
+class PrefixTrie
+{
+public:
+  /// List of the values stored for a single prefix
+  typedef std::list<T> ValueList;
+
+  PrefixTrie ()
+    : m_root (new Node ()),
+      m_nValues (0),
+      m_nNodes (1)
+  {
+    /*cstrctr*/
+  }
+
+  ~PrefixTrie ()
+  {
+    Clear ();
+    delete m_root;
+  }
+
+  /**
+   * \brief Store a value for the given prefix.
+   * \param network the network address (host bits are ignored)
+   * \param mask the network mask
+   * \param value the value to store
+   * \param atFront true to add the value in front of the existing values of the prefix
+   */
+  void Insert (Ipv4Address network, Ipv4Mask mask, const T &value, bool atFront)
+  {
+    uint32_t address = network.Get ();
+    uint16_t length = mask.GetPrefixLength ();
+    Node *node = m_root;
+
+    for (uint16_t depth = 0; depth < length; depth++)
+    {
+      uint8_t bit = GetBit (address, depth);
+      if (node->child[bit] == 0)
+      {
+        node->child[bit] = new Node ();
+        m_nNodes++;
+      }
+      node = node->child[bit];
+    }
+
+    if (atFront)
+      node->values.push_front (value);
+    else
+      node->values.push_back (value);
+    m_nValues++;
+  }
+
+  /**
+   * \brief Remove a value stored for the given prefix.
+   * Nodes that become empty are released.
+   * \param network the network address (host bits are ignored)
+   * \param mask the network mask
+   * \param value the value to remove
+   * \returns true if the value was found and removed
+   */
+  bool Remove (Ipv4Address network, Ipv4Mask mask, const T &value)
+  {
+    uint32_t address = network.Get ();
+    uint16_t length = mask.GetPrefixLength ();
+    Node *path[33];
+    Node *node = m_root;
+
+    path[0] = m_root;
+    for (uint16_t depth = 0; depth < length; depth++)
+    {
+      node = node->child[GetBit (address, depth)];
+      if (node == 0)
+        return false;
+      path[depth + 1] = node;
+    }
+
+    typename ValueList::iterator it;
+    for (it = node->values.begin (); it != node->values.end (); it++)
+    {
+      if (*it == value)
+        break;
+    }
+    if (it == node->values.end ())
+      return false;
+
+    node->values.erase (it);
+    m_nValues--;
+
+    // prune the branch bottom-up, the root is never released
+    for (uint16_t depth = length; depth > 0; depth--)
+    {
+      Node *current = path[depth];
+      if (!current->values.empty () || current->child[0] != 0 || current->child[1] != 0)
+        break;
+      path[depth - 1]->child[GetBit (address, depth - 1)] = 0;
+      delete current;
+      m_nNodes--;
+    }
+    return true;
+  }
+
+  /**
+   * \brief Find the values stored for exactly the given prefix.
+   * \param network the network address (host bits are ignored)
+   * \param mask the network mask
+   * \returns the list of values, or 0 if the prefix is not present
+   */
+  const ValueList* Find (Ipv4Address network, Ipv4Mask mask) const
+  {
+    uint32_t address = network.Get ();
+    uint16_t length = mask.GetPrefixLength ();
+    const Node *node = m_root;
+
+    for (uint16_t depth = 0; depth < length && node != 0; depth++)
+    {
+      node = node->child[GetBit (address, depth)];
+    }
+    if (node == 0 || node->values.empty ())
+      return 0;
+    return &node->values;
+  }
+
+  /**
+   * \brief Longest prefix match.
+   * The prefixes covering the destination are checked from the longest to the
+   * shortest. For each prefix the stored values are checked in list order and
+   * the first value accepted by the predicate is returned.
+   * \param destination the destination address
+   * \param accept predicate, bool operator() (const T &) const
+   * \param retValue the matched value
+   * \returns true if a value is found
+   */
+  template <typename Predicate>
+  bool LongestMatch (Ipv4Address destination, const Predicate &accept, T &retValue) const
+  {
+    uint32_t address = destination.Get ();
+    const Node *candidates[33];
+    uint8_t nCandidates = 0;
+    const Node *node = m_root;
+
+    for (uint16_t depth = 0; node != 0; depth++)
+    {
+      if (!node->values.empty ())
+        candidates[nCandidates++] = node;
+      if (depth == 32)
+        break;
+      node = node->child[GetBit (address, depth)];
+    }
+
+    while (nCandidates > 0)
+    {
+      const Node *candidate = candidates[--nCandidates];
+      for (typename ValueList::const_iterator it = candidate->values.begin ();
+           it != candidate->values.end (); it++)
+      {
+        if (accept (*it))
+        {
+          retValue = *it;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /**
+   * \brief Remove all prefixes and values.
+   */
+  void Clear ()
+  {
+    DeleteSubTree (m_root->child[0]);
+    DeleteSubTree (m_root->child[1]);
+    m_root->child[0] = 0;
+    m_root->child[1] = 0;
+    m_root->values.clear ();
+    m_nValues = 0;
+    m_nNodes = 1;
+  }
+
+  /**
+   * \returns the number of values stored in the trie
+   */
+  uint32_t GetNValues () const
+  {
+    return m_nValues;
+  }
+
+  /**
+   * \returns the number of allocated trie nodes (including the root)
+   */
+  uint32_t GetNNodes () const
+  {
+    return m_nNodes;
+  }
+
+  /**
+   * \returns the memory used by the nodes and the values, in bytes (estimate)
+   */
+  uint64_t GetMemorySize () const
+  {
+    // a value is kept in a list node, with two links
+    return uint64_t (m_nNodes) * sizeof (Node) + 
+           uint64_t (m_nValues) * (sizeof (T) + 2 * sizeof (void*));
+  }
+
+private:
+  /// A node of the trie
+  struct Node
+  {
+    Node ()
+    {
+      child[0] = 0;
+      child[1] = 0;
+    }
+    Node *child[2]; //!< the 0 and 1 branches
+    ValueList values; //!< the values stored for this prefix
+  };
+
+  /// The trie owns its nodes, copying is not allowed
+  PrefixTrie (const PrefixTrie &);
+  PrefixTrie& operator= (const PrefixTrie &);
+
+  static uint8_t GetBit (uint32_t address, uint16_t depth)
+  {
+    return (address >> (31 - depth)) & 0x01;
+  }
+
+  void DeleteSubTree (Node *node)
+  {
+    if (node == 0)
+      return;
+    DeleteSubTree (node->child[0]);
+    DeleteSubTree (node->child[1]);
+    delete node;
+  }
+
+  Node *m_root; //!< the root node (the zero length prefix)
+  uint32_t m_nValues; //!< number of stored values
+  uint32_t m_nNodes; //!< number of allocated nodes
+}; // end of class PrefixTrie
+
+}// end of namespace eslr
+}// end of namespace ns3
+#endif /* ESLR_PREFIX_TRIE_H */
@@ -18,7 +18,9 @@
 * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
 */
 
+#include <algorithm>
 #include <iomanip>
+#include <new>
 
 #include "eslr-route.h"
 
@@ -97,6 +99,110 @@ RoutingTableEntry::~RoutingTableEntry ()
   /*dstrctr*/
 }
 
+/* 
+* Routing Table Entry Pool
+*/
+
+RoutingTableEntryPool::RoutingTableEntryPool () : m_nextInBlock (ENTRIES_PER_BLOCK),
+                                                  m_nAllocations (0),
+                                                  m_nReleases (0)
+{
+  /*cstrctr*/
+}
+
+RoutingTableEntryPool::~RoutingTableEntryPool ()
+{
+  // the entries are not destroyed here, the owner releases the entries it uses
+  for (std::vector<void*>::iterator it = m_blocks.begin (); it != m_blocks.end (); it++)
+  {
+    ::operator delete (*it);
+  }
+  m_blocks.clear ();
+  m_freeEntries.clear ();
+}
+
+RoutingTableEntry* 
+RoutingTableEntryPool::Allocate (Ipv4Address network, 
+    Ipv4Mask networkMask, 
+    Ipv4Address nextHop, 
+    uint32_t interface)
+{
+  void *memory;
+  if (!m_freeEntries.empty ())
+  {
+    memory = m_freeEntries.back ();
+    m_freeEntries.pop_back ();
+  }
+  else
+  {
+    if (m_nextInBlock == ENTRIES_PER_BLOCK)
+    {
+      m_blocks.push_back (::operator new (ENTRIES_PER_BLOCK * sizeof (RoutingTableEntry)));
+      m_nextInBlock = 0;
+    }
+    memory = static_cast<char*> (m_blocks.back ()) + m_nextInBlock * sizeof (RoutingTableEntry);
+    m_nextInBlock++;
+  }
+
+  m_nAllocations++;
+  return new (memory) RoutingTableEntry (network, networkMask, nextHop, interface);
+}
+
+void 
+RoutingTableEntryPool::Release (RoutingTableEntry *route)
+{
+  NS_ASSERT (route != 0);
+  NS_ASSERT (m_nReleases < m_nAllocations);
+
+  route->~RoutingTableEntry ();
+  m_freeEntries.push_back (route);
+  m_nReleases++;
+}
+
+void 
+RoutingTableEntryPool::Print (std::ostream &os) const
+{
+  os << "Route entries: in use " << GetNEntriesInUse () 
+     << ", allocated " << m_nAllocations 
+     << ", released " << m_nReleases 
+     << ", capacity " << GetCapacity () 
+     << ", heap allocations " << GetNHeapAllocations ();
+}
+
+
+/*
+ * Memory Usage
+ */
+MemoryUsage::MemoryUsage () : records (0),
+                              liveObjects (0),
+                              pooledObjects (0),
+                              pendingEvents (0),
+                              bytes (0)
+{
+  /*cstrctr*/
+}
+
+MemoryUsage&
+MemoryUsage::operator+= (const MemoryUsage &usage)
+{
+  records += usage.records;
+  liveObjects += usage.liveObjects;
+  pooledObjects += usage.pooledObjects;
+  pendingEvents += usage.pendingEvents;
+  bytes += usage.bytes;
+  return *this;
+}
+
+std::ostream& 
+operator<< (std::ostream& os, MemoryUsage const& usage)
+{
+  os << "records " << usage.records 
+     << ", live " << usage.liveObjects 
+     << ", pooled " << usage.pooledObjects 
+     << ", pending events " << usage.pendingEvents 
+     << ", bytes " << usage.bytes;
+  return os;
+}
 
 /* 
 * Routing Table
@@ -134,7 +240,7 @@ RoutingTableEntry::~RoutingTableEntry ()
 * m_routing.PrintRoutingTable (stream, RoutingTable::MAIN)
 */
 
-RoutingTable::RoutingTable()
+RoutingTable::RoutingTable() : m_sequenceEpoch (0)
 {
   /*cnstrctur*/}
 
@@ -142,6 +248,34 @@ RoutingTable::~RoutingTable ()
 {
   /*dstrcter*/}
 
+void 
+RoutingTable::DoDispose ()
+{
+  m_timers.Clear ();
+
+  for (RoutesI it = m_mainRoutingTable.begin (); it != m_mainRoutingTable.end (); it++)
+  {
+    m_entryPool.Release (it->first);
+  }
+  for (RoutesI it = m_backupRoutingTable.begin (); it != m_backupRoutingTable.end (); it++)
+  {
+    m_entryPool.Release (it->first);
+  }
+
+  m_mainRoutingTable.clear ();
+  m_backupRoutingTable.clear ();
+  m_forwardingTable.Clear ();
+  m_prefixIndex.clear ();
+  m_mainNextHops.gateways.clear ();
+  m_mainNextHops.interfaces.clear ();
+  m_backupNextHops.gateways.clear ();
+  m_backupNextHops.interfaces.clear ();
+  m_nextHopPositions.clear ();
+  m_changedRoutes.clear ();
+  m_changedPositions.clear ();
+  m_sequenceEpochs.clear ();
+}
+
 void 
 RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry, 
 		Time invalidateTime, 
@@ -167,7 +301,7 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
 		if (isAvailable)
       return;
 
-    RoutingTableEntry* route1 = new RoutingTableEntry (
+    RoutingTableEntry* route1 = m_entryPool.Allocate (
 				routingTableEntry->GetDestNetwork (), 
 				routingTableEntry->GetDestNetworkMask (), 
 				routingTableEntry->GetGateway (), 
@@ -187,15 +321,13 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
     p.table = eslr::MAIN;
 
     Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-    EventId invalidateEvent = Simulator::Schedule (delay, 
+    TimerId invalidateEvent = m_timers.Schedule (delay, 
 				&RoutingTable::InvalidateRoute, 
 				this, 
 				route1, 
 				p);
 
-    m_mainRoutingTable.push_front (std::make_pair (route1, invalidateEvent));
-
-    delete routingTableEntry;    
+    InsertMainRoute (route1, invalidateEvent, true);
   }
   else if (table == eslr::BACKUP)
   {
@@ -209,7 +341,7 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
 					<< "/" 
 					<< int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 		 
-			RoutingTableEntry* route2 = new RoutingTableEntry (
+			RoutingTableEntry* route2 = m_entryPool.Allocate (
 					routingTableEntry->GetDestNetwork (), 
 					routingTableEntry->GetDestNetworkMask (), 
 					routingTableEntry->GetGateway (), 
@@ -222,7 +354,7 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
       route2->SetRouteChanged (true); 
 
       Time delay = settlingTime + Seconds (m_rng->GetValue (0.0, 5.0));
-      EventId moveToMainEvent = Simulator::Schedule (delay, 
+      TimerId moveToMainEvent = m_timers.Schedule (delay, 
 					&RoutingTable::MoveToMain, 
 					this, 
 					route2, 
@@ -230,9 +362,7 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
 					deleteTime, 
 					settlingTime);
 
-      m_backupRoutingTable.push_front (std::make_pair (route2, moveToMainEvent));
-      
-      delete routingTableEntry;
+      InsertBackupRoute (route2, moveToMainEvent);
     }
     else if (settlingTime.GetSeconds () == 0)
     {
@@ -243,7 +373,7 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
 					routingTableEntry->GetDestNetwork () << 
 					"/" << int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 
-      RoutingTableEntry* route3 = new RoutingTableEntry (
+      RoutingTableEntry* route3 = m_entryPool.Allocate (
 					routingTableEntry->GetDestNetwork (), routingTableEntry->GetDestNetworkMask (), 
 					routingTableEntry->GetGateway (), 
 					routingTableEntry->GetInterface ());
@@ -261,28 +391,91 @@ RoutingTable::AddRoute (RoutingTableEntry *routingTableEntry,
       p.invalidateType = eslr::EXPIRE;
       p.table = eslr::BACKUP;
       
-      EventId invalidateEvent;
+      TimerId invalidateEvent;
 
       if (routingTableEntry->GetRouteType () == eslr::PRIMARY)
       {
-        invalidateEvent = EventId ();
+        invalidateEvent = TimerId ();
       }
       else
       {      
         Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));        
-        invalidateEvent = Simulator::Schedule (delay, 
+        invalidateEvent = m_timers.Schedule (delay, 
 																							 &RoutingTable::InvalidateRoute, 
 																							 this, 
 																							 route3, 
 																							 p);
       }
-      m_backupRoutingTable.push_front (std::make_pair (route3, invalidateEvent));
-      
-      delete routingTableEntry;      
+      InsertBackupRoute (route3, invalidateEvent);
     }
   }
 }
 
+void
+RoutingTable::AddNewRoutes (const std::vector<RoutingTableEntry> &routes, 
+		Time invalidateTime, 
+		Time deleteTime)
+{
+  NS_LOG_FUNCTION (this << routes.size ());
+
+  invalidateParams  p;
+  p.invalidateTime = invalidateTime;
+  p.deleteTime = deleteTime;
+  p.settlingTime = Seconds (0);
+  p.invalidateType = eslr::EXPIRE;
+  p.table = eslr::MAIN;
+
+  for (std::vector<RoutingTableEntry>::const_iterator it = routes.begin (); it != routes.end (); it++)
+  {
+    // One index lookup tells whether the destination is still new
+    RouteSet routeSet;
+    FindRouteSet (it->GetDestNetwork (), it->GetDestNetworkMask (), routeSet);
+
+    if (routeSet.hasLocalRoute || routeSet.foundPrimary)
+    {
+      NS_LOG_LOGIC ("Skip the route to a known destination " << 
+          it->GetDestNetwork () << "/" << int (it->GetDestNetworkMask ().GetPrefixLength ()));
+      continue;
+    }
+
+    NS_LOG_DEBUG ("Added a new Route to Main and Backup Tables " 
+                  << it->GetDestNetwork () << "/" 
+                  << int (it->GetDestNetworkMask ().GetPrefixLength ()));
+
+    // the m-route, which expires after the invalidate time
+    RoutingTableEntry* mainRoute = m_entryPool.Allocate (it->GetDestNetwork (), 
+				it->GetDestNetworkMask (), 
+				it->GetGateway (), 
+				it->GetInterface ());
+		mainRoute->SetValidity (it->GetValidity ());
+    mainRoute->SetSequenceNo (it->GetSequenceNo ());
+    mainRoute->SetRouteType (eslr::PRIMARY);
+    mainRoute->SetMetric (it->GetMetric ());
+    mainRoute->SetRouteChanged (true); 
+
+    Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
+    TimerId invalidateEvent = m_timers.Schedule (delay, 
+				&RoutingTable::InvalidateRoute, 
+				this, 
+				mainRoute, 
+				p);
+    InsertMainRoute (mainRoute, invalidateEvent, true);
+
+    // the r-route, which follows the m-route and has no timer of its own
+    RoutingTableEntry* primaryRoute = m_entryPool.Allocate (it->GetDestNetwork (), 
+				it->GetDestNetworkMask (), 
+				it->GetGateway (), 
+				it->GetInterface ());
+		primaryRoute->SetValidity (it->GetValidity ());
+    primaryRoute->SetSequenceNo (it->GetSequenceNo ());
+    primaryRoute->SetRouteType (eslr::PRIMARY);
+    primaryRoute->SetMetric (it->GetMetric ());
+    primaryRoute->SetRouteChanged (true); 
+
+    InsertBackupRoute (primaryRoute, TimerId ());
+  }
+}
+
 void
 RoutingTable::MoveToMain (RoutingTableEntry *routingTableEntry, 
 		Time invalidateTime, 
@@ -347,10 +540,10 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
                     << routingTableEntry->GetDestNetwork () 
                     << "/" << int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 
-      RoutingTableEntry* route1 = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                         routingTableEntry->GetDestNetworkMask (), 
-                                                         routingTableEntry->GetGateway (), 
-                                                         routingTableEntry->GetInterface ());
+      RoutingTableEntry* route1 = m_entryPool.Allocate (routingTableEntry->GetDestNetwork (), 
+                                                        routingTableEntry->GetDestNetworkMask (), 
+                                                        routingTableEntry->GetGateway (), 
+                                                        routingTableEntry->GetInterface ());
       route1->SetValidity (routingTableEntry->GetValidity ());
       route1->SetSequenceNo (routingTableEntry->GetSequenceNo ());
       route1->SetRouteType (eslr::PRIMARY);
@@ -365,9 +558,7 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
         route1->SetRouteChanged (true);       
       }     
 
-      m_mainRoutingTable.push_back (std::make_pair (route1,EventId ()));
-
-      delete routingTableEntry;      
+      InsertMainRoute (route1, TimerId (), false);
     }
     else
     {
@@ -376,10 +567,10 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
                     << routingTableEntry->GetDestNetwork () 
                     << "/" << int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 
-      RoutingTableEntry* route2 = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                         routingTableEntry->GetDestNetworkMask (), 
-                                                         routingTableEntry->GetGateway (), 
-                                                         routingTableEntry->GetInterface ());
+      RoutingTableEntry* route2 = m_entryPool.Allocate (routingTableEntry->GetDestNetwork (), 
+                                                        routingTableEntry->GetDestNetworkMask (), 
+                                                        routingTableEntry->GetGateway (), 
+                                                        routingTableEntry->GetInterface ());
       route2->SetValidity (routingTableEntry->GetValidity ());
       route2->SetSequenceNo (routingTableEntry->GetSequenceNo ());
       route2->SetRouteType (eslr::PRIMARY);
@@ -394,15 +585,13 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
       p.table = eslr::MAIN;
 
       Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-      EventId invalidateEvent = Simulator::Schedule (delay, 
+      TimerId invalidateEvent = m_timers.Schedule (delay, 
 					&RoutingTable::InvalidateRoute, 
 					this, 
 					route2, 
 					p);
 
-      m_mainRoutingTable.push_back (std::make_pair (routingTableEntry,invalidateEvent));
-      
-      delete routingTableEntry;      
+      InsertMainRoute (route2, invalidateEvent, false);
     }
   }
   else if (table == eslr::BACKUP)
@@ -415,10 +604,10 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
                     << routingTableEntry->GetDestNetwork () 
                     <<  "/" << int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 
-      RoutingTableEntry* route4 = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                         routingTableEntry->GetDestNetworkMask (), 
-                                                         routingTableEntry->GetGateway (), 
-                                                         routingTableEntry->GetInterface ());
+      RoutingTableEntry* route4 = m_entryPool.Allocate (routingTableEntry->GetDestNetwork (), 
+                                                        routingTableEntry->GetDestNetworkMask (), 
+                                                        routingTableEntry->GetGateway (), 
+                                                        routingTableEntry->GetInterface ());
 
 			route4->SetValidity (routingTableEntry->GetValidity ());
       route4->SetSequenceNo (routingTableEntry->GetSequenceNo ());
@@ -427,13 +616,11 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
       route4->SetRouteChanged (true); 
 
       Time delay = settlingTime + Seconds (m_rng->GetValue (0.0, 5.0));
-      EventId moveToMainEvent = Simulator::Schedule (delay, &RoutingTable::MoveToMain, 
-                                                     this, route4, invalidateTime, 
-                                                     deleteTime, settlingTime);
+      TimerId moveToMainEvent = m_timers.Schedule (delay, &RoutingTable::MoveToMain, 
+                                                   this, route4, invalidateTime, 
+                                                   deleteTime, settlingTime);
 
-      m_backupRoutingTable.push_front (std::make_pair (routingTableEntry,moveToMainEvent));
-      
-      delete routingTableEntry;      
+      InsertBackupRoute (route4, moveToMainEvent);
     }
     else if (settlingTime.GetSeconds () == 0)
     {
@@ -443,10 +630,10 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
                     << routingTableEntry->GetDestNetwork () << 
                     "/" << int (routingTableEntry->GetDestNetworkMask ().GetPrefixLength ()));
 
-      RoutingTableEntry* route3 = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                         routingTableEntry->GetDestNetworkMask (), 
-                                                         routingTableEntry->GetGateway (), 
-                                                         routingTableEntry->GetInterface ());
+      RoutingTableEntry* route3 = m_entryPool.Allocate (routingTableEntry->GetDestNetwork (), 
+                                                        routingTableEntry->GetDestNetworkMask (), 
+                                                        routingTableEntry->GetGateway (), 
+                                                        routingTableEntry->GetInterface ());
 
 			route3->SetValidity (routingTableEntry->GetValidity ());
       route3->SetSequenceNo (routingTableEntry->GetSequenceNo ());
@@ -462,15 +649,13 @@ RoutingTable::AddHostRoute (RoutingTableEntry *routingTableEntry,
       p.table = eslr::BACKUP;
 
       Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-      EventId invalidateEvent = Simulator::Schedule (delay, 
+      TimerId invalidateEvent = m_timers.Schedule (delay, 
 					&RoutingTable::InvalidateRoute, 
 					this, 
 					route3, 
 					p);
 
-      m_backupRoutingTable.push_front (std::make_pair (routingTableEntry,invalidateEvent));
-      
-      delete routingTableEntry;
+      InsertBackupRoute (route3, invalidateEvent);
     }
   }
 }
@@ -482,32 +667,29 @@ RoutingTable::DeleteRoute (RoutingTableEntry *routingTableEntry,
   NS_LOG_FUNCTION (this << *routingTableEntry);
   bool retVal = false;
 
+  // The record is found among the records of its prefix, instead of scanning the table
+  const PrefixRoutes *routes = LookupPrefixRoutes (routingTableEntry->GetDestNetwork (), 
+                                                   routingTableEntry->GetDestNetworkMask ());
+  if (routes == 0)
+    return retVal;
+
+  RoutesI it;
   if (table == eslr::MAIN)
   {
     NS_LOG_DEBUG ("Delete the Main Route");
-    for (RoutesI it = m_mainRoutingTable.begin (); it != m_mainRoutingTable.end (); it++)
+    if (FindGivenRecord (routes->mainRecords, routingTableEntry, it))
     {
-      if (it->first == routingTableEntry)
-      {
-        //delete routingTableEntry;      
-        m_mainRoutingTable.erase (it);
-        retVal = true;
-        break;
-      }
+      EraseMainRoute (it);
+      retVal = true;
     }
   }
   else if (table == eslr::BACKUP)
   { 
     NS_LOG_DEBUG ("Delete either Primary or Backup Route");
-    for (RoutesI it = m_backupRoutingTable.begin (); it != m_backupRoutingTable.end (); it++)
+    if (FindGivenRecord (routes->backupRecords, routingTableEntry, it))
     {
-      if (it->first == routingTableEntry)            
-      {
-        delete routingTableEntry;      
-        m_backupRoutingTable.erase (it);
-        retVal = true;
-        break;
-      }
+      EraseBackupRoute (it);
+      retVal = true;
     }
   }
   return retVal;
@@ -531,20 +713,23 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
 	if (param.table == eslr::MAIN)
 	{
-    bool foundInMain, foundPrimaryRoute, foundBackupRoute;
-    
+    // A single lookup gives all the routes of the destination prefix
+    const PrefixRoutes *routes = LookupPrefixRoutes (routingTableEntry->GetDestNetwork (), 
+                                                     routingTableEntry->GetDestNetworkMask ());
+    RouteSet routeSet;
+    ResolveRouteSet (routes, routeSet);
+
     // Main Route (Which is in the Main Table)       
-		RoutesI mainRoute =  FindGivenRouteRecord (routingTableEntry, foundInMain, eslr::MAIN);
+    RoutesI mainRoute;
+    bool foundInMain = (routes != 0) && FindGivenRecord (routes->mainRecords, routingTableEntry, mainRoute);
 
     // Primary route (Main route's reference, which is in the Backup Table)
-    RoutesI primaryRoute = FindRouteInBackupForDestination (routingTableEntry->GetDestNetwork (), 
-                                                routingTableEntry->GetDestNetworkMask (), 
-                                                foundPrimaryRoute, eslr::PRIMARY);
+    RoutesI primaryRoute = routeSet.primaryRoute;
+    bool foundPrimaryRoute = routeSet.foundPrimary;
 
     // Backup Route (the secondary route for the main route, which is in the Backup Table)
-    RoutesI secondaryRoute = FindRouteInBackupForDestination (routingTableEntry->GetDestNetwork (), 
-                                               routingTableEntry->GetDestNetworkMask (), 
-                                               foundBackupRoute, eslr::SECONDARY);
+    RoutesI secondaryRoute = routeSet.secondaryRoute;
+    bool foundBackupRoute = routeSet.foundSecondary;
                                                
 		if (!foundInMain)
 		{
@@ -557,7 +742,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 		{
       if (foundBackupRoute && 
           (secondaryRoute->first->GetMetric () < primaryRoute->first->GetMetric ())/* && 
-          (Simulator::GetDelayLeft (secondaryRoute->second) < ((param.invalidateTime/3)*2))*/)
+          (secondaryRoute->second.GetDelayLeft () < ((param.invalidateTime/3)*2))*/)
 			{
 			  // Todo: Check above condition
 			  
@@ -579,23 +764,21 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
         
         secondaryRoute->first->SetValidity (eslr::INVALID);
         secondaryRoute->second.Cancel ();         
-        m_backupRoutingTable.erase (secondaryRoute);        
+        EraseBackupRoute (secondaryRoute);        
         
-        RoutingTableEntry* m_route = new RoutingTableEntry (destination, 
+        RoutingTableEntry m_route (destination, 
 						mask, 
 						gateway, 
 						interface);
         
-				m_route->SetValidity (eslr::VALID);
-        m_route->SetSequenceNo (sequenceNo);
-        m_route->SetRouteType (eslr::PRIMARY);
-        m_route->SetMetric (cost);
-        m_route->SetRouteChanged (true);          
+				m_route.SetValidity (eslr::VALID);
+        m_route.SetSequenceNo (sequenceNo);
+        m_route.SetRouteType (eslr::PRIMARY);
+        m_route.SetMetric (cost);
+        m_route.SetRouteChanged (true);          
         
 
-        delete routingTableEntry;
-        //delete mainRoute->first;
-        mainRoute->first = m_route;
+        UpdateRouteEntry (mainRoute, m_route, eslr::MAIN);
         
 			  p.settlingTime = Seconds (0);
 			  p.invalidateType = eslr::EXPIRE;
@@ -603,52 +786,50 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
         mainRoute->second.Cancel ();          
         Time delay = param.invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute,
 					 	this, 
-						m_route, 
+						mainRoute->first, 
 						p);
                 
-        RoutingTableEntry* p_route = new RoutingTableEntry (destination, 
+        RoutingTableEntry p_route (destination, 
 						mask, 
 						gateway, 
 						interface);
         
-				p_route->SetValidity (eslr::VALID);
-        p_route->SetSequenceNo (sequenceNo);
-        p_route->SetRouteType (eslr::PRIMARY);
-        p_route->SetMetric (cost);
-        p_route->SetRouteChanged (true);           
+				p_route.SetValidity (eslr::VALID);
+        p_route.SetSequenceNo (sequenceNo);
+        p_route.SetRouteType (eslr::PRIMARY);
+        p_route.SetMetric (cost);
+        p_route.SetRouteChanged (true);           
         
-        delete primaryRoute->first;
-        primaryRoute->first = p_route;
+        UpdateRouteEntry (primaryRoute, p_route, eslr::BACKUP);
         
         primaryRoute->second.Cancel ();         
-        primaryRoute->second = EventId ();
+        primaryRoute->second = TimerId ();
 				
 				return retVal = true;			  			  
 			}
-			else if (Simulator::GetDelayLeft (primaryRoute->second) >= 0)
+			else if (primaryRoute->second.GetDelayLeft () >= 0)
 			{
 				// TODO compare the sequence number and update
 			  // As a primary route is there (always) 
 			  // the main route updates according to the primary route
 			  NS_LOG_DEBUG ("Update the main route " << *mainRoute->first << "based on the primary route.");
 
-        RoutingTableEntry* m_route = new RoutingTableEntry (primaryRoute->first->GetDestNetwork (), 
-                                                            primaryRoute->first->GetDestNetworkMask (),
-                                                            primaryRoute->first->GetGateway (), 
-                                                            primaryRoute->first->GetInterface ());
+        RoutingTableEntry m_route (primaryRoute->first->GetDestNetwork (), 
+                                   primaryRoute->first->GetDestNetworkMask (),
+                                   primaryRoute->first->GetGateway (),
+                                   primaryRoute->first->GetInterface ());
         
-				m_route->SetMetric (primaryRoute->first->GetMetric ());
-        m_route->SetSequenceNo (primaryRoute->first->GetSequenceNo ());
-        m_route->SetValidity (eslr::VALID);
-        m_route->SetRouteType (eslr::PRIMARY);
-        m_route->SetRouteChanged (true);
+				m_route.SetMetric (primaryRoute->first->GetMetric ());
+        m_route.SetSequenceNo (primaryRoute->first->GetSequenceNo ());
+        m_route.SetValidity (eslr::VALID);
+        m_route.SetRouteType (eslr::PRIMARY);
+        m_route.SetRouteChanged (true);
 
-        delete routingTableEntry;
         
-				mainRoute->first = m_route;
+				UpdateRouteEntry (mainRoute, m_route, eslr::MAIN);
 
 			  p.settlingTime = Seconds (0);
 			  p.invalidateType = eslr::EXPIRE;
@@ -656,14 +837,14 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
         
         mainRoute->second.Cancel ();
         delay = param.invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute, 
 						this,
-						m_route, 
+						mainRoute->first, 
 						p);
 
         primaryRoute->second.Cancel ();                                                   
-        primaryRoute->second = EventId ();
+        primaryRoute->second = TimerId ();
         
         return retVal = true;			  
 			}
@@ -678,11 +859,11 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
         if (foundInMain)
         {
-          mainRoute->first->SetValidity (eslr::INVALID);
-          mainRoute->first->SetRouteChanged (true);
+          SetMainRouteValidity (mainRoute, eslr::INVALID);
+          MarkRouteChanged (mainRoute);
 
           mainRoute->second.Cancel ();
-          mainRoute->second = Simulator::Schedule (delay, 
+          mainRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::DeleteRoute, 
 							this,
 							routingTableEntry, 
@@ -695,7 +876,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
           primaryRoute->first->SetValidity (eslr::INVALID);
           primaryRoute->first->SetRouteChanged (true);
-          primaryRoute->second = Simulator::Schedule (delay, 
+          primaryRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::DeleteRoute, 
 							this,
 							primaryRoute->first, 
@@ -727,21 +908,20 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
         
         secondaryRoute->first->SetValidity (eslr::INVALID);          
         secondaryRoute->second.Cancel ();      
-        m_backupRoutingTable.erase (secondaryRoute);                         
+        EraseBackupRoute (secondaryRoute);                         
         
-        RoutingTableEntry* m_route = new RoutingTableEntry (destination, 
+        RoutingTableEntry m_route (destination, 
 						mask, 
 						gateway, 
 						interface);
         
-				m_route->SetValidity (eslr::VALID);
-        m_route->SetSequenceNo (sequenceNo);
-        m_route->SetRouteType (eslr::PRIMARY);
-        m_route->SetMetric (cost);
-        m_route->SetRouteChanged (true);
+				m_route.SetValidity (eslr::VALID);
+        m_route.SetSequenceNo (sequenceNo);
+        m_route.SetRouteType (eslr::PRIMARY);
+        m_route.SetMetric (cost);
+        m_route.SetRouteChanged (true);
                   
-        delete routingTableEntry;
-        mainRoute->first = m_route;
+        UpdateRouteEntry (mainRoute, m_route, eslr::MAIN);
         
 			  p.settlingTime = Seconds (0);
 			  p.invalidateType = eslr::EXPIRE;
@@ -750,28 +930,27 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
         mainRoute->second.Cancel ();
         
         Time delay = param.invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute, 
 						this, 
-						m_route, 
+						mainRoute->first, 
 						p); 
                                                  
-        RoutingTableEntry* p_route = new RoutingTableEntry (destination, 
+        RoutingTableEntry p_route (destination, 
 						mask, 
 						gateway, 
 						interface);
         
-				p_route->SetValidity (eslr::VALID);
-        p_route->SetSequenceNo (sequenceNo);
-        p_route->SetRouteType (eslr::PRIMARY);
-        p_route->SetMetric (cost);
-        p_route->SetRouteChanged (true);          
+				p_route.SetValidity (eslr::VALID);
+        p_route.SetSequenceNo (sequenceNo);
+        p_route.SetRouteType (eslr::PRIMARY);
+        p_route.SetMetric (cost);
+        p_route.SetRouteChanged (true);          
         
-        delete primaryRoute->first;
-        primaryRoute->first = p_route;        
+        UpdateRouteEntry (primaryRoute, p_route, eslr::BACKUP);        
         
         primaryRoute->second.Cancel ();         
-        primaryRoute->second = EventId (); 
+        primaryRoute->second = TimerId (); 
         
         std::cout << int(m_nodeId)<<" :updating the route " << destination << "/" << mask << " for the gateway " << gateway << std::endl;         
 				
@@ -788,11 +967,11 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
         
         if (foundInMain)
         { 
-          mainRoute->first->SetValidity (eslr::DISCONNECTED);
-          mainRoute->first->SetRouteChanged (true);
+          SetMainRouteValidity (mainRoute, eslr::DISCONNECTED);
+          MarkRouteChanged (mainRoute);
           
           mainRoute->second.Cancel ();
-          mainRoute->second = Simulator::Schedule (delay, 
+          mainRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::DeleteRoute, 
 							this, 
 							routingTableEntry, 
@@ -804,7 +983,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
           primaryRoute->first->SetValidity (eslr::DISCONNECTED);
           primaryRoute->first->SetRouteChanged (true);
-          primaryRoute->second = Simulator::Schedule (delay, 
+          primaryRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::DeleteRoute, 
 							this, 
 							primaryRoute->first,
@@ -827,11 +1006,11 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
       
       if (foundInMain)
       { 
-        mainRoute->first->SetValidity (eslr::DISCONNECTED);
-        mainRoute->first->SetRouteChanged (true);
+        SetMainRouteValidity (mainRoute, eslr::DISCONNECTED);
+        MarkRouteChanged (mainRoute);
         
         mainRoute->second.Cancel ();
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::DeleteRoute, 
 						this, 
 						routingTableEntry, 
@@ -843,7 +1022,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 
         primaryRoute->first->SetValidity (eslr::DISCONNECTED);
         primaryRoute->first->SetRouteChanged (true);
-        primaryRoute->second = Simulator::Schedule (delay, 
+        primaryRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::DeleteRoute, 
 						this, 
 						primaryRoute->first, 
@@ -866,8 +1045,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
 		{
 		  secondaryRoute->first->SetValidity (eslr::INVALID);
       secondaryRoute->second.Cancel (); 
-      delete routingTableEntry;
-      m_backupRoutingTable.erase (secondaryRoute); 
+      EraseBackupRoute (secondaryRoute); 
 		}
 		else if (routingTableEntry->GetRouteType () == eslr::PRIMARY)
 		{	
@@ -877,7 +1055,7 @@ RoutingTable::InvalidateRoute (RoutingTableEntry *routingTableEntry,
       // even accidentally they do, in this point, that will be corrected.
 
       secondaryRoute->second.Cancel (); 
-      secondaryRoute->second = EventId ();  
+      secondaryRoute->second = TimerId ();  
       
       return (retVal = true);
 		}
@@ -903,19 +1081,25 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
 
   if (table == eslr::MAIN)
   {
+    // A single lookup gives all the routes of the destination prefix
+    const PrefixRoutes *routes = LookupPrefixRoutes (routingTableEntry->GetDestNetwork (), 
+                                                     routingTableEntry->GetDestNetworkMask ());
+    RouteSet routeSet;
+    ResolveRouteSet (routes, routeSet);
+
     // Main Route (Which is in the Main Table)    
-    bool foundInMain, foundPrimaryRoute, foundBackupRoute;
-    RoutesI mainRoute =  FindValidRouteRecordForDestination (routingTableEntry->GetDestNetwork (), 
-                                                 routingTableEntry->GetDestNetworkMask (), 
-                                                 routingTableEntry->GetGateway (), foundInMain, eslr::MAIN);
+    RoutesI mainRoute;
+    bool foundInMain = (routes != 0) && FindValidRecordForGateway (routes->mainRecords, 
+                                                                   routingTableEntry->GetGateway (), 
+                                                                   mainRoute);
 
     // Primary route (Main route's agent in the Backup Table)
-    RoutesI primaryRoute =  FindGivenRouteRecord (routingTableEntry, foundPrimaryRoute, eslr::BACKUP);
+    RoutesI primaryRoute;
+    bool foundPrimaryRoute = (routes != 0) && FindGivenRecord (routes->backupRecords, routingTableEntry, primaryRoute);
 
     // Backup Route (the secondary route for the main route, which is in the Backup Table)
-    RoutesI secondaryRoute = FindRouteInBackupForDestination (routingTableEntry->GetDestNetwork (), 
-                                                  routingTableEntry->GetDestNetworkMask (), 
-                                                  foundBackupRoute, eslr::SECONDARY);    
+    RoutesI secondaryRoute = routeSet.secondaryRoute;
+    bool foundBackupRoute = routeSet.foundSecondary;
     // For the routes learned by neighbors, 
     // update both Main and Primary route in Main and backup routing tables respectively.
 
@@ -939,17 +1123,16 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
         
         secondaryRoute->first->SetValidity (eslr::INVALID);        
         secondaryRoute->second.Cancel ();
-        m_backupRoutingTable.erase (secondaryRoute);                         
+        EraseBackupRoute (secondaryRoute);                         
         
-        RoutingTableEntry* m_route = new RoutingTableEntry (destination, mask, gateway, interface);
-        m_route->SetValidity (eslr::VALID);
-        m_route->SetSequenceNo (sequenceNo);
-        m_route->SetRouteType (eslr::PRIMARY);
-        m_route->SetMetric (cost);
-        m_route->SetRouteChanged (true);  
+        RoutingTableEntry m_route (destination, mask, gateway, interface);
+        m_route.SetValidity (eslr::VALID);
+        m_route.SetSequenceNo (sequenceNo);
+        m_route.SetRouteType (eslr::PRIMARY);
+        m_route.SetMetric (cost);
+        m_route.SetRouteChanged (true);  
               
-		    delete mainRoute->first;
-        mainRoute->first = m_route;
+        UpdateRouteEntry (mainRoute, m_route, eslr::MAIN);
         
         invalidateParams  p;
         p.invalidateTime = invalidateTime;
@@ -960,45 +1143,43 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
 
         mainRoute->second.Cancel ();        
         Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute,
 						this, 
-						m_route, 
+						mainRoute->first, 
 						p);
                 
-        RoutingTableEntry* p_route = new RoutingTableEntry (destination, 
+        RoutingTableEntry p_route (destination, 
 						mask, 
 						gateway, 
 						interface);
 
-        p_route->SetValidity (eslr::VALID);
-        p_route->SetSequenceNo (sequenceNo);
-        p_route->SetRouteType (eslr::PRIMARY);
-        p_route->SetMetric (cost);
-        p_route->SetRouteChanged (true);            
+        p_route.SetValidity (eslr::VALID);
+        p_route.SetSequenceNo (sequenceNo);
+        p_route.SetRouteType (eslr::PRIMARY);
+        p_route.SetMetric (cost);
+        p_route.SetRouteChanged (true);            
         
-        delete routingTableEntry;
-        primaryRoute->first = p_route;
+        UpdateRouteEntry (primaryRoute, p_route, eslr::BACKUP);
         
         primaryRoute->second.Cancel ();         
-        primaryRoute->second = EventId ();
+        primaryRoute->second = TimerId ();
         
         return retVal = true;
       }
       else
       {
-        RoutingTableEntry* m_route = new RoutingTableEntry (routingTableEntry->GetDestNetwork (),
-                                                            routingTableEntry->GetDestNetworkMask (),
-                                                            routingTableEntry->GetGateway (), 
-                                                            routingTableEntry->GetInterface ());
-        m_route->SetValidity (eslr::VALID);
-        m_route->SetSequenceNo (routingTableEntry->GetSequenceNo ());
-        m_route->SetRouteType (eslr::PRIMARY);
-        m_route->SetMetric (routingTableEntry->GetMetric ());
-        m_route->SetRouteChanged (true);
-
-        delete mainRoute->first;
-        mainRoute->first = m_route;
+        RoutingTableEntry m_route (routingTableEntry->GetDestNetwork (),
+                                   routingTableEntry->GetDestNetworkMask (),
+                                   routingTableEntry->GetGateway (),
+                                   routingTableEntry->GetInterface ());
+        m_route.SetValidity (eslr::VALID);
+        m_route.SetSequenceNo (routingTableEntry->GetSequenceNo ());
+        m_route.SetRouteType (eslr::PRIMARY);
+        m_route.SetMetric (routingTableEntry->GetMetric ());
+        m_route.SetRouteChanged (true);
+
+        UpdateRouteEntry (mainRoute, m_route, eslr::MAIN);
 
         invalidateParams  p;
         p.invalidateTime = invalidateTime;
@@ -1010,14 +1191,14 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
         mainRoute->second.Cancel ();
         
 				Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));
-        mainRoute->second = Simulator::Schedule (delay, 
+        mainRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute, 
 						this, 
-						m_route, 
+						mainRoute->first, 
 						p); 
         
         primaryRoute->second.Cancel ();
-        primaryRoute->second = EventId (); 
+        primaryRoute->second = TimerId (); 
         
 				return retVal = true;                
       }
@@ -1025,18 +1206,18 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
   }
   else if (table == eslr::BACKUP)
   {    
-    bool foundPrimary, foundSecondary;
-
+    RouteSet routeSet;
+    FindRouteSet (routingTableEntry->GetDestNetwork (), 
+                  routingTableEntry->GetDestNetworkMask (), 
+                  routeSet);
                                         
     // Primary route (Main route's agent in the Backup Table)
-    RoutesI primaryRoute = FindRouteInBackupForDestination (routingTableEntry->GetDestNetwork (), 
-                                                routingTableEntry->GetDestNetworkMask (), 
-                                                foundPrimary, eslr::PRIMARY);
+    RoutesI primaryRoute = routeSet.primaryRoute;
+    bool foundPrimary = routeSet.foundPrimary;
 
     // Backup Route (the secondary route for the main route, which is in the Backup Table)
-    RoutesI secondaryRoute = FindRouteInBackupForDestination (routingTableEntry->GetDestNetwork (), 
-                                               routingTableEntry->GetDestNetworkMask (), 
-                                               foundSecondary, eslr::SECONDARY);
+    RoutesI secondaryRoute = routeSet.secondaryRoute;
+    bool foundSecondary = routeSet.foundSecondary;
 
     if (routingTableEntry->GetRouteType () == eslr::PRIMARY)
     {        
@@ -1046,31 +1227,30 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
         NS_LOG_DEBUG ("Update the primary route.");      
         // Update the primary route and,
         // schedule an event to add the updated route after a settling time.
-        RoutingTableEntry* route = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                          routingTableEntry->GetDestNetworkMask (),
-                                                          routingTableEntry->GetGateway (), 
-                                                          routingTableEntry->GetInterface ());
-
-        route->SetValidity (routingTableEntry->GetValidity ());
-        route->SetSequenceNo (routingTableEntry->GetSequenceNo ());
-        route->SetRouteType (eslr::PRIMARY);
-        route->SetMetric (routingTableEntry->GetMetric ());
-        route->SetRouteChanged (true);
+        RoutingTableEntry route (routingTableEntry->GetDestNetwork (), 
+                                 routingTableEntry->GetDestNetworkMask (),
+                                 routingTableEntry->GetGateway (),
+                                 routingTableEntry->GetInterface ());
+
+        route.SetValidity (routingTableEntry->GetValidity ());
+        route.SetSequenceNo (routingTableEntry->GetSequenceNo ());
+        route.SetRouteType (eslr::PRIMARY);
+        route.SetMetric (routingTableEntry->GetMetric ());
+        route.SetRouteChanged (true);
       
-        delete primaryRoute->first;
-        primaryRoute->first = route;           
+        UpdateRouteEntry (primaryRoute, route, eslr::BACKUP);           
 
         if (routingTableEntry->GetMetric () >= primaryRoute->first->GetMetric ()) // A critical update >= to prevent route oscillation
         {
           // As the cost is same, the event will not cancel off.
           // let the event to be expired and move/update the route to main table.
-          Time delay = Simulator::GetDelayLeft (primaryRoute->second) + Seconds (m_rng->GetValue (0.0, 4.0));
+          Time delay = primaryRoute->second.GetDelayLeft () + Seconds (m_rng->GetValue (0.0, 4.0));
           
           primaryRoute->second.Cancel ();         
-					primaryRoute->second = Simulator::Schedule (delay, 
+					primaryRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::MoveToMain, 
 							this, 
-							route, 
+							primaryRoute->first, 
 							invalidateTime, 
 							deleteTime, 
 							settlingTime); 
@@ -1080,16 +1260,15 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
           Time delay = settlingTime + Seconds (m_rng->GetValue (0.0, 5.0)); 
 					
 					primaryRoute->second.Cancel ();					
-          primaryRoute->second = Simulator::Schedule (delay, 
+          primaryRoute->second = m_timers.Schedule (delay, 
 							&RoutingTable::MoveToMain, 
 							this,
-							route, 
+							primaryRoute->first, 
 							invalidateTime, 
 							deleteTime, 
 							settlingTime);          
         }
 
-        delete routingTableEntry;
         return retVal = true; 
       }
       else
@@ -1102,19 +1281,18 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
       {        
         // update the secondary record and,
         // schedule and event to expire the route.
-        RoutingTableEntry* route = new RoutingTableEntry (routingTableEntry->GetDestNetwork (), 
-                                                          routingTableEntry->GetDestNetworkMask (), 
-                                                          routingTableEntry->GetGateway (), 
-                                                          routingTableEntry->GetInterface ());
+        RoutingTableEntry route (routingTableEntry->GetDestNetwork (), 
+                                 routingTableEntry->GetDestNetworkMask (),
+                                 routingTableEntry->GetGateway (),
+                                 routingTableEntry->GetInterface ());
 
-				route->SetValidity (routingTableEntry->GetValidity ());
-        route->SetSequenceNo (routingTableEntry->GetSequenceNo ());
-        route->SetRouteType (eslr::SECONDARY);
-        route->SetMetric (routingTableEntry->GetMetric ());
-        route->SetRouteChanged (true);
+				route.SetValidity (routingTableEntry->GetValidity ());
+        route.SetSequenceNo (routingTableEntry->GetSequenceNo ());
+        route.SetRouteType (eslr::SECONDARY);
+        route.SetMetric (routingTableEntry->GetMetric ());
+        route.SetRouteChanged (true);
 
-        delete secondaryRoute->first;
-        secondaryRoute->first = route;
+        UpdateRouteEntry (secondaryRoute, route, eslr::BACKUP);
 
         secondaryRoute->second.Cancel (); 
 
@@ -1128,13 +1306,12 @@ RoutingTable::UpdateNetworkRoute (RoutingTableEntry *routingTableEntry,
         p.table = eslr::BACKUP;      
 
         Time delay = invalidateTime + Seconds (m_rng->GetValue (0.0, 2.0));                
-        secondaryRoute->second = Simulator::Schedule (delay, 
+        secondaryRoute->second = m_timers.Schedule (delay, 
 						&RoutingTable::InvalidateRoute, 
 						this, 
-						route, 
+						secondaryRoute->first, 
 						p);   
                                                       
-        delete routingTableEntry;                                                       
         return retVal = true;            
       }
       else 
@@ -1151,14 +1328,16 @@ RoutingTable::UpdateLocalRoute (Ipv4Address destination,
 		Ipv4Mask netMask, 
 		uint32_t metric)
 {
-  for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+  const PrefixRecords *records = LookupPrefix (destination, netMask, eslr::MAIN);
+  if (records == 0)
+    return;
+
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    if ((it->first->GetDestNetwork () == destination) &&
-        (it->first->GetDestNetworkMask () == netMask) &&
-        (it->first->GetGateway () == Ipv4Address::GetZero ()))
+    if ((*it)->first->GetGateway () == Ipv4Address::GetZero ())
     {
-      it->first->SetMetric (metric);
-      it->first->SetRouteChanged (true);
+      (*it)->first->SetMetric (metric);
+      MarkRouteChanged (*it);
       return;
     }
   }
@@ -1182,16 +1361,20 @@ RoutingTable::InvalidateRoutesForGateway (Ipv4Address gateway,
   
   if (table == eslr::MAIN)
   {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+    // only the affected routes are visited, in table order
+    std::vector<RoutesI> records;
+    GetNextHopRecords (m_mainNextHops.gateways, gateway.Get (), records);
+
+    for (std::vector<RoutesI>::const_iterator rec = records.begin (); rec != records.end (); rec++)
     {
-      if ((it->first->GetGateway () == gateway) && 
-          (it->first->GetValidity () == eslr::VALID))
+      RoutesI it = *rec;
+      if (it->first->GetValidity () == eslr::VALID)
       {
         p.invalidateType = eslr::BROKEN_NEIGHBOR;
         it->second.Cancel ();
-        it->second  = Simulator::Schedule (MilliSeconds (m_rng->GetValue (0.0, 2.0)),
-                                           &RoutingTable::InvalidateRoute, 
-                                           this, 
+        it->second  = m_timers.Schedule (MilliSeconds (m_rng->GetValue (0.0, 2.0)),
+                                         &RoutingTable::InvalidateRoute, 
+                                         this, 
 																					 it->first, 
 																					 p);
       }
@@ -1199,17 +1382,21 @@ RoutingTable::InvalidateRoutesForGateway (Ipv4Address gateway,
   }
   if (table == eslr::BACKUP)
   {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
+    // only the affected routes are visited, in table order
+    std::vector<RoutesI> records;
+    GetNextHopRecords (m_backupNextHops.gateways, gateway.Get (), records);
+
+    for (std::vector<RoutesI>::const_iterator rec = records.begin (); rec != records.end (); rec++)
     {
-      if ((it->first->GetGateway () == gateway) && 
-          (it->first->GetValidity () == eslr::VALID) &&
+      RoutesI it = *rec;
+      if ((it->first->GetValidity () == eslr::VALID) &&
           (it->first->GetRouteType () == eslr::SECONDARY))
       {
         p.invalidateType = eslr::BROKEN;      
         it->second.Cancel ();
-        it->second  = Simulator::Schedule (MilliSeconds (m_rng->GetValue (0.0, 2.0)),
-                                           &RoutingTable::InvalidateRoute,
-                                           this, 
+        it->second  = m_timers.Schedule (MilliSeconds (m_rng->GetValue (0.0, 2.0)),
+                                         &RoutingTable::InvalidateRoute,
+                                         this, 
 																					 it->first, 
 																					 p);
       }
@@ -1235,16 +1422,20 @@ RoutingTable::InvalidateRoutesForInterface (uint32_t interface,
   
   if (table == eslr::MAIN)
   {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+    // only the affected routes are visited, in table order
+    std::vector<RoutesI> records;
+    GetNextHopRecords (m_mainNextHops.interfaces, interface, records);
+
+    for (std::vector<RoutesI>::const_iterator rec = records.begin (); rec != records.end (); rec++)
     {
-      if ((it->first->GetInterface () == interface) && 
-          (it->first->GetValidity () == eslr::VALID))
+      RoutesI it = *rec;
+      if (it->first->GetValidity () == eslr::VALID)
       {
         p.invalidateType = eslr::BROKEN_INTERFACE;      
         it->second.Cancel ();
-        it->second  = Simulator::Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)),
-                                           &RoutingTable::InvalidateRoute,
-                                           this, 
+        it->second  = m_timers.Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)),
+                                         &RoutingTable::InvalidateRoute,
+                                         this, 
 																					 it->first, 
 																					 p);
         std::cout << int(m_nodeId)<< " is invalidating:" << it->first->GetDestNetwork () << "/" << it->first->GetDestNetworkMask () << ", which uses broken interface: "<< interface << std::endl;                                                    
@@ -1253,17 +1444,21 @@ RoutingTable::InvalidateRoutesForInterface (uint32_t interface,
   }
   if (table == eslr::BACKUP)
   {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
+    // only the affected routes are visited, in table order
+    std::vector<RoutesI> records;
+    GetNextHopRecords (m_backupNextHops.interfaces, interface, records);
+
+    for (std::vector<RoutesI>::const_iterator rec = records.begin (); rec != records.end (); rec++)
     {
-      if ((it->first->GetInterface () == interface) && 
-          (it->first->GetValidity () == eslr::VALID) &&
+      RoutesI it = *rec;
+      if ((it->first->GetValidity () == eslr::VALID) &&
           (it->first->GetRouteType () == eslr::SECONDARY))
       {
         p.invalidateType = eslr::BROKEN;      
         it->second.Cancel ();
-        it->second  = Simulator::Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)),
-                                           &RoutingTable::InvalidateRoute,
-                                           this, 
+        it->second  = m_timers.Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)),
+                                         &RoutingTable::InvalidateRoute,
+                                         this, 
 																					 it->first,
 																					 p);
       }
@@ -1289,44 +1484,26 @@ RoutingTable::InvalidateBrokenRoute (Ipv4Address destAddress,
   p.invalidateType = eslr::BROKEN;
   p.table = table;     
 
-  if (table == eslr::MAIN)
-  {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destAddress) &&
-          (it->first->GetDestNetworkMask () == destMask) &&
-          (it->first->GetGateway () == gateway) && 
-          (it->first->GetValidity () == eslr::VALID))
-      {
-        it->second.Cancel ();
-        it->second  = Simulator::Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)), 
-                                           &RoutingTable::InvalidateRoute, 
-                                           this, 
-																					 it->first, 
-																					 p);
-        retVal = true;
-      }
-    }  
-  }
-  if (table == eslr::BACKUP)
+  const PrefixRecords *records = LookupPrefix (destAddress, destMask, table);
+  if (records == 0)
+    return retVal;
+
+  for (PrefixRecords::const_iterator rec = records->begin (); rec != records->end (); rec++)
   {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
+    RoutesI it = *rec;
+    // only the backup routes are invalidated in the backup table
+    if ((it->first->GetGateway () == gateway) && 
+        (it->first->GetValidity () == eslr::VALID) &&
+        ((table == eslr::MAIN) || (it->first->GetRouteType () == eslr::SECONDARY)))
     {
-      if ((it->first->GetDestNetwork () == destAddress) &&
-          (it->first->GetDestNetworkMask () == destMask) &&
-          (it->first->GetGateway () == gateway) && 
-          (it->first->GetValidity () == eslr::VALID) &&
-          (it->first->GetRouteType () == eslr::SECONDARY))
-      {
-        it->second.Cancel ();
-        it->second  = Simulator::Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)), 
-                                           &RoutingTable::InvalidateRoute, 
-                                           this, 
-																					 it->first, 
-																					 p);
-        retVal = true;
-      }
-    }  
+      it->second.Cancel ();
+      it->second  = m_timers.Schedule (MicroSeconds (m_rng->GetValue (0.0, 2.0)), 
+                                       &RoutingTable::InvalidateRoute, 
+                                       this, 
+																				 it->first, 
+																				 p);
+      retVal = true;
+    }
   }   
   
   return retVal;
@@ -1339,37 +1516,19 @@ RoutingTable::FindRouteRecord (Ipv4Address destination,
 		RoutesI &retRoutingTableEntry, 
 		eslr::Table table)
 {
-  bool retVal = false;
+  const PrefixRecords *records = LookupPrefix (destination, netMask, table);
+  if (records == 0)
+    return false;
 
-  if (table == eslr::MAIN)
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+    if ((*it)->first->GetGateway () == gateway)
     {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () == gateway))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
+      retRoutingTableEntry = *it;
+      return true;
     }
   }
-  else if (table == eslr::BACKUP)
-  {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () == gateway))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
-    } 
-  }
-  return retVal;
+  return false;
 }
 
 bool 
@@ -1378,36 +1537,21 @@ RoutingTable::FindRouteRecord (Ipv4Address destination,
 		RoutesI &retRoutingTableEntry, 
 		eslr::Table table)
 {
-  bool retVal = false;
+  const PrefixRecords *records = LookupPrefix (destination, netMask, table);
+  if (records == 0)
+    return false;
 
-  if (table == eslr::MAIN)
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+    // local routes in the main table are not considered
+    if ((table == eslr::BACKUP) || 
+        ((*it)->first->GetGateway () != Ipv4Address::GetZero ()))
     {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () != Ipv4Address::GetZero ()))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
+      retRoutingTableEntry = *it;
+      return true;
     }
   }
-  else if (table == eslr::BACKUP)
-  {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
-    } 
-  }
-  return retVal;
+  return false;
 }
 
 bool 
@@ -1416,68 +1560,32 @@ RoutingTable::FindValidRouteRecord (Ipv4Address destination,
 		RoutesI &retRoutingTableEntry, 
 		eslr::Table table)
 {
-  bool retVal = false;
+  const PrefixRecords *records = LookupPrefix (destination, netMask, table);
+  if (records == 0)
+    return false;
 
-  if (table == eslr::MAIN)
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+    if (((table == eslr::BACKUP) || 
+         ((*it)->first->GetGateway () != Ipv4Address::GetZero ())) &&
+        ((*it)->first->GetValidity () == eslr::VALID))
     {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () != Ipv4Address::GetZero ()) &&
-          (it->first->GetValidity () == eslr::VALID))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
+      retRoutingTableEntry = *it;
+      return true;
     }
   }
-  else if (table == eslr::BACKUP)
-  {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetValidity () == eslr::VALID))
-      {
-        retRoutingTableEntry = it;
-        retVal = true;
-        break;
-      }
-    } 
-  }
-  return retVal;
+  return false;
 }
 
 RoutingTable::RoutesI
 RoutingTable::FindGivenRouteRecord (RoutingTableEntry *route, bool &found, eslr::Table table)
 {
   RoutesI foundRoute;
-  bool retVal = false;
-  if (table == eslr::MAIN)
-  {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
-    {
-      if (it->first == route)
-      {
-        retVal = true;
-        foundRoute = it;
-      }
-    }
-  }
-  else if (table == eslr::BACKUP)
-  {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-    {
-      if (it->first == route)
-      {
-        retVal = true;
-        foundRoute = it;
-      }      
-    } 
-  }
-  found = retVal;
+  const PrefixRecords *records = LookupPrefix (route->GetDestNetwork (), 
+      route->GetDestNetworkMask (), 
+      table);
+
+  found = (records != 0) && FindGivenRecord (*records, route, foundRoute);
   return foundRoute;
 }
 
@@ -1489,36 +1597,10 @@ RoutingTable::FindValidRouteRecordForDestination (Ipv4Address destination,
 		eslr::Table table)
 {
   RoutesI foundRoute;
-  bool retVal = false;
-  if (table == eslr::MAIN)
-  {
-    for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () == gateway) &&
-          (it->first->GetValidity () == eslr::VALID))
-      {
-        retVal = true;
-        foundRoute = it;
-      }
-    }
-  }
-  else if (table == eslr::BACKUP)
-  {
-    for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-    {
-      if ((it->first->GetDestNetwork () == destination) &&
-          (it->first->GetDestNetworkMask () == netMask) &&
-          (it->first->GetGateway () == gateway) &&
-          (it->first->GetValidity () == eslr::VALID))
-      {
-        retVal = true;
-        foundRoute = it;
-      }      
-    } 
-  }
-  found = retVal;
+  const PrefixRecords *records = LookupPrefix (destination, netMask, table);
+
+  // the last matching record in the table is returned
+  found = (records != 0) && FindValidRecordForGateway (*records, gateway, foundRoute);
   return foundRoute;
 }
 
@@ -1529,18 +1611,12 @@ RoutingTable::FindRouteInBackup (Ipv4Address destination,
 		eslr::RouteType routeType)
 {
   bool retVal = false;
-
-  for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
-  {
-    if ((it->first->GetDestNetwork () == destination) &&
-        (it->first->GetDestNetworkMask () == netMask) &&
-        (it->first->GetValidity () == eslr::VALID) &&
-        (it->first->GetRouteType () == routeType))
-    {
-      retRoutingTableEntry = it;
-      retVal = true;
-    }
-  }
+  RoutesI foundRoute = FindRouteInBackupForDestination (destination, 
+      netMask, 
+      retVal, 
+      routeType);
+  if (retVal)
+    retRoutingTableEntry = foundRoute;
   return retVal;
 }
 
@@ -1550,39 +1626,90 @@ RoutingTable::FindRouteInBackupForDestination (Ipv4Address destination,
 		bool &found, 
 		eslr::RouteType routeType)
 {
-  bool retVal = false;
   RoutesI foundRoute;
-  for (RoutesI it = m_backupRoutingTable.begin ();  it!= m_backupRoutingTable.end (); it++)
+  found = false;
+
+  const PrefixRecords *records = LookupPrefix (destination, netMask, eslr::BACKUP);
+  if (records == 0)
+    return foundRoute;
+
+  // the last matching record in the table is returned
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    if ((it->first->GetDestNetwork () == destination) &&
-        (it->first->GetDestNetworkMask () == netMask) &&
-        (it->first->GetValidity () == eslr::VALID) &&
-        (it->first->GetRouteType () == routeType))
+    if (((*it)->first->GetValidity () == eslr::VALID) &&
+        ((*it)->first->GetRouteType () == routeType))
     {
-      foundRoute = it;
-      retVal = true;
+      found = true;
+      foundRoute = *it;
     }
   }
-  
-  found = retVal;
   return foundRoute;
 }
 
+bool
+RoutingTable::FindRouteSet (Ipv4Address destination, Ipv4Mask netMask, RouteSet &routeSet)
+{
+  const PrefixRoutes *routes = LookupPrefixRoutes (destination, netMask);
+  ResolveRouteSet (routes, routeSet);
+  return (routes != 0);
+}
+
 bool 
 RoutingTable::IsLocalRouteAvailable (Ipv4Address destination, Ipv4Mask netMask)
 {
-  bool retVal = false;
+  const PrefixRecords *records = LookupPrefix (destination, netMask, eslr::MAIN);
+  if (records == 0)
+    return false;
 
-  for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
   {
-    if ((it->first->GetDestNetwork () == destination) &&
-        (it->first->GetDestNetworkMask () == netMask) &&
-        (it->first->GetGateway () == Ipv4Address::GetZero ()))
-    {
-      retVal = true;
-    }
+    if ((*it)->first->GetGateway () == Ipv4Address::GetZero ())
+      return true;
   }
-  return retVal;
+  return false;
+}
+
+void
+RoutingTable::GetMemoryUsage (MemoryUsage &usage) const
+{
+  NS_LOG_FUNCTION (this);
+
+  usage = MemoryUsage ();
+  usage.records = m_mainRoutingTable.size () + m_backupRoutingTable.size ();
+  usage.liveObjects = m_entryPool.GetNEntriesInUse ();
+  usage.pooledObjects = m_entryPool.GetCapacity () - usage.liveObjects;
+  usage.pendingEvents = m_timers.GetNTimers ();
+
+  uint64_t bytes = m_entryPool.GetMemorySize () + m_timers.GetMemorySize () + m_forwardingTable.GetMemorySize ();
+
+  // the table records
+  bytes += usage.records * MemoryUsage::GetNodeSize (sizeof (RouteTableRecord), 2);
+
+  // the prefix index, each record is listed once
+  bytes += m_prefixIndex.size () * MemoryUsage::GetNodeSize (sizeof (PrefixIndex::value_type), 1);
+  bytes += m_prefixIndex.bucket_count () * sizeof (void*);
+  bytes += usage.records * MemoryUsage::GetNodeSize (sizeof (RoutesI), 2);
+
+  // the next hop indexes, each record is listed by its gateway and by its interface
+  const NextHopIndex *indexes[] = { &m_mainNextHops.gateways, &m_mainNextHops.interfaces, 
+                                    &m_backupNextHops.gateways, &m_backupNextHops.interfaces };
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    bytes += indexes[i]->size () * MemoryUsage::GetNodeSize (sizeof (NextHopIndex::value_type), 1);
+    bytes += indexes[i]->bucket_count () * sizeof (void*);
+  }
+  bytes += 2 * m_nextHopPositions.size () * MemoryUsage::GetNodeSize (sizeof (NextHopRecord), 2);
+  bytes += m_nextHopPositions.size () * MemoryUsage::GetNodeSize (sizeof (NextHopPositions::value_type), 1);
+  bytes += m_nextHopPositions.bucket_count () * sizeof (void*);
+
+  // the changed route list and the sequence epochs
+  bytes += m_changedRoutes.size () * MemoryUsage::GetNodeSize (sizeof (RoutesI), 2);
+  bytes += m_changedPositions.size () * MemoryUsage::GetNodeSize (sizeof (ChangedPositions::value_type), 1);
+  bytes += m_changedPositions.bucket_count () * sizeof (void*);
+  bytes += m_sequenceEpochs.size () * MemoryUsage::GetNodeSize (sizeof (SequenceEpochs::value_type), 1);
+  bytes += m_sequenceEpochs.bucket_count () * sizeof (void*);
+
+  usage.bytes = bytes;
 }
 
 void 
@@ -1592,27 +1719,10 @@ RoutingTable::ReturnRoutingTable (RoutingTableInstance &instance, eslr::Table ta
   
   if (table == eslr::MAIN)
   {
-    // Note: In the case of Main routing table, a newly created separate instance is returned. 
-    // However, for proper memory management, 
-    // table instance has to be cleared at the place where requesting the main routing table.
-    
-    NS_LOG_DEBUG ("Create a fresh instance of the Main table and return");
-    
+    NS_LOG_DEBUG ("Return the existing instance of the Main Table");
     for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
     {
-      RoutingTableEntry* route;
-      
-      route  =  new RoutingTableEntry ( it->first->GetDestNetwork (), 
-                                        it->first->GetDestNetworkMask (), 
-                                        it->first->GetGateway (), 
-                                        it->first->GetInterface ());    
-      route->SetValidity (it->first->GetValidity ());
-      route->SetSequenceNo (it->first->GetSequenceNo ());
-      route->SetRouteType (it->first->GetRouteType ());
-      route->SetMetric (it->first->GetMetric ());
-      route->SetRouteChanged (it->first->GetRouteChanged ());
-        
-      instance.push_front(std::make_pair (route, EventId ()));
+      instance.push_front(std::make_pair (it->first, it->second));
     }
   }
   else if (table == eslr::BACKUP)
@@ -1648,13 +1758,7 @@ RoutingTable::RoutesWithNoBackupRoutes (uint32_t interface, RoutingTableInstance
 
 			if (!foundBackupRoute)
 			{
-				RoutingTableEntry* route;
-	
-				route  =  new RoutingTableEntry ( it->first->GetDestNetwork (),
-					 																it->first->GetDestNetworkMask (),
-																					it->first->GetGateway (),
-																					it->first->GetInterface ());
-				instance.push_front(std::make_pair (route, EventId ()));
+				instance.push_front(std::make_pair (it->first, TimerId ()));
 
 				retVal = true;
 			}
@@ -1693,7 +1797,7 @@ RoutingTable::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, eslr::Table ta
         
         *os << std::setiosflags (std::ios::left) << std::setw (4) << route->GetInterface ();
         
-        *os << std::setiosflags (std::ios::left) << std::setw (8) << route->GetSequenceNo ();
+        *os << std::setiosflags (std::ios::left) << std::setw (8) << GetSequenceNo (route);
         
         *os << std::setiosflags (std::ios::left) << std::setw (8) << route->GetMetric ();
         
@@ -1711,7 +1815,7 @@ RoutingTable::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, eslr::Table ta
         
         *os << std::setiosflags (std::ios::left) << std::setw (8) << route->GetRouteChanged ();
         
-        *os << std::setiosflags (std::ios::left) << std::setw (10) << Simulator::GetDelayLeft (it->second).GetSeconds ();
+        *os << std::setiosflags (std::ios::left) << std::setw (10) << it->second.GetDelayLeft ().GetSeconds ();
        
         *os << '\n';
       //}        
@@ -1756,7 +1860,7 @@ RoutingTable::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, eslr::Table ta
         preSec << "P";
         *os << std::setiosflags (std::ios::left) << std::setw (8) << preSec.str ();
         
-        *os << std::setiosflags (std::ios::left) << std::setw (10) << Simulator::GetDelayLeft (it->second).GetSeconds ();
+        *os << std::setiosflags (std::ios::left) << std::setw (10) << it->second.GetDelayLeft ().GetSeconds ();
         *os << '\n';
       }
     }
@@ -1792,7 +1896,7 @@ RoutingTable::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, eslr::Table ta
         preSec << "S";
         *os << std::setiosflags (std::ios::left) << std::setw (8) << preSec.str ();
         
-        *os << std::setiosflags (std::ios::left) << std::setw (10) << Simulator::GetDelayLeft (it->second).GetSeconds ();
+        *os << std::setiosflags (std::ios::left) << std::setw (10) << it->second.GetDelayLeft ().GetSeconds ();
         *os << '\n';
       }
     }    
@@ -1801,33 +1905,97 @@ RoutingTable::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, eslr::Table ta
     NS_ABORT_MSG ("No specified routing table found. Aborting.");
 }
 
+/// Orders route records as in their table
+static bool
+CompareNextHopOrder (const std::pair<int64_t, RoutingTable::RoutesI> &a, 
+    const std::pair<int64_t, RoutingTable::RoutesI> &b)
+{
+  return a.first < b.first;
+}
+
 void 
 RoutingTable::ToggleRouteChanged ()
 {
   NS_LOG_FUNCTION (this);
-  for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+  // the changed routes that are not VALID stay in the list
+  ChangedRoutes::iterator it = m_changedRoutes.begin ();
+  while (it != m_changedRoutes.end ())
   {
-    if (it->first->GetValidity () == eslr::VALID)
+    RoutesI route = *it++;
+    if (route->first->GetValidity () == eslr::VALID)
+    {
+      route->first->SetRouteChanged (false);
+    }
+    if (!route->first->GetRouteChanged ())
     {
-      it->first->SetRouteChanged (false);
+      DequeueChangedRoute (route);
     }
   }
 }
 
+void 
+RoutingTable::GetChangedRoutes (std::vector<const RoutingTableEntry*> &routes)
+{
+  NS_LOG_FUNCTION (this);
+  routes.clear ();
+
+  std::vector<std::pair<int64_t, RoutesI> > ordered;
+  ordered.reserve (m_changedRoutes.size ());
+  ChangedRoutes::iterator it = m_changedRoutes.begin ();
+  while (it != m_changedRoutes.end ())
+  {
+    RoutesI route = *it++;
+    if (!route->first->GetRouteChanged ())
+    {
+      // unmarked since it was listed
+      DequeueChangedRoute (route);
+      continue;
+    }
+    NextHopPositions::const_iterator position = m_nextHopPositions.find (&(*route));
+    NS_ASSERT (position != m_nextHopPositions.end ());
+    ordered.push_back (std::make_pair (position->second.order, route));
+  }
+  std::sort (ordered.begin (), ordered.end (), CompareNextHopOrder);
+
+  routes.reserve (ordered.size ());
+  for (std::vector<std::pair<int64_t, RoutesI> >::const_reverse_iterator it = ordered.rbegin (); it != ordered.rend (); it++)
+  {
+    routes.push_back (it->second->first);
+  }
+}
+
 void 
 RoutingTable::IncrementSeqNo ()
 {
   NS_LOG_FUNCTION (this);
-  for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+  // NOTE:
+  //  The sequence numbers of the local routes are not touched. Each local 
+  //  route advertises the number it was given plus the epochs passed since.
+  m_sequenceEpoch++;
+
+  // the changed local routes are advertised once
+  ChangedRoutes::iterator it = m_changedRoutes.begin ();
+  while (it != m_changedRoutes.end ())
   {
-    if ((it->first->GetDestNetwork () != "127.0.0.1") && (it->first->GetGateway () == Ipv4Address::GetZero ()))
-    {        
-      it->first->SetSequenceNo (it->first->GetSequenceNo () + 1);
-      it->first->SetRouteChanged (false);
+    RoutesI route = *it++;
+    if (IsSequencedByEpoch (route->first))
+    {
+      route->first->SetRouteChanged (false);
+      DequeueChangedRoute (route);
     }
   }
 }
 
+uint16_t
+RoutingTable::GetSequenceNo (const RoutingTableEntry *route) const
+{
+  SequenceEpochs::const_iterator epoch = m_sequenceEpochs.find (route);
+  if (epoch == m_sequenceEpochs.end ())
+    return route->GetSequenceNo ();
+
+  return route->GetSequenceNo () + uint16_t (m_sequenceEpoch - epoch->second);
+}
+
 void 
 RoutingTable::AssignStream (int64_t stream)
 { 
@@ -1835,41 +2003,415 @@ RoutingTable::AssignStream (int64_t stream)
   m_rng->SetStream (stream);
 }
 
-bool 
-RoutingTable::ReturnRoute (Ipv4Address destination, Ptr<NetDevice> dev, RoutesI &retRoutingTableEntry)
+RoutingTable::RoutesI
+RoutingTable::InsertMainRoute (RoutingTableEntry *route, TimerId event, bool atFront)
+{
+  RoutesI it;
+  if (atFront)
+  {
+    m_mainRoutingTable.push_front (std::make_pair (route, event));
+    it = m_mainRoutingTable.begin ();
+  }
+  else
+  {
+    m_mainRoutingTable.push_back (std::make_pair (route, event));
+    it = --m_mainRoutingTable.end ();
+  }
+
+  IndexRoute (it, eslr::MAIN, atFront);
+  QueueChangedRoute (it);
+  SetSequenceEpoch (it);
+  UpdateForwardingEntries (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  return it;
+}
+
+void
+RoutingTable::EraseMainRoute (RoutesI it)
 {
-  NS_LOG_FUNCTION (this << destination);  
+  DequeueChangedRoute (it);
+  m_sequenceEpochs.erase (it->first);
+  UnindexRoute (it, eslr::MAIN);
+  RoutingTableEntry *route = it->first;
+  m_mainRoutingTable.erase (it);
+  UpdateForwardingEntries (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  m_entryPool.Release (route);
+}
 
-  Ipv4Address foundDestination;
-  Ipv4Mask foundMask;
-  
-  bool retVal = false;
+RoutingTable::RoutesI
+RoutingTable::InsertBackupRoute (RoutingTableEntry *route, TimerId event)
+{
+  m_backupRoutingTable.push_front (std::make_pair (route, event));
+  RoutesI it = m_backupRoutingTable.begin ();
+  IndexRoute (it, eslr::BACKUP, true);
+  UpdateForwardingBackup (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  return it;
+}
+
+void
+RoutingTable::EraseBackupRoute (RoutesI it)
+{
+  UnindexRoute (it, eslr::BACKUP);
+  RoutingTableEntry *route = it->first;
+  m_backupRoutingTable.erase (it);
+  UpdateForwardingBackup (route->GetDestNetwork (), route->GetDestNetworkMask ());
+  m_entryPool.Release (route);
+}
+
+const RoutingTable::PrefixRoutes*
+RoutingTable::LookupPrefixRoutes (Ipv4Address network, Ipv4Mask mask) const
+{
+  PrefixIndex::const_iterator it = m_prefixIndex.find (GetPrefixKey (network, mask));
+  if (it == m_prefixIndex.end ())
+    return 0;
+  return &it->second;
+}
+
+const RoutingTable::PrefixRecords*
+RoutingTable::LookupPrefix (Ipv4Address network, Ipv4Mask mask, eslr::Table table) const
+{
+  const PrefixRoutes *routes = LookupPrefixRoutes (network, mask);
+  if (routes == 0)
+    return 0;
+
+  const PrefixRecords *records = (table == eslr::MAIN) ? &routes->mainRecords : &routes->backupRecords;
+  if (records->empty ())
+    return 0;
+  return records;
+}
+
+void
+RoutingTable::ResolveRouteSet (const PrefixRoutes *routes, RouteSet &routeSet)
+{
+  routeSet.hasLocalRoute = false;
+  routeSet.foundMain = false;
+  routeSet.foundPrimary = false;
+  routeSet.foundSecondary = false;
 
-  NS_LOG_LOGIC ("Searching for a route to " << destination);
+  if (routes == 0)
+    return;
 
-  for (RoutesI it = m_mainRoutingTable.begin ();  it!= m_mainRoutingTable.end (); it++)
+  for (PrefixRecords::const_iterator it = routes->mainRecords.begin (); 
+       it != routes->mainRecords.end (); it++)
   {
-    if (it->first->GetValidity () == eslr::VALID)
-    {        
-      foundDestination = it->first->GetDestNetwork ();
-      foundMask = it->first->GetDestNetworkMask ();
-      
-      if (foundMask.IsMatch (destination, foundDestination))
-      {
-        NS_LOG_LOGIC ("found a route " << it->first << ", with the mask " << foundMask);
-        
-        if ((!dev) || (dev == m_ipv4->GetNetDevice (it->first->GetInterface ())))
-        {
-          retRoutingTableEntry = it;
-          // As a route is found, it is not necessary to iterate through the routing table anymore
-          return retVal = true;
-        }
-      }
+    if ((*it)->first->GetGateway () == Ipv4Address::GetZero ())
+    {
+      routeSet.hasLocalRoute = true;
+    }
+    else if (!routeSet.foundMain)
+    {
+      routeSet.foundMain = true;
+      routeSet.mainRoute = *it;
+    }
+  }
+
+  // as in FindRouteInBackupForDestination, the last VALID record of each type is used
+  for (PrefixRecords::const_iterator it = routes->backupRecords.begin (); 
+       it != routes->backupRecords.end (); it++)
+  {
+    if ((*it)->first->GetValidity () != eslr::VALID)
+      continue;
+
+    if ((*it)->first->GetRouteType () == eslr::PRIMARY)
+    {
+      routeSet.foundPrimary = true;
+      routeSet.primaryRoute = *it;
+    }
+    else if ((*it)->first->GetRouteType () == eslr::SECONDARY)
+    {
+      routeSet.foundSecondary = true;
+      routeSet.secondaryRoute = *it;
+    }
+  }
+}
+
+bool
+RoutingTable::FindGivenRecord (const PrefixRecords &records, 
+    RoutingTableEntry *route, 
+    RoutesI &retRoutingTableEntry)
+{
+  bool retVal = false;
+  for (PrefixRecords::const_iterator it = records.begin (); it != records.end (); it++)
+  {
+    if ((*it)->first == route)
+    {
+      retVal = true;
+      retRoutingTableEntry = *it;
+    }
+  }
+  return retVal;
+}
+
+bool
+RoutingTable::FindValidRecordForGateway (const PrefixRecords &records, 
+    Ipv4Address gateway, 
+    RoutesI &retRoutingTableEntry)
+{
+  bool retVal = false;
+  for (PrefixRecords::const_iterator it = records.begin (); it != records.end (); it++)
+  {
+    if (((*it)->first->GetGateway () == gateway) &&
+        ((*it)->first->GetValidity () == eslr::VALID))
+    {
+      retVal = true;
+      retRoutingTableEntry = *it;
     }
   }
   return retVal;
 }
 
+void
+RoutingTable::IndexRoute (RoutesI it, eslr::Table table, bool atFront)
+{
+  // records of a prefix are kept in the same order as in the table, 
+  // so that the first and last match semantics of the find methods are preserved
+  PrefixRoutes &routes = m_prefixIndex[GetPrefixKey (it->first->GetDestNetwork (), 
+      it->first->GetDestNetworkMask ())];
+  PrefixRecords &records = (table == eslr::MAIN) ? routes.mainRecords : routes.backupRecords;
+  if (atFront)
+    records.push_front (it);
+  else
+    records.push_back (it);
+
+  NextHopIndexes &indexes = (table == eslr::MAIN) ? m_mainNextHops : m_backupNextHops;
+  IndexNextHop (it, table, atFront ? --indexes.frontOrder : indexes.backOrder++);
+}
+
+void
+RoutingTable::UnindexRoute (RoutesI it, eslr::Table table)
+{
+  PrefixIndex::iterator routes = m_prefixIndex.find (GetPrefixKey (it->first->GetDestNetwork (), 
+      it->first->GetDestNetworkMask ()));
+  NS_ASSERT (routes != m_prefixIndex.end ());
+
+  if (table == eslr::MAIN)
+    routes->second.mainRecords.remove (it);
+  else
+    routes->second.backupRecords.remove (it);
+
+  if (routes->second.mainRecords.empty () && routes->second.backupRecords.empty ())
+    m_prefixIndex.erase (routes);
+
+  UnindexNextHop (it, table);
+}
+
+void
+RoutingTable::IndexNextHop (RoutesI it, eslr::Table table, int64_t order)
+{
+  NextHopIndexes &indexes = (table == eslr::MAIN) ? m_mainNextHops : m_backupNextHops;
+  NextHopRecord record;
+  record.order = order;
+  record.route = it;
+
+  NextHopPosition position;
+  position.order = order;
+  position.gateway = it->first->GetGateway ().Get ();
+  NextHopRecords &gatewayRecords = indexes.gateways[position.gateway];
+  position.gatewayPos = gatewayRecords.insert (gatewayRecords.end (), record);
+  position.interface = it->first->GetInterface ();
+  NextHopRecords &interfaceRecords = indexes.interfaces[position.interface];
+  position.interfacePos = interfaceRecords.insert (interfaceRecords.end (), record);
+
+  m_nextHopPositions[&(*it)] = position;
+}
+
+void
+RoutingTable::UnindexNextHop (RoutesI it, eslr::Table table)
+{
+  NextHopIndexes &indexes = (table == eslr::MAIN) ? m_mainNextHops : m_backupNextHops;
+
+  NextHopPositions::iterator position = m_nextHopPositions.find (&(*it));
+  NS_ASSERT (position != m_nextHopPositions.end ());
+
+  NextHopIndex::iterator gatewayRecords = indexes.gateways.find (position->second.gateway);
+  gatewayRecords->second.erase (position->second.gatewayPos);
+  if (gatewayRecords->second.empty ())
+    indexes.gateways.erase (gatewayRecords);
+
+  NextHopIndex::iterator interfaceRecords = indexes.interfaces.find (position->second.interface);
+  interfaceRecords->second.erase (position->second.interfacePos);
+  if (interfaceRecords->second.empty ())
+    indexes.interfaces.erase (interfaceRecords);
+
+  m_nextHopPositions.erase (position);
+}
+
+void
+RoutingTable::UpdateRouteEntry (RoutesI it, const RoutingTableEntry &route, eslr::Table table)
+{
+  NS_ASSERT (it->first->GetDestNetwork () == route.GetDestNetwork () && 
+             it->first->GetDestNetworkMask () == route.GetDestNetworkMask ());
+
+  bool nextHopChanged = (it->first->GetGateway () != route.GetGateway ()) || 
+                        (it->first->GetInterface () != route.GetInterface ());
+  bool forwardingChanged = nextHopChanged || (it->first->GetValidity () != route.GetValidity ());
+  bool metricChanged = (it->first->GetMetric () != route.GetMetric ()) || 
+                       (it->first->GetRouteType () != route.GetRouteType ());
+
+  if (!nextHopChanged)
+  {
+    *it->first = route;
+  }
+  else
+  {
+    // the record keeps its position in the table
+    NextHopPositions::const_iterator position = m_nextHopPositions.find (&(*it));
+    NS_ASSERT (position != m_nextHopPositions.end ());
+    int64_t order = position->second.order;
+    UnindexNextHop (it, table);
+    *it->first = route;
+    IndexNextHop (it, table, order);
+  }
+
+  if (table == eslr::MAIN)
+  {
+    QueueChangedRoute (it);
+    SetSequenceEpoch (it);
+    if (forwardingChanged)
+      UpdateForwardingEntries (route.GetDestNetwork (), route.GetDestNetworkMask ());
+    else if (metricChanged)
+      UpdateForwardingBackup (route.GetDestNetwork (), route.GetDestNetworkMask ());
+  }
+  else if (forwardingChanged || metricChanged)
+  {
+    UpdateForwardingBackup (route.GetDestNetwork (), route.GetDestNetworkMask ());
+  }
+}
+
+void
+RoutingTable::SetMainRouteValidity (RoutesI it, eslr::Validity validity)
+{
+  if (it->first->GetValidity () == validity)
+    return;
+
+  it->first->SetValidity (validity);
+  UpdateForwardingEntries (it->first->GetDestNetwork (), it->first->GetDestNetworkMask ());
+}
+
+void
+RoutingTable::UpdateForwardingEntries (Ipv4Address network, Ipv4Mask mask)
+{
+  m_forwardingTable.RemoveEntries (network, mask);
+
+  const PrefixRecords *records = LookupPrefix (network, mask, eslr::MAIN);
+  if (records == 0)
+    return;
+
+  for (PrefixRecords::const_iterator it = records->begin (); it != records->end (); it++)
+  {
+    const RoutingTableEntry *route = (*it)->first;
+    if (route->GetValidity () == eslr::VALID)
+      m_forwardingTable.AddEntry (route->GetDest (), 
+          route->GetDestNetworkMask (), 
+          route->GetGateway (), 
+          route->GetInterface (), 
+          route->GetMetric ());
+  }
+
+  UpdateForwardingBackup (network, mask);
+}
+
+void
+RoutingTable::UpdateForwardingBackup (Ipv4Address network, Ipv4Mask mask)
+{
+  const PrefixRoutes *routes = LookupPrefixRoutes (network, mask);
+  if (routes == 0)
+    return;
+
+  // the first VALID main record is the first forwarding entry of the prefix
+  const RoutingTableEntry *mainRoute = 0;
+  for (PrefixRecords::const_iterator it = routes->mainRecords.begin (); 
+       it != routes->mainRecords.end (); it++)
+  {
+    if ((*it)->first->GetValidity () == eslr::VALID)
+    {
+      mainRoute = (*it)->first;
+      break;
+    }
+  }
+  if (mainRoute == 0)
+    return;
+
+  // The b-route is the VALID s-route, if it uses another next hop. 
+  // A destination with a local route has no b-route.
+  RouteSet routeSet;
+  ResolveRouteSet (routes, routeSet);
+  const RoutingTableEntry *backupRoute = 0;
+  if (!routeSet.hasLocalRoute && routeSet.foundSecondary && 
+      (routeSet.secondaryRoute->first->GetGateway () != mainRoute->GetGateway ()))
+    backupRoute = routeSet.secondaryRoute->first;
+
+  if (backupRoute == 0)
+    m_forwardingTable.SetBackup (network, mask, mainRoute->GetMetric (), Ipv4Address::GetZero (), 0, 0);
+  else
+    m_forwardingTable.SetBackup (network, mask, mainRoute->GetMetric (), 
+        backupRoute->GetGateway (), 
+        backupRoute->GetInterface (), 
+        backupRoute->GetMetric ());
+}
+
+void
+RoutingTable::MarkRouteChanged (RoutesI it)
+{
+  it->first->SetRouteChanged (true);
+  QueueChangedRoute (it);
+}
+
+void
+RoutingTable::QueueChangedRoute (RoutesI it)
+{
+  if (!it->first->GetRouteChanged ())
+    return;
+
+  ChangedPositions::iterator position = m_changedPositions.find (&(*it));
+  if (position != m_changedPositions.end ())
+    return;
+
+  m_changedPositions[&(*it)] = m_changedRoutes.insert (m_changedRoutes.end (), it);
+}
+
+void
+RoutingTable::SetSequenceEpoch (RoutesI it)
+{
+  // the sequence number of the entry is valid at the current epoch
+  if (IsSequencedByEpoch (it->first))
+    m_sequenceEpochs[it->first] = m_sequenceEpoch;
+  else
+    m_sequenceEpochs.erase (it->first);
+}
+
+void
+RoutingTable::DequeueChangedRoute (RoutesI it)
+{
+  ChangedPositions::iterator position = m_changedPositions.find (&(*it));
+  if (position == m_changedPositions.end ())
+    return;
+
+  m_changedRoutes.erase (position->second);
+  m_changedPositions.erase (position);
+}
+
+void
+RoutingTable::GetNextHopRecords (const NextHopIndex &index, uint32_t key, std::vector<RoutesI> &records)
+{
+  records.clear ();
+  NextHopIndex::const_iterator nextHop = index.find (key);
+  if (nextHop == index.end ())
+    return;
+
+  std::vector<std::pair<int64_t, RoutesI> > ordered;
+  ordered.reserve (nextHop->second.size ());
+  for (NextHopRecords::const_iterator it = nextHop->second.begin (); it != nextHop->second.end (); it++)
+  {
+    ordered.push_back (std::make_pair (it->order, it->route));
+  }
+  std::sort (ordered.begin (), ordered.end (), CompareNextHopOrder);
+
+  records.reserve (ordered.size ());
+  for (std::vector<std::pair<int64_t, RoutesI> >::const_iterator it = ordered.begin (); it != ordered.end (); it++)
+  {
+    records.push_back (it->second);
+  }
+}
 
 std::ostream & operator << (std::ostream& os, const RoutingTableEntry& rte)
 {
@@ -23,10 +23,14 @@
 
 #include <cassert>
 #include <list>
+#include <vector>
 #include <sys/types.h>
+#include <tr1/unordered_map>
 
 #include "ns3/eslr-definition.h"
 #include "ns3/eslr-headers.h"
+#include "ns3/eslr-forwarding-table.h"
+#include "ns3/eslr-timer-wheel.h"
 
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-interface.h"
@@ -210,21 +214,171 @@ private:
  */
 std::ostream& operator<< (std::ostream& os, RoutingTableEntry const& rte);
 
+/**
+ * \brief Pool of routing table entries.
+ * Entries are carved out of blocks that hold ENTRIES_PER_BLOCK entries, and
+ * released entries are recycled. Therefore, the route churn caused by the 
+ * update messages does not reach the heap once the pool has grown to the
+ * size of the routing tables.
+ * The blocks are only returned to the heap when the pool is destroyed.
+ */
+class RoutingTableEntryPool
+{
+public:
+  /// Number of entries allocated from the heap at once
+  static const uint32_t ENTRIES_PER_BLOCK = 128;
+
+  RoutingTableEntryPool ();
+  ~RoutingTableEntryPool ();
+
+  /**
+   * \brief Get an entry from the pool.
+   * \param network network address
+   * \param networkMask network mask of the given destination network
+   * \param nextHop next hop address to route the packet
+   * \param interface interface index
+   * \returns the entry
+   */
+  RoutingTableEntry* Allocate (Ipv4Address network, 
+      Ipv4Mask networkMask, 
+      Ipv4Address nextHop, 
+      uint32_t interface);
+
+  /**
+   * \brief Return an entry to the pool.
+   * \param route the entry, which has to be allocated by this pool
+   */
+  void Release (RoutingTableEntry *route);
+
+  /**
+   * \returns the number of entries handed out by the pool
+   */
+  uint64_t GetNAllocations (void) const
+  {
+    return m_nAllocations;
+  }
+
+  /**
+   * \returns the number of entries returned to the pool
+   */
+  uint64_t GetNReleases (void) const
+  {
+    return m_nReleases;
+  }
+
+  /**
+   * \returns the number of entries that are currently in use
+   */
+  uint32_t GetNEntriesInUse (void) const
+  {
+    return uint32_t (m_nAllocations - m_nReleases);
+  }
+
+  /**
+   * \returns the number of heap allocations made by the pool
+   */
+  uint32_t GetNHeapAllocations (void) const
+  {
+    return m_blocks.size ();
+  }
+
+  /**
+   * \returns the number of entries the pool can hold without a heap allocation
+   */
+  uint32_t GetCapacity (void) const
+  {
+    return m_blocks.size () * ENTRIES_PER_BLOCK;
+  }
+
+  /**
+   * \returns the memory used by the pool (the blocks and the free list), in bytes
+   */
+  uint64_t GetMemorySize (void) const
+  {
+    return uint64_t (GetCapacity ()) * sizeof (RoutingTableEntry) + 
+           m_blocks.capacity () * sizeof (void*) + 
+           m_freeEntries.capacity () * sizeof (RoutingTableEntry*);
+  }
+
+  /**
+   * \brief Print the pool statistics
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  /// The pool owns its blocks, copying is not allowed
+  RoutingTableEntryPool (const RoutingTableEntryPool &);
+  RoutingTableEntryPool& operator= (const RoutingTableEntryPool &);
+
+  std::vector<void*> m_blocks; //!< blocks allocated from the heap
+  uint32_t m_nextInBlock; //!< the next unused entry in the last block
+  std::vector<RoutingTableEntry*> m_freeEntries; //!< released entries
+  uint64_t m_nAllocations; //!< number of handed out entries
+  uint64_t m_nReleases; //!< number of returned entries
+};// end of RoutingTableEntryPool
+
+/**
+ * \brief Memory footprint of a table.
+ * The byte count is an estimate, it adds up the objects the table keeps and 
+ * the nodes of its containers. The overhead of the heap is not included.
+ */
+struct MemoryUsage
+{
+  MemoryUsage ();
+
+  /**
+   * \brief Add the footprint of another table, to aggregate the tables of a node or of many nodes.
+   * \param usage the other footprint
+   * \returns this footprint
+   */
+  MemoryUsage& operator+= (const MemoryUsage &usage);
+
+  /**
+   * \brief Estimate the size of a container node.
+   * \param valueSize the size of the value the node keeps
+   * \param nLinks the number of pointers of the node
+   * \returns the size, in bytes
+   */
+  static uint64_t GetNodeSize (uint64_t valueSize, uint32_t nLinks)
+  {
+    return valueSize + nLinks * sizeof (void*);
+  }
+
+  uint32_t records; //!< number of table records
+  uint32_t liveObjects; //!< number of entries in use
+  uint32_t pooledObjects; //!< number of entries allocated and waiting for reuse
+  uint32_t pendingEvents; //!< number of pending timers
+  uint64_t bytes; //!< memory used by the table, in bytes
+};
+
+/**
+ * \brief Stream insertion operator.
+ *
+ * \param os the reference to the output stream
+ * \param usage the memory footprint
+ * \returns the reference to the output stream
+ */
+std::ostream& operator<< (std::ostream& os, MemoryUsage const& usage);
+
 class RoutingTable
 {
 public:
 
   /// Container for a Route table entry 
-  typedef std::pair <RoutingTableEntry*, EventId> RouteTableRecord;
+  typedef std::pair <RoutingTableEntry*, TimerId> RouteTableRecord;
   
   /// Container for an instance of the neighbor table
-  typedef std::list<std::pair <RoutingTableEntry*, EventId> > RoutingTableInstance;
+  typedef std::list<std::pair <RoutingTableEntry*, TimerId> > RoutingTableInstance;
 
   /// Iterator for the Route table entry container
-  typedef std::list<std::pair <RoutingTableEntry*, EventId> >::iterator RoutesI;
+  typedef std::list<std::pair <RoutingTableEntry*, TimerId> >::iterator RoutesI;
 
   /// Constant Iterator for the Route table entry container
-  typedef std::list<std::pair <RoutingTableEntry*, EventId> >::const_iterator RoutesCI;
+  typedef std::list<std::pair <RoutingTableEntry*, TimerId> >::const_iterator RoutesCI;
+
+  /// Constant reverse Iterator for the Route table entry container
+  typedef std::list<std::pair <RoutingTableEntry*, TimerId> >::const_reverse_iterator RoutesCRI;
 
   /// Parameters that are needed to call the InvalidateRoutes method
   struct invalidateParams {
@@ -235,6 +389,22 @@ public:
     eslr::Table table;
   }; 
 
+  /**
+   * \brief The routes of one destination prefix.
+   * The m-route, the r-route and the b-route of a destination, together with
+   * their timers (the TimerId of each record).
+   */
+  struct RouteSet
+  {
+    bool hasLocalRoute; //!< a local route (no gateway) is in the main table
+    bool foundMain; //!< true if mainRoute is set
+    RoutesI mainRoute; //!< first m-route learned from a neighbor
+    bool foundPrimary; //!< true if primaryRoute is set
+    RoutesI primaryRoute; //!< VALID r-route
+    bool foundSecondary; //!< true if secondaryRoute is set
+    RoutesI secondaryRoute; //!< VALID b-route
+  };
+
   RoutingTable();
   ~RoutingTable ();
 
@@ -251,7 +421,7 @@ public:
 	 * available in the backup table. This is specifically implemented to prevent
 	 * route oscillations and to improve the reliability.
    * 
-   * \param routingTableEntry The routing table entry
+   * \param routingTableEntry The routing table entry (copied, the caller keeps the ownership)
    * \param invalidateTime the invalidate time
    * \param deleteTime garbage collection time
    * \param settlingTime garbage collection time
@@ -263,6 +433,22 @@ public:
 			Time settingTime, 
 			eslr::Table table);
 
+  /**
+   * \brief Add a batch of routes to destinations that are new to the node.
+   * This method is used for the bulk of routes received with a route response.
+	 * Each route is added to the main table and its reference route to the backup
+	 * table, in a single pass. Routes to local networks and routes to destinations
+	 * that already have a VALID reference route (including the earlier routes of
+	 * the same batch) are skipped.
+   *
+   * \param routes the routes (copied, the caller keeps the ownership)
+   * \param invalidateTime the invalidate time
+   * \param deleteTime garbage collection time
+   */
+  void AddNewRoutes (const std::vector<RoutingTableEntry> &routes, 
+			Time invalidateTime, 
+			Time deleteTime);
+
   /**
    * \brief This method is used to move a route to the main table after 
 	 * settling time expires.
@@ -299,7 +485,7 @@ public:
 	 * wait at the backup table
    * until the settling time expires. 
    *
-   * \param routingTableEntry The routing table entry
+   * \param routingTableEntry The routing table entry (copied, the caller keeps the ownership)
    * \param invalidateTime the invalidate time
    * \param deleteTime garbage collection time
    * \param settlingTime time route has to wait at the backup routing table 
@@ -440,6 +626,20 @@ public:
 			bool &found, 
 			eslr::RouteType routeType);
   
+  /**
+  * \brief Find the m-route, r-route and b-route of a destination prefix.
+  * 	A single lookup gives the same routes as IsLocalRouteAvailable, 
+  * 	FindRouteRecord (MAIN), FindRouteInBackup (PRIMARY) and 
+  * 	FindRouteInBackup (SECONDARY) would return.
+  * \param destination find for the destination
+  * \param netMask network mask of the destination
+  * \param routeSet the found routes
+  * \returns true if any route record exists for the prefix
+  */
+  bool FindRouteSet (Ipv4Address destination, 
+			Ipv4Mask netMask, 
+			RouteSet &routeSet);
+
   /**
   * \brief check and return if local routes in the Main routing table.
   * \param destination find for the destination
@@ -466,7 +666,7 @@ public:
 	 * is updated according to the routingTableEntry and the settling/expiration time
    * are set accordingly.  
    * 
-   * \param routingTableEntry The routing table entry
+   * \param routingTableEntry The routing table entry (copied, the caller keeps the ownership)
    * \param invalidateTime the invalidate time
    * \param deleteTime garbage collection time
    * \param settlingTime time route has to wait at the backup routing tbale before it moves to the Main
@@ -496,18 +696,32 @@ public:
   /**
   * \brief Return an instance of the routing table. 
 	* 		This is specifically implemented for debug purposes.
-	* 		Whenever someone get a instance of the table, it is his responsibility
-	* 		to clear the instance for proper memory management.
+	* 		The instance refers to the route entries of the table, it is only
+	* 		valid until the table is changed. 
+	* 		Use GetMainRoutingTable () to read the main table without a copy.
 	* 		
-  * \param instance an instance of the std::list <RoutingTableEntry*, EventId>
+  * \param instance an instance of the std::list <RoutingTableEntry*, TimerId>
   * \param table indicate table type (main or backup)   
   * \returns true if success  
   */
   void ReturnRoutingTable (RoutingTableInstance &instance, 
 			eslr::Table table);
 
+  /**
+  * \brief Read only view of the main routing table.
+	* 		Nothing is copied, the view reflects the live table. Therefore, 
+	* 		it must not be iterated across a call that changes the table.
+  * \returns the main routing table
+  */
+  const RoutingTableInstance& GetMainRoutingTable () const
+  {
+    return m_mainRoutingTable;
+  }
+
 	/**
 	 * \brief Get route records without any backup routes and return them.
+	 * The instance refers to the route entries of the main table, 
+	 * it is only valid until the table is changed.
 	 * \param interface the interface which route records matched for
 	 * \param instance the found route are returned as a route table instance
 	 * */
@@ -581,33 +795,102 @@ public:
 
   /**
   * \brief increment the sequence number of locally connected routes
+  * 		The local routes derive their sequence number from the epoch of the
+  * 		table, therefore only the epoch is incremented.
   */
   void IncrementSeqNo ();
+
+  /**
+  * \brief Return the sequence number of a main table route.
+  * 		For local routes, the number is derived from the epoch of the table.
+  * \param route the route entry of a main table record
+  * \returns the sequence number of the route
+  */
+  uint16_t GetSequenceNo (const RoutingTableEntry *route) const;
+
+  /**
+  * \brief Return the sequence number to be advertised for a main table route.
+  * \param route the route entry of a main table record
+  * \returns the advertised sequence number of the route
+  */
+  uint16_t GetAdvertisedSequenceNo (const RoutingTableEntry *route) const
+  {
+    return GetSequenceNo (route) + 1;
+  }
   
   /**
   * \brief toggle changed flag of all routes
+  * 		Only the routes in the changed route list are visited.
   */
   void ToggleRouteChanged ();
+
+  /**
+  * \brief Return the changed routes of the main table.
+  * 		The routes are returned from the back to the front of the table, 
+  * 		i.e., in the order of the route update messages. Nothing is copied, 
+  * 		the entries are only valid until the table is changed.
+  * 		The cost is in the number of changed routes, not in the table size.
+  * \param routes the changed routes
+  */
+  void GetChangedRoutes (std::vector<const RoutingTableEntry*> &routes);
   
   /**
-  * \brief return a route to the given destination and the given net-device.
-	* 			This method is used to forward the data packet.
-  * \param destination destination network
-  * \param dev the reference net-device
-  * \param retRoutingTableEntry the returning routing table entry
-  * \returns true if a route found for the specified destination address
+  * \brief Return the forwarding table.
+	* 			The forwarding table is used to forward the data packets. It holds
+	* 			the VALID routes of the main table and it is kept in sync with it.
+  * \returns the forwarding table
+  */
+  const ForwardingTable& GetForwardingTable () const
+  {
+    return m_forwardingTable;
+  }
+
+  /**
+  * \brief Resolve the source addresses of the forwarding table again.
+	* 			Has to be called when the addresses of the interfaces change.
   */
-  bool ReturnRoute (Ipv4Address destination, 
-			Ptr<NetDevice> dev, 
-			RoutesI &retRoutingTableEntry); 
+  void RefreshForwardingTable ()
+  {
+    m_forwardingTable.Refresh ();
+  }
+
+  /**
+  * \brief Select how the forwarding table is looked up.
+  * \param lookup the lookup method
+  */
+  void SetForwardingLookup (eslr::ForwardingLookupType lookup)
+  {
+    m_forwardingTable.EnableDirectIndex (lookup == eslr::DIRECT_INDEX_LOOKUP);
+  }
 
 	/**
 	 * \brief Dispose the routing module*/
-	void DoDispose ()
-	{
-		m_mainRoutingTable.clear ();
-    m_backupRoutingTable.clear ();
-	}
+	void DoDispose ();
+
+  /**
+   * \brief Get the pool the route entries are allocated from
+   * \returns the route entry pool
+   */
+  const RoutingTableEntryPool& GetEntryPool () const
+  {
+    return m_entryPool;
+  }
+
+  /**
+   * \brief Get the memory footprint of both tables, including the forwarding 
+   * table, the indexes and the timers.
+   * \param usage the returned footprint
+   */
+  void GetMemoryUsage (MemoryUsage &usage) const;
+
+  /**
+   * \brief Get the timer wheel that drives the timers of the route records
+   * \returns the timer wheel
+   */
+  const TimerWheel& GetTimerWheel () const
+  {
+    return m_timers;
+  }
 
   /**
   * \brief assign a stream to Uniform Random Variable
@@ -622,12 +905,314 @@ public:
 	{
 		m_ipv4 = ipv4;
 		m_nodeId = m_ipv4->GetObject<Node> ()->GetId ();
+		m_forwardingTable.SetIpv4 (ipv4);
 	}
 
 private:
+  /**
+   * \brief Insert a route record to the main table and index it.
+   * All insertions to the main table have to use this method, 
+   * so that the indexes and the forwarding table stay in sync with the table.
+   * \param route the route record
+   * \param event the event attached to the route record
+   * \param atFront true to insert at the front of the table, otherwise at the back
+   * \returns the iterator of the inserted record
+   */
+  RoutesI InsertMainRoute (RoutingTableEntry *route, 
+      TimerId event, 
+      bool atFront);
+
+  /**
+   * \brief Remove a route record from the main table and from its index.
+   * The route entry of the record is returned to the entry pool.
+   * \param it the route record to be removed
+   */
+  void EraseMainRoute (RoutesI it);
+
+  /**
+   * \brief Insert a route record to the front of the backup table and index it.
+   * All insertions to the backup table have to use this method.
+   * \param route the route record
+   * \param event the event attached to the route record
+   * \returns the iterator of the inserted record
+   */
+  RoutesI InsertBackupRoute (RoutingTableEntry *route, 
+      TimerId event);
+
+  /**
+   * \brief Remove a route record from the backup table and from its index.
+   * The route entry of the record is returned to the entry pool.
+   * \param it the route record to be removed
+   */
+  void EraseBackupRoute (RoutesI it);
+
+  /// Route records of one (network, mask) pair, in table order
+  typedef std::list<RoutesI> PrefixRecords;
+
+  /**
+   * \brief All route records of one destination prefix.
+   * The m-routes of the main table and the r-routes and b-routes of the
+   * backup table are kept together, so that a single lookup gives all of them.
+   */
+  struct PrefixRoutes
+  {
+    PrefixRecords mainRecords; //!< m-routes, in main table order
+    PrefixRecords backupRecords; //!< r-routes and b-routes, in backup table order
+  };
+
+  /// Hash index of the routing tables, keyed by (network, mask)
+  typedef std::tr1::unordered_map<uint64_t, PrefixRoutes> PrefixIndex;
+
+  /**
+   * \brief A route record in the gateway and interface indexes.
+   * The order value follows the position of the record in its table, so that
+   * the records of a gateway or an interface can be processed in table order.
+   */
+  struct NextHopRecord
+  {
+    int64_t order; //!< order of the record in its table
+    RoutesI route; //!< the route record
+  };
+
+  /// Route records of one gateway or interface
+  typedef std::list<NextHopRecord> NextHopRecords;
+
+  /// Hash index of a routing table, keyed by gateway address or interface index
+  typedef std::tr1::unordered_map<uint32_t, NextHopRecords> NextHopIndex;
+
+  /// The gateway and interface indexes of a routing table
+  struct NextHopIndexes
+  {
+    NextHopIndexes () : frontOrder (0), 
+                        backOrder (0)
+    {
+      /*cstrctr*/
+    }
+    NextHopIndex gateways; //!< route records by gateway address
+    NextHopIndex interfaces; //!< route records by interface index
+    int64_t frontOrder; //!< order of the record at the front of the table
+    int64_t backOrder; //!< order of the next record at the back of the table
+  };
+
+  /// Position of a route record in the gateway and interface indexes
+  struct NextHopPosition
+  {
+    int64_t order; //!< order of the record in its table
+    uint32_t gateway; //!< gateway the record is indexed with
+    NextHopRecords::iterator gatewayPos; //!< position in the gateway index
+    uint32_t interface; //!< interface the record is indexed with
+    NextHopRecords::iterator interfacePos; //!< position in the interface index
+  };
+
+  /// Positions of the route records, keyed by the record (not by the route entry)
+  typedef std::tr1::unordered_map<const RouteTableRecord*, NextHopPosition> NextHopPositions;
+
+  /**
+   * \brief Main table records whose route has been marked as changed.
+   * Every main table record with a changed route is listed. A listed route
+   * can be unmarked without leaving the list, such records are dropped 
+   * when the list is read.
+   */
+  typedef std::list<RoutesI> ChangedRoutes;
+
+  /// Positions of the records in the changed route list
+  typedef std::tr1::unordered_map<const RouteTableRecord*, ChangedRoutes::iterator> ChangedPositions;
+
+  /// The epoch each local route of the main table got its sequence number at
+  typedef std::tr1::unordered_map<const RoutingTableEntry*, uint16_t> SequenceEpochs;
+
+  /**
+   * \brief Build the key of the (network, mask) index.
+   * \param network the destination network
+   * \param mask the network mask
+   * \returns the key
+   */
+  static uint64_t GetPrefixKey (Ipv4Address network, Ipv4Mask mask)
+  {
+    return (uint64_t (network.Get ()) << 32) | mask.Get ();
+  }
+
+  /**
+   * \brief Return the route records of both tables for a (network, mask) pair.
+   * \param network the destination network
+   * \param mask the network mask
+   * \returns the route records, or 0 if there is no record
+   */
+  const PrefixRoutes* LookupPrefixRoutes (Ipv4Address network, 
+      Ipv4Mask mask) const;
+
+  /**
+   * \brief Return the route records of a (network, mask) pair.
+   * \param network the destination network
+   * \param mask the network mask
+   * \param table indicate table type (main or backup)
+   * \returns the records in table order, or 0 if there is no record
+   */
+  const PrefixRecords* LookupPrefix (Ipv4Address network, 
+      Ipv4Mask mask, 
+      eslr::Table table) const;
+
+  /**
+   * \brief Fill a route set from the route records of a prefix.
+   * \param routes the route records of the prefix (can be zero)
+   * \param routeSet the route set
+   */
+  static void ResolveRouteSet (const PrefixRoutes *routes, RouteSet &routeSet);
+
+  /**
+   * \brief Find the record of the given route entry.
+   * \param records the route records of a prefix
+   * \param route the route entry
+   * \param retRoutingTableEntry the found record
+   * \returns true if found
+   */
+  static bool FindGivenRecord (const PrefixRecords &records, 
+      RoutingTableEntry *route, 
+      RoutesI &retRoutingTableEntry);
+
+  /**
+   * \brief Find the last VALID record that uses the given gateway.
+   * \param records the route records of a prefix
+   * \param gateway the gateway
+   * \param retRoutingTableEntry the found record
+   * \returns true if found
+   */
+  static bool FindValidRecordForGateway (const PrefixRecords &records, 
+      Ipv4Address gateway, 
+      RoutesI &retRoutingTableEntry);
+
+  /**
+   * \brief Add a route record to the prefix index.
+   * \param it the route record
+   * \param table indicate table type (main or backup)
+   * \param atFront true if the record was inserted at the front of the table
+   */
+  void IndexRoute (RoutesI it, eslr::Table table, bool atFront);
+
+  /**
+   * \brief Remove a route record from the prefix index.
+   * \param it the route record
+   * \param table indicate table type (main or backup)
+   */
+  void UnindexRoute (RoutesI it, eslr::Table table);
+
+  /**
+   * \brief Add a route record to the gateway and interface indexes.
+   * \param it the route record
+   * \param table indicate table type (main or backup)
+   * \param order the order of the record in its table
+   */
+  void IndexNextHop (RoutesI it, eslr::Table table, int64_t order);
+
+  /**
+   * \brief Remove a route record from the gateway and interface indexes.
+   * The route entry of the record is not accessed, so that it can be 
+   * already deleted.
+   * \param it the route record
+   * \param table indicate table type (main or backup)
+   */
+  void UnindexNextHop (RoutesI it, eslr::Table table);
+
+  /**
+   * \brief Update the route entry of a route record in place.
+   * The new values have to be for the same (network, mask), but they can use
+   * a different gateway or interface.
+   * \param it the route record
+   * \param route the new values of the route entry
+   * \param table indicate table type (main or backup)
+   */
+  void UpdateRouteEntry (RoutesI it, const RoutingTableEntry &route, eslr::Table table);
+
+  /**
+   * \brief Set the state of a route record of the main table.
+   * The state of a main table record has to be changed with this method,
+   * or with UpdateRouteEntry, so that the forwarding table stays in sync.
+   * \param it the route record
+   * \param validity the new state
+   */
+  void SetMainRouteValidity (RoutesI it, eslr::Validity validity);
+
+  /**
+   * \brief Rebuild the forwarding entries of a destination from the main table.
+   * \param network the destination network
+   * \param mask the network mask
+   */
+  void UpdateForwardingEntries (Ipv4Address network, Ipv4Mask mask);
+
+  /**
+   * \brief Update the metric and the b-route kept on the forwarding entry of a destination.
+   * Has to be called whenever a record of the destination changes its metric,
+   * or a backup table record of the destination changes.
+   * \param network the destination network
+   * \param mask the network mask
+   */
+  void UpdateForwardingBackup (Ipv4Address network, Ipv4Mask mask);
+
+  /**
+   * \brief Mark a route record of the main table as changed.
+   * \param it the route record
+   */
+  void MarkRouteChanged (RoutesI it);
+
+  /**
+   * \brief Add a main table record to the changed route list, if its route 
+   * is marked as changed and the record is not listed yet.
+   * \param it the route record
+   */
+  void QueueChangedRoute (RoutesI it);
+
+  /**
+   * \brief Remove a main table record from the changed route list.
+   * \param it the route record
+   */
+  void DequeueChangedRoute (RoutesI it);
+
+  /**
+   * \brief Check if a route takes its sequence number from the epoch.
+   * \param route the route entry
+   * \returns true for local routes, except the local host route
+   */
+  static bool IsSequencedByEpoch (const RoutingTableEntry *route)
+  {
+    return ((route->GetDestNetwork () != "127.0.0.1") && (route->GetGateway () == Ipv4Address::GetZero ()));
+  }
+
+  /**
+   * \brief Keep the epoch the sequence number of a main table route was set at.
+   * Called whenever a route entry of the main table is written.
+   * \param it the route record
+   */
+  void SetSequenceEpoch (RoutesI it);
+
+  /**
+   * \brief Return the route records of a gateway or an interface in table order.
+   * \param index the gateway or interface index
+   * \param key the gateway address or the interface index
+   * \param records the route records
+   */
+  static void GetNextHopRecords (const NextHopIndex &index, 
+      uint32_t key, 
+      std::vector<RoutesI> &records);
+
+  RoutingTableEntryPool m_entryPool; //!< the route entries of both tables
+  TimerWheel m_timers; //!< the timers of the route records of both tables
+
   RoutingTableInstance m_mainRoutingTable; //!< Instance of the Main Routing Table
   RoutingTableInstance m_backupRoutingTable; //!< Instance of the Backup Routing Table
 
+  ForwardingTable m_forwardingTable; //!< the VALID routes of the main table, used to forward the packets
+
+  PrefixIndex m_prefixIndex; //!< (network, mask) index of both tables
+  NextHopIndexes m_mainNextHops; //!< gateway and interface indexes of the main table
+  NextHopIndexes m_backupNextHops; //!< gateway and interface indexes of the backup table
+  NextHopPositions m_nextHopPositions; //!< positions of the records in the next hop indexes
+
+  ChangedRoutes m_changedRoutes; //!< main table records with a changed route
+  ChangedPositions m_changedPositions; //!< positions of the records in the changed route list
+
+  uint16_t m_sequenceEpoch; //!< number of sequence number increments of the local routes
+  SequenceEpochs m_sequenceEpochs; //!< epochs of the local routes of the main table
+
   Ptr<UniformRandomVariable> m_rng; //!< Rng stream.
 	Ptr<Ipv4> m_ipv4; //!< Ipv4 pointer
 	Ptr<Node> m_node; //!< node the routing protocol is running on 
@@ -0,0 +1,330 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#include <algorithm>
+
+#include "eslr-timer-wheel.h"
+
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+NS_LOG_COMPONENT_DEFINE ("ESLRTimerWheel");
+
+namespace ns3 {
+namespace eslr {
+
+/// The first level has 2^FIRST_LEVEL_BITS slots
+static const uint32_t FIRST_LEVEL_BITS = 8;
+/// Each higher level has 2^LEVEL_BITS slots
+static const uint32_t LEVEL_BITS = 6;
+/// Number of levels
+static const uint32_t N_LEVELS = 4;
+
+/// Number of ticks the whole wheel covers, later timers wait in the last level
+static const uint64_t WHEEL_SPAN = uint64_t (1) << (FIRST_LEVEL_BITS + (N_LEVELS - 1) * LEVEL_BITS);
+
+/*
+* Timer Id
+*/
+
+TimerId::TimerId ()
+{
+  /*cstrctr*/
+}
+
+TimerId::TimerId (Ptr<WheelTimer> timer) : m_timer (timer)
+{
+  /*cstrctr*/
+}
+
+void
+TimerId::Cancel (void)
+{
+  if (m_timer != 0 && m_timer->wheel != 0)
+    m_timer->wheel->Remove (PeekPointer (m_timer));
+}
+
+bool
+TimerId::IsExpired (void) const
+{
+  return (m_timer == 0 || m_timer->wheel == 0);
+}
+
+bool
+TimerId::IsRunning (void) const
+{
+  return !IsExpired ();
+}
+
+Time
+TimerId::GetDelayLeft (void) const
+{
+  if (IsExpired ())
+    return Seconds (0);
+
+  Time delay = m_timer->expiration - Simulator::Now ();
+  return (delay.IsStrictlyPositive ()) ? delay : Seconds (0);
+}
+
+/*
+* Timer Wheel
+*/
+
+TimerWheel::TimerWheel () : m_resolution (MilliSeconds (100)),
+                            m_currentTick (0),
+                            m_nextTick (0),
+                            m_nTimers (0),
+                            m_nextUid (0),
+                            m_nTicks (0)
+{
+  m_levels.push_back (Level (1 << FIRST_LEVEL_BITS));
+  for (uint32_t level = 1; level < N_LEVELS; level++)
+  {
+    m_levels.push_back (Level (1 << LEVEL_BITS));
+  }
+}
+
+TimerWheel::~TimerWheel ()
+{
+  /*dstrctr*/
+  // the simulator can be already destroyed, the tick event is left alone
+  DetachTimers ();
+}
+
+void
+TimerWheel::SetResolution (Time resolution)
+{
+  NS_LOG_FUNCTION (this << resolution);
+  NS_ASSERT_MSG (m_nTimers == 0, "ESLR: the resolution can not be changed while timers are pending");
+  NS_ASSERT (resolution.IsStrictlyPositive ());
+
+  m_resolution = resolution;
+}
+
+TimerId
+TimerWheel::DoSchedule (Time const &delay, EventImpl *event)
+{
+  Time now = Simulator::Now ();
+  bool idle = (m_nTimers == 0 && !m_tickEvent.IsRunning ());
+  if (idle)
+  {
+    // restart the wheel from the current tick
+    m_currentTick = now.GetTimeStep () / m_resolution.GetTimeStep ();
+  }
+
+  Ptr<WheelTimer> timer = Create<WheelTimer> ();
+  timer->event = Ptr<EventImpl> (event, false);
+  timer->expiration = now + delay;
+  timer->tick = std::max (GetTickAt (timer->expiration), m_currentTick + 1);
+  timer->uid = m_nextUid++;
+  timer->wheel = this;
+  timer->slot = 0;
+
+  Insert (timer);
+  m_nTimers++;
+
+  if (idle)
+  {
+    ScheduleTick (GetNextTick ());
+  }
+  else if (timer->tick < m_nextTick)
+  {
+    // the timer expires before the tick the wheel is waiting for
+    m_tickEvent.Cancel ();
+    ScheduleTick (timer->tick);
+  }
+  return TimerId (timer);
+}
+
+void
+TimerWheel::Remove (WheelTimer *timer)
+{
+  NS_ASSERT (timer->wheel == this);
+
+  timer->slot->erase (timer->position);
+  timer->slot = 0;
+  timer->wheel = 0;
+  timer->event->Cancel ();
+  m_nTimers--;
+}
+
+void
+TimerWheel::Insert (Ptr<WheelTimer> timer)
+{
+  uint64_t tick = timer->tick;
+  uint64_t delta = tick - m_currentTick;
+  if (delta >= WHEEL_SPAN)
+  {
+    // wait in the last slot the wheel can reach, it is cascaded again from there
+    tick = m_currentTick + WHEEL_SPAN - 1;
+    delta = WHEEL_SPAN - 1;
+  }
+
+  uint32_t level = 0;
+  uint32_t shift = 0;
+  uint32_t bits = FIRST_LEVEL_BITS;
+  while (delta >= (uint64_t (1) << (shift + bits)))
+  {
+    shift += bits;
+    bits = LEVEL_BITS;
+    level++;
+  }
+
+  std::list<Ptr<WheelTimer> > &slot = m_levels[level][(tick >> shift) & ((uint64_t (1) << bits) - 1)];
+  timer->position = slot.insert (slot.end (), timer);
+  timer->slot = &slot;
+}
+
+void
+TimerWheel::Cascade (uint32_t level)
+{
+  uint32_t shift = FIRST_LEVEL_BITS + (level - 1) * LEVEL_BITS;
+  std::list<Ptr<WheelTimer> > timers;
+  timers.swap (m_levels[level][(m_currentTick >> shift) & ((1 << LEVEL_BITS) - 1)]);
+
+  for (std::list<Ptr<WheelTimer> >::iterator it = timers.begin (); it != timers.end (); it++)
+  {
+    Insert (*it);
+  }
+}
+
+void
+TimerWheel::Tick (void)
+{
+  m_currentTick = m_nextTick;
+  m_nTicks++;
+
+  // when a level wraps around, the next slot of the higher level moves down
+  uint64_t mask = (uint64_t (1) << FIRST_LEVEL_BITS) - 1;
+  for (uint32_t level = 1; level < N_LEVELS && (m_currentTick & mask) == 0; level++)
+  {
+    Cascade (level);
+    mask = (mask << LEVEL_BITS) | ((uint64_t (1) << LEVEL_BITS) - 1);
+  }
+
+  std::list<Ptr<WheelTimer> > &slot = m_levels[0][m_currentTick & ((1 << FIRST_LEVEL_BITS) - 1)];
+  std::vector<Ptr<WheelTimer> > expired;
+  expired.reserve (slot.size ());
+  for (std::list<Ptr<WheelTimer> >::iterator it = slot.begin (); it != slot.end (); it++)
+  {
+    NS_ASSERT ((*it)->tick == m_currentTick);
+    (*it)->slot = 0;
+    (*it)->wheel = 0;
+    expired.push_back (*it);
+  }
+  slot.clear ();
+  m_nTimers -= expired.size ();
+  std::sort (expired.begin (), expired.end (), CompareExpiration);
+
+  // schedule the next tick first, the invoked timers may cancel or add timers
+  m_tickEvent = EventId ();
+  if (m_nTimers > 0)
+    ScheduleTick (GetNextTick ());
+
+  for (std::vector<Ptr<WheelTimer> >::iterator it = expired.begin (); it != expired.end (); it++)
+  {
+    (*it)->event->Invoke ();
+  }
+}
+
+void
+TimerWheel::Clear (void)
+{
+  DetachTimers ();
+  m_tickEvent.Cancel ();
+  m_tickEvent = EventId ();
+}
+
+uint64_t
+TimerWheel::GetMemorySize (void) const
+{
+  uint64_t bytes = 0;
+  for (std::vector<Level>::const_iterator level = m_levels.begin (); level != m_levels.end (); level++)
+  {
+    bytes += level->capacity () * sizeof (std::list<Ptr<WheelTimer> >);
+  }
+  // each timer is a list node of its slot, the timer itself and its event
+  bytes += uint64_t (m_nTimers) * (sizeof (Ptr<WheelTimer>) + 2 * sizeof (void*) + 
+                                   sizeof (WheelTimer) + sizeof (EventImpl));
+  return bytes;
+}
+
+void
+TimerWheel::DetachTimers (void)
+{
+  for (std::vector<Level>::iterator level = m_levels.begin (); level != m_levels.end (); level++)
+  {
+    for (Level::iterator slot = level->begin (); slot != level->end (); slot++)
+    {
+      for (std::list<Ptr<WheelTimer> >::iterator it = slot->begin (); it != slot->end (); it++)
+      {
+        (*it)->slot = 0;
+        (*it)->wheel = 0;
+        (*it)->event->Cancel ();
+      }
+      slot->clear ();
+    }
+  }
+  m_nTimers = 0;
+}
+
+void
+TimerWheel::ScheduleTick (uint64_t tick)
+{
+  m_nextTick = tick;
+  m_tickEvent = Simulator::Schedule (TimeStep (tick * m_resolution.GetTimeStep ()) - Simulator::Now (),
+                                     &TimerWheel::Tick,
+                                     this);
+}
+
+uint64_t
+TimerWheel::GetNextTick (void) const
+{
+  // the empty slots of the first level are skipped,
+  // but the wheel stops at each wrap around to cascade the higher levels
+  uint64_t wrapAround = (m_currentTick | ((1 << FIRST_LEVEL_BITS) - 1)) + 1;
+  for (uint64_t tick = m_currentTick + 1; tick < wrapAround; tick++)
+  {
+    if (!m_levels[0][tick & ((1 << FIRST_LEVEL_BITS) - 1)].empty ())
+      return tick;
+  }
+  return wrapAround;
+}
+
+uint64_t
+TimerWheel::GetTickAt (Time time) const
+{
+  // the first tick at or after the given time
+  int64_t step = time.GetTimeStep ();
+  int64_t resolution = m_resolution.GetTimeStep ();
+  return (step + resolution - 1) / resolution;
+}
+
+bool
+TimerWheel::CompareExpiration (const Ptr<WheelTimer> &a, const Ptr<WheelTimer> &b)
+{
+  if (a->expiration != b->expiration)
+    return a->expiration < b->expiration;
+  return a->uid < b->uid;
+}
+
+}// end of namespace eslr
+}// end of namespace ns3
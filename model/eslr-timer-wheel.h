@@ -0,0 +1,239 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
+
+#ifndef ESLR_TIMER_WHEEL_H
+#define ESLR_TIMER_WHEEL_H
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/event-impl.h"
+#include "ns3/make-event.h"
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+namespace eslr {
+
+class TimerWheel;
+
+/// A timer that is kept in the slots of a TimerWheel
+struct WheelTimer : public SimpleRefCount<WheelTimer>
+{
+  Ptr<EventImpl> event; //!< the event to invoke at the expiration
+  Time expiration; //!< the requested expiration time
+  uint64_t tick; //!< the tick the timer expires at
+  uint64_t uid; //!< the order the timers were scheduled
+  TimerWheel *wheel; //!< the wheel the timer is pending in, 0 if it is not pending
+  std::list<Ptr<WheelTimer> > *slot; //!< the slot that keeps the timer
+  std::list<Ptr<WheelTimer> >::iterator position; //!< the position of the timer in its slot
+};
+
+/**
+ * \brief Identifier of a timer scheduled in a TimerWheel.
+ * Provides the part of the EventId interface that the tables use.
+ * A default constructed TimerId is expired.
+ */
+class TimerId
+{
+public:
+  TimerId ();
+
+  /**
+   * \brief Cancel the timer. Nothing happens if the timer is not pending.
+   */
+  void Cancel (void);
+
+  /**
+   * \returns true if the timer has expired, has been canceled or has never been scheduled
+   */
+  bool IsExpired (void) const;
+
+  /**
+   * \returns true if the timer is pending
+   */
+  bool IsRunning (void) const;
+
+  /**
+   * \returns the time left until the requested expiration, or zero if the timer is not pending
+   */
+  Time GetDelayLeft (void) const;
+
+private:
+  friend class TimerWheel;
+  /**
+   * \brief Constructor
+   * \param timer the scheduled timer
+   */
+  TimerId (Ptr<WheelTimer> timer);
+
+  Ptr<WheelTimer> m_timer; //!< the identified timer
+}; // end of class TimerId
+
+/**
+ * \brief Hierarchical timing wheel for the protocol timers.
+ *
+ * The route and neighbor records are rescheduled with almost every update.
+ * Scheduling each of them with the simulator leaves a cancelled event in the
+ * simulator's queue for every update. Instead, the wheel keeps the timers in
+ * slots and it is driven by a single simulator event per tick. Scheduling and
+ * canceling a timer are O(1).
+ *
+ * The first level has 256 slots of one tick, each of the next three levels
+ * has 64 slots, a slot covers all the slots of the lower level. The timers of
+ * a higher level slot are cascaded down when the lower level wraps around.
+ *
+ * A timer expires at the first tick at or after its expiration time, i.e., at
+ * most one tick late. The timers expiring at the same tick are invoked in
+ * order of their expiration times, and in scheduling order for equal times.
+ * The tick event is only scheduled while there are pending timers, and it
+ * skips the empty slots of the first level.
+ */
+class TimerWheel
+{
+public:
+  TimerWheel ();
+  ~TimerWheel ();
+
+  /**
+   * \brief Set the length of a tick. Only allowed while no timer is pending.
+   * \param resolution the tick length
+   */
+  void SetResolution (Time resolution);
+
+  /**
+   * \returns the length of a tick
+   */
+  Time GetResolution (void) const
+  {
+    return m_resolution;
+  }
+
+  /**
+   * \brief Schedule a member function to be invoked after a delay.
+   * \param delay the delay
+   * \param memPtr the member function
+   * \param obj the object to invoke the member function on
+   * \returns the identifier of the timer
+   */
+  template <typename MEM, typename OBJ>
+  TimerId Schedule (Time const &delay, MEM memPtr, OBJ obj)
+  {
+    return DoSchedule (delay, MakeEvent (memPtr, obj));
+  }
+
+  /**
+   * \copydoc Schedule
+   * \param a1 the first argument of the member function
+   */
+  template <typename MEM, typename OBJ, typename T1>
+  TimerId Schedule (Time const &delay, MEM memPtr, OBJ obj, T1 a1)
+  {
+    return DoSchedule (delay, MakeEvent (memPtr, obj, a1));
+  }
+
+  /**
+   * \copydoc Schedule
+   * \param a1 the first argument of the member function
+   * \param a2 the second argument of the member function
+   */
+  template <typename MEM, typename OBJ, typename T1, typename T2>
+  TimerId Schedule (Time const &delay, MEM memPtr, OBJ obj, T1 a1, T2 a2)
+  {
+    return DoSchedule (delay, MakeEvent (memPtr, obj, a1, a2));
+  }
+
+  /**
+   * \copydoc Schedule
+   * \param a1 the first argument of the member function
+   * \param a2 the second argument of the member function
+   * \param a3 the third argument of the member function
+   * \param a4 the fourth argument of the member function
+   */
+  template <typename MEM, typename OBJ, typename T1, typename T2, typename T3, typename T4>
+  TimerId Schedule (Time const &delay, MEM memPtr, OBJ obj, T1 a1, T2 a2, T3 a3, T4 a4)
+  {
+    return DoSchedule (delay, MakeEvent (memPtr, obj, a1, a2, a3, a4));
+  }
+
+  /**
+   * \brief Cancel all the pending timers and stop the tick event.
+   */
+  void Clear (void);
+
+  /**
+   * \returns the number of pending timers
+   */
+  uint32_t GetNTimers (void) const
+  {
+    return m_nTimers;
+  }
+
+  /**
+   * \returns the number of tick events the wheel has processed
+   */
+  uint64_t GetNTicks (void) const
+  {
+    return m_nTicks;
+  }
+
+  /**
+   * \returns the memory used by the slots and the pending timers, in bytes (estimate)
+   */
+  uint64_t GetMemorySize (void) const;
+
+private:
+  friend class TimerId;
+
+  /// The slots of one level
+  typedef std::vector<std::list<Ptr<WheelTimer> > > Level;
+
+  /// The wheel owns its slots, copying is not allowed
+  TimerWheel (const TimerWheel &);
+  TimerWheel& operator= (const TimerWheel &);
+
+  TimerId DoSchedule (Time const &delay, EventImpl *event);
+  void Remove (WheelTimer *timer);
+  void Insert (Ptr<WheelTimer> timer);
+  void Cascade (uint32_t level);
+  void DetachTimers (void);
+  void Tick (void);
+  void ScheduleTick (uint64_t tick);
+  uint64_t GetNextTick (void) const;
+  uint64_t GetTickAt (Time time) const;
+
+  static bool CompareExpiration (const Ptr<WheelTimer> &a, const Ptr<WheelTimer> &b);
+
+  Time m_resolution; //!< the length of a tick
+  std::vector<Level> m_levels; //!< the slots of each level
+  uint64_t m_currentTick; //!< the last processed tick
+  uint64_t m_nextTick; //!< the tick the tick event is scheduled for
+  uint32_t m_nTimers; //!< number of pending timers
+  uint64_t m_nextUid; //!< the order of the next scheduled timer
+  uint64_t m_nTicks; //!< number of processed ticks
+  EventId m_tickEvent; //!< the next tick
+}; // end of class TimerWheel
+
+}// end of namespace eslr
+}// end of namespace ns3
+#endif /* ESLR_TIMER_WHEEL_H */
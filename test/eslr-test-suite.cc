@@ -1,55 +1,758 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2010 Hiroaki Nishi Laboratory, Keio University, Japan
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * Author: Janaka Wijekoon <janaka@west.sd.ekio.ac.jp>, Hiroaki Nishi <west@sd.keio.ac.jp>
+ */
 
-// Include a header file from your module to test.
-#include "ns3/eslr-main.h"
+#include <list>
+#include <map>
+#include <vector>
 
-// An essential include is test.h
+#include "ns3/eslr-definition.h"
+#include "ns3/eslr-headers.h"
+#include "ns3/eslr-timer-wheel.h"
+#include "ns3/eslr-forwarding-table.h"
+#include "ns3/eslr-prefix-trie.h"
+
+#include "ns3/buffer.h"
+#include "ns3/simulator.h"
 #include "ns3/test.h"
 
-// Do not put your test classes in namespace ns3.  You may find it useful
-// to use the using directive to access the ns3 namespace directly
 using namespace ns3;
+using namespace eslr;
+
+/// Build a RUM
+static ESLRrum
+MakeRum (const char *destination, uint32_t mask, uint32_t metric, uint16_t sequenceNo, bool dBit = false)
+{
+  ESLRrum rum;
+  rum.SetDestAddress (Ipv4Address (destination));
+  rum.SetDestMask (Ipv4Mask (mask));
+  rum.SetMatric (metric);
+  rum.SetSequenceNo (sequenceNo);
+  rum.SetCbit (!dBit);
+  rum.SetDbit (dBit);
+  return rum;
+}
+
+/**
+ * \brief Round trip of the compact RUM encoding.
+ */
+class EslrCompactRumTestCase : public TestCase
+{
+public:
+  EslrCompactRumTestCase ();
+  virtual ~EslrCompactRumTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Encode a RUM, decode it back and compare.
+   * \param rum the RUM
+   * \param baseSequence the base sequence number
+   * \param size the expected size of the encoded RUM
+   */
+  void CheckRoundTrip (const ESLRrum &rum, uint16_t baseSequence, uint32_t size);
+};
+
+EslrCompactRumTestCase::EslrCompactRumTestCase ()
+  : TestCase ("ESLR compact RUM encoding round trip")
+{
+  /*cstrctr*/
+}
+
+EslrCompactRumTestCase::~EslrCompactRumTestCase ()
+{
+  /*dstrctr*/
+}
+
+void
+EslrCompactRumTestCase::CheckRoundTrip (const ESLRrum &rum, uint16_t baseSequence, uint32_t size)
+{
+  NS_TEST_ASSERT_MSG_EQ (rum.GetCompactSize (baseSequence), size, "wrong compact size of " << rum);
+
+  Buffer buffer;
+  buffer.AddAtStart (COMPACT_RUM_MAX_SIZE);
+  uint32_t written = rum.SerializeCompact (buffer.Begin (), baseSequence);
+  NS_TEST_ASSERT_MSG_EQ (written, size, "wrong number of bytes written for " << rum);
+
+  ESLRrum decoded;
+  uint32_t read = decoded.DeserializeCompact (buffer.Begin (), baseSequence);
+  NS_TEST_ASSERT_MSG_EQ (read, size, "wrong number of bytes read for " << rum);
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetDestAddress (), rum.GetDestAddress (), "wrong destination");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetDestMask (), rum.GetDestMask (), "wrong mask");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetMatric (), rum.GetMatric (), "wrong metric");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetSequenceNo (), rum.GetSequenceNo (), "wrong sequence number");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetrouteTag (), rum.GetrouteTag (), "wrong route tag");
+}
+
+void
+EslrCompactRumTestCase::DoRun (void)
+{
+  // tag, length, 3 address bytes, 1 metric byte, 1 sequence byte
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 100, 7, false), 6, 7);
+
+  // the default route carries no address byte
+  CheckRoundTrip (MakeRum ("0.0.0.0", 0x00000000, 1, 6, false), 6, 4);
+
+  // a host route carries the whole address
+  CheckRoundTrip (MakeRum ("10.1.2.3", 0xffffffff, 1, 6, false), 6, 8);
+
+  // a D-bit RUM keeps its tag
+  CheckRoundTrip (MakeRum ("172.16.0.0", 0xffff0000, 1, 6, true), 6, 6);
+
+  // the largest metric takes a 5 byte varint
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 0xffffffff, 6, false), 6, 11);
+
+  // the metric 128 is the first that takes 2 bytes
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 127, 6, false), 6, 7);
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 128, 6, false), 6, 8);
+
+  // negative sequence deltas, within the byte and across the wrap-around of the sequence number
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 1, 5, false), 6, 7);
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 1, 65535, false), 1, 7);
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 1, 0, false), 0x8000, 9);
+  CheckRoundTrip (MakeRum ("10.1.2.0", 0xffffff00, 1, 0x7fff, false), 0, 9);
+
+  // escapes: a non-contiguous mask, and address bits beyond the carried bytes
+  CheckRoundTrip (MakeRum ("10.0.2.0", 0xff00ff00, 1, 6, false), 6, 12);
+  CheckRoundTrip (MakeRum ("10.1.2.3", 0xffffff00, 1, 6, false), 6, 12);
+
+  // the address bits beyond the prefix, within the carried bytes, need no escape
+  CheckRoundTrip (MakeRum ("10.1.2.128", 0xffffff80, 1, 6, false), 6, 8);
+  CheckRoundTrip (MakeRum ("10.1.2.129", 0xffffff80, 1, 6, false), 6, 8);
+
+  // the largest compact RUM
+  CheckRoundTrip (MakeRum ("10.0.2.0", 0xff00ff00, 0xffffffff, 0x8000, false), 0, COMPACT_RUM_MAX_SIZE);
+}
+
+/**
+ * \brief Round trip of the route update headers of both versions.
+ */
+class EslrRouteUpdateHeaderTestCase : public TestCase
+{
+public:
+  EslrRouteUpdateHeaderTestCase ();
+  virtual ~EslrRouteUpdateHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Build a route update header.
+   * \param version the header version
+   * \param compact the RUMs are compact
+   * \param sequenced the header carries the update sequence block
+   * \param nRums the number of RUMs
+   * \param hdr the header
+   */
+  void BuildHeader (uint8_t version, bool compact, bool sequenced, uint32_t nRums, ESLRRoutingHeader &hdr);
+
+  /**
+   * \brief Serialize a header, deserialize it back and compare.
+   * \param hdr the header
+   * \param noe the expected NoE of the decoded header
+   */
+  void CheckRoundTrip (const ESLRRoutingHeader &hdr, uint16_t noe);
+};
+
+EslrRouteUpdateHeaderTestCase::EslrRouteUpdateHeaderTestCase ()
+  : TestCase ("ESLR route update header round trip")
+{
+  /*cstrctr*/
+}
+
+EslrRouteUpdateHeaderTestCase::~EslrRouteUpdateHeaderTestCase ()
+{
+  /*dstrctr*/
+}
+
+void
+EslrRouteUpdateHeaderTestCase::BuildHeader (uint8_t version,
+                                            bool compact,
+                                            bool sequenced,
+                                            uint32_t nRums,
+                                            ESLRRoutingHeader &hdr)
+{
+  hdr.SetVersion (version);
+  hdr.SetCommand (RU);
+  hdr.SetRuCommand (RESPONSE);
+  hdr.SetRoutingTableRequestType (NON);
+  hdr.SetPeriodicUpdate (true);
+  hdr.SetAuthData (1234);
+  hdr.SetCompact (compact);
+  if (sequenced)
+  {
+    hdr.SetSequenced (true);
+    hdr.SetUpdateSequence (42);
+    hdr.SetNMessages (3);
+    hdr.SetDigest (0xdeadbeef);
+  }
+
+  // prefixes of all lengths, with sequence numbers on both sides of the first one
+  for (uint32_t n = 0; n < nRums; n++)
+  {
+    uint32_t length = n % 33;
+    uint32_t mask = (length == 0) ? 0 : (0xffffffff << (32 - length));
+    ESLRrum rum;
+    rum.SetDestAddress (Ipv4Address ((0x0a000000 + (n << 8)) & mask));
+    rum.SetDestMask (Ipv4Mask (mask));
+    rum.SetMatric ((n % 7 == 0) ? 0xffffffff : n * 1000);
+    rum.SetSequenceNo (uint16_t ((n % 2) ? 100 + n : 100 - n));
+    rum.SetCbit (n % 5 != 0);
+    rum.SetDbit (n % 5 == 0);
+    hdr.AddRum (rum);
+  }
+}
+
+void
+EslrRouteUpdateHeaderTestCase::CheckRoundTrip (const ESLRRoutingHeader &hdr, uint16_t noe)
+{
+  Buffer buffer;
+  buffer.AddAtStart (hdr.GetSerializedSize ());
+  hdr.Serialize (buffer.Begin ());
+
+  ESLRRoutingHeader decoded;
+  uint32_t read = decoded.Deserialize (buffer.Begin ());
+  NS_TEST_ASSERT_MSG_EQ (read, hdr.GetSerializedSize (), "wrong number of bytes read");
+  NS_TEST_ASSERT_MSG_EQ (int (decoded.GetVersion ()), int (hdr.GetVersion ()), "wrong version");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetNoe (), noe, "wrong NoE");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetAuthData (), hdr.GetAuthData (), "wrong authentication data");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetCompact (), hdr.GetCompact (), "wrong K bit");
+  NS_TEST_ASSERT_MSG_EQ (decoded.GetSequenced (), hdr.GetSequenced (), "wrong S bit");
+  if (hdr.GetSequenced ())
+  {
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetUpdateSequence (), hdr.GetUpdateSequence (), "wrong update sequence");
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetNMessages (), hdr.GetNMessages (), "wrong number of messages");
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetDigest (), hdr.GetDigest (), "wrong digest");
+  }
+  if (hdr.GetCompact ())
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetBaseSequence (), hdr.GetBaseSequence (), "wrong base sequence");
+
+  std::list<ESLRrum> sent = hdr.GetRumList ();
+  std::list<ESLRrum> received = decoded.GetRumList ();
+  NS_TEST_ASSERT_MSG_EQ (received.size (), sent.size (), "wrong number of RUMs");
+
+  std::list<ESLRrum>::const_iterator r = received.begin ();
+  for (std::list<ESLRrum>::const_iterator s = sent.begin (); s != sent.end (); s++, r++)
+  {
+    NS_TEST_ASSERT_MSG_EQ (r->GetDestAddress (), s->GetDestAddress (), "wrong destination");
+    NS_TEST_ASSERT_MSG_EQ (r->GetDestMask (), s->GetDestMask (), "wrong mask");
+    NS_TEST_ASSERT_MSG_EQ (r->GetMatric (), s->GetMatric (), "wrong metric");
+    NS_TEST_ASSERT_MSG_EQ (r->GetSequenceNo (), s->GetSequenceNo (), "wrong sequence number");
+    NS_TEST_ASSERT_MSG_EQ (r->GetrouteTag (), s->GetrouteTag (), "wrong route tag");
+  }
+}
+
+void
+EslrRouteUpdateHeaderTestCase::DoRun (void)
+{
+  // version 2, the NoE counts more than 255 RUMs
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (2, false, false, 300, hdr);
+    CheckRoundTrip (hdr, 300);
+  }
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (2, false, true, 300, hdr);
+    CheckRoundTrip (hdr, 300);
+  }
+
+  // compact RUMs, with and without the update sequence block
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (2, true, false, 300, hdr);
+    CheckRoundTrip (hdr, 300);
+  }
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (2, true, true, 40, hdr);
+    CheckRoundTrip (hdr, 40);
+  }
+
+  // version 1, the RUMs are counted from the size, the NoE field saturates at 255
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (1, false, false, 20, hdr);
+    CheckRoundTrip (hdr, 20);
+  }
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (1, false, true, 300, hdr);
+    CheckRoundTrip (hdr, 255);
+  }
+
+  // the compact RUMs can not be counted without the version 2 NoE
+  {
+    ESLRRoutingHeader hdr;
+    BuildHeader (1, true, false, 10, hdr);
+
+    Buffer buffer;
+    buffer.AddAtStart (hdr.GetSerializedSize ());
+    hdr.Serialize (buffer.Begin ());
+
+    ESLRRoutingHeader decoded;
+    NS_TEST_ASSERT_MSG_EQ (decoded.Deserialize (buffer.Begin ()), uint32_t (0), "a version 1 compact update was decoded");
+  }
+}
+
+/**
+ * \brief Round trip of the compact RUM capability of the KAMs.
+ */
+class EslrKamCapabilityTestCase : public TestCase
+{
+public:
+  EslrKamCapabilityTestCase ();
+  virtual ~EslrKamCapabilityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+EslrKamCapabilityTestCase::EslrKamCapabilityTestCase ()
+  : TestCase ("ESLR KAM capability round trip")
+{
+  /*cstrctr*/
+}
+
+EslrKamCapabilityTestCase::~EslrKamCapabilityTestCase ()
+{
+  /*dstrctr*/
+}
+
+void
+EslrKamCapabilityTestCase::DoRun (void)
+{
+  for (uint32_t compact = 0; compact < 2; compact++)
+  {
+    KAMHeader kam;
+    kam.SetCommand (HELLO);
+    kam.SetIdentifier (7);
+    kam.SetCompactRums (compact != 0);
+
+    Buffer buffer;
+    buffer.AddAtStart (kam.GetSerializedSize ());
+    kam.Serialize (buffer.Begin ());
+
+    KAMHeader decoded;
+    decoded.Deserialize (buffer.Begin ());
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetCompactRums (), (compact != 0), "wrong compact RUM capability");
+    NS_TEST_ASSERT_MSG_EQ (decoded.Getcommand (), HELLO, "the capability changed the command");
+    NS_TEST_ASSERT_MSG_EQ (decoded.GetIdentifier (), 7, "wrong identifier");
+  }
+}
+
+/**
+ * \brief Expiration, ordering, cancellation and cascading of the timer wheel.
+ */
+class EslrTimerWheelTestCase : public TestCase
+{
+public:
+  EslrTimerWheelTestCase ();
+  virtual ~EslrTimerWheelTestCase ();
+
+private:
+  virtual void DoRun (void);
 
-// This is an example TestCase.
-class EslrTestCase1 : public TestCase
+  /**
+   * \brief Schedule a timer and remember its requested expiration.
+   * \param id the identifier of the timer
+   * \param delay the delay of the timer
+   * \returns the timer
+   */
+  TimerId Add (uint32_t id, Time delay);
+
+  /**
+   * \brief Record the expiration of a timer.
+   * \param id the identifier of the timer
+   */
+  void Expire (uint32_t id);
+
+  /**
+   * \brief Schedule a timer from the callback of another timer.
+   * \param id the identifier of the new timer
+   * \param delay the delay of the new timer
+   */
+  void Reschedule (uint32_t id, Time delay);
+
+  TimerWheel m_wheel; //!< the wheel under test
+  std::map<uint32_t, Time> m_expirations; //!< the requested expiration of each timer
+  std::map<uint32_t, Time> m_expired; //!< the time each timer expired at
+  std::vector<uint32_t> m_order; //!< the timers, in the order they expired
+};
+
+EslrTimerWheelTestCase::EslrTimerWheelTestCase ()
+  : TestCase ("ESLR timer wheel")
+{
+  /*cstrctr*/
+}
+
+EslrTimerWheelTestCase::~EslrTimerWheelTestCase ()
+{
+  /*dstrctr*/
+}
+
+TimerId
+EslrTimerWheelTestCase::Add (uint32_t id, Time delay)
+{
+  m_expirations[id] = Simulator::Now () + delay;
+  return m_wheel.Schedule (delay, &EslrTimerWheelTestCase::Expire, this, id);
+}
+
+void
+EslrTimerWheelTestCase::Expire (uint32_t id)
+{
+  m_expired[id] = Simulator::Now ();
+  m_order.push_back (id);
+}
+
+void
+EslrTimerWheelTestCase::Reschedule (uint32_t id, Time delay)
+{
+  Add (id, delay);
+}
+
+void
+EslrTimerWheelTestCase::DoRun (void)
+{
+  Time resolution = MilliSeconds (1);
+  m_wheel.SetResolution (resolution);
+
+  // on a tick, and between two ticks
+  Add (1, MilliSeconds (1));
+  Add (2, MicroSeconds (2500));
+
+  // the same tick, in order of the expiration times, then in scheduling order
+  Add (3, MicroSeconds (10700));
+  Add (4, MicroSeconds (10200));
+  Add (5, MicroSeconds (10200));
+
+  TimerId canceled = Add (6, MilliSeconds (5));
+  canceled.Cancel ();
+  m_expirations.erase (6);
+  NS_TEST_ASSERT_MSG_EQ (canceled.IsExpired (), true, "the canceled timer is still pending");
+  NS_TEST_ASSERT_MSG_EQ (m_wheel.GetNTimers (), uint32_t (5), "the canceled timer is still counted");
+
+  // scheduled from a callback, before the tick the wheel waits for then
+  m_wheel.Schedule (MilliSeconds (20), &EslrTimerWheelTestCase::Reschedule, this, 7, MicroSeconds (1500));
+  Add (8, MilliSeconds (100));
+
+  // cascaded from the second and from the third level (beyond 256 and 16384 ticks)
+  Add (9, MicroSeconds (300700));
+  Add (10, MicroSeconds (70000300));
+
+  // beyond the 2^26 ticks the wheel covers, waits in the last level
+  Add (11, MilliSeconds (uint64_t (1) << 26) + MicroSeconds (2300));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_wheel.GetNTimers (), uint32_t (0), "timers are left in the wheel");
+  NS_TEST_ASSERT_MSG_EQ (m_expired.size (), m_expirations.size (), "wrong number of expired timers");
+  for (std::map<uint32_t, Time>::const_iterator it = m_expirations.begin (); it != m_expirations.end (); it++)
+  {
+    NS_TEST_ASSERT_MSG_EQ ((m_expired.find (it->first) != m_expired.end ()), true, "timer " << it->first << " did not expire");
+    Time expired = m_expired[it->first];
+    NS_TEST_ASSERT_MSG_EQ ((expired >= it->second), true, "timer " << it->first << " expired early");
+    NS_TEST_ASSERT_MSG_LT (expired - it->second, resolution, "timer " << it->first << " expired more than a tick late");
+  }
+  NS_TEST_ASSERT_MSG_EQ (m_expired[1], MilliSeconds (1), "a timer on a tick expired late");
+  NS_TEST_ASSERT_MSG_EQ (m_expired[2], MilliSeconds (3), "a timer between two ticks did not expire at the next tick");
+
+  uint32_t order[] = { 1, 2, 4, 5, 3, 7, 8, 9, 10, 11 };
+  NS_TEST_ASSERT_MSG_EQ (m_order.size (), sizeof (order) / sizeof (order[0]), "wrong number of expirations");
+  for (uint32_t i = 0; i < m_order.size (); i++)
+  {
+    NS_TEST_ASSERT_MSG_EQ (m_order[i], order[i], "wrong expiration order at " << i);
+  }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \brief Lookups of the DIR-24-8 direct index against the prefix trie,
+ * while overlapping prefixes are added and removed.
+ */
+class EslrDirectIndexTestCase : public TestCase
+{
+public:
+  EslrDirectIndexTestCase ();
+  virtual ~EslrDirectIndexTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Add a prefix to both forwarding tables.
+   * \param network the network address
+   * \param length the prefix length
+   * \param gateway the next hop, which identifies the prefix
+   */
+  void AddPrefix (const char *network, uint16_t length, const char *gateway);
+
+  /**
+   * \brief Remove a prefix from both forwarding tables.
+   * \param network the network address
+   * \param length the prefix length
+   */
+  void RemovePrefix (const char *network, uint16_t length);
+
+  /**
+   * \brief Check that both forwarding tables select the same entries, and the expected ones.
+   * \param expected the expected next hop of each probe address (0 if no entry matches)
+   */
+  void CheckLookups (const char * const *expected);
+
+  ForwardingTable m_direct; //!< the forwarding table looked up through the direct index
+  ForwardingTable m_trie; //!< the forwarding table looked up through the trie
+};
+
+/// The addresses looked up, around the borders of the prefixes of the test
+static const char * const DIRECT_INDEX_PROBES[] = {
+  "9.255.255.255", "10.0.0.0", "10.1.1.255", "10.1.2.0", "10.1.2.127", "10.1.2.128", 
+  "10.1.2.129", "10.1.2.130", "10.1.2.131", "10.1.2.255", "10.1.3.0", "10.255.255.255", "11.0.0.0"
+};
+
+/// Number of the probe addresses
+static const uint32_t N_DIRECT_INDEX_PROBES = sizeof (DIRECT_INDEX_PROBES) / sizeof (DIRECT_INDEX_PROBES[0]);
+
+EslrDirectIndexTestCase::EslrDirectIndexTestCase ()
+  : TestCase ("ESLR DIR-24-8 direct index against the prefix trie")
+{
+  /*cstrctr*/
+}
+
+EslrDirectIndexTestCase::~EslrDirectIndexTestCase ()
+{
+  /*dstrctr*/
+}
+
+void
+EslrDirectIndexTestCase::AddPrefix (const char *network, uint16_t length, const char *gateway)
+{
+  Ipv4Mask mask (length == 0 ? 0 : (0xffffffff << (32 - length)));
+  m_direct.AddEntry (Ipv4Address (network), mask, Ipv4Address (gateway), 1, 1);
+  m_trie.AddEntry (Ipv4Address (network), mask, Ipv4Address (gateway), 1, 1);
+}
+
+void
+EslrDirectIndexTestCase::RemovePrefix (const char *network, uint16_t length)
+{
+  Ipv4Mask mask (length == 0 ? 0 : (0xffffffff << (32 - length)));
+  m_direct.RemoveEntries (Ipv4Address (network), mask);
+  m_trie.RemoveEntries (Ipv4Address (network), mask);
+}
+
+void
+EslrDirectIndexTestCase::CheckLookups (const char * const *expected)
+{
+  for (uint32_t i = 0; i < N_DIRECT_INDEX_PROBES; i++)
+  {
+    Ipv4Address destination (DIRECT_INDEX_PROBES[i]);
+    const ForwardingEntry *direct = m_direct.Lookup (destination, 0);
+    const ForwardingEntry *trie = m_trie.Lookup (destination, 0);
+
+    NS_TEST_ASSERT_MSG_EQ ((direct != 0), (trie != 0), "the direct index and the trie disagree on " << destination);
+    NS_TEST_ASSERT_MSG_EQ ((trie != 0), (expected[i] != 0), "wrong match of " << destination);
+    if (trie == 0)
+      continue;
+    NS_TEST_ASSERT_MSG_EQ (direct->gateway, trie->gateway, "the direct index and the trie disagree on " << destination);
+    NS_TEST_ASSERT_MSG_EQ (trie->gateway, Ipv4Address (expected[i]), "wrong match of " << destination);
+  }
+}
+
+void
+EslrDirectIndexTestCase::DoRun (void)
+{
+  m_direct.EnableDirectIndex (true);
+  NS_TEST_ASSERT_MSG_EQ (m_direct.IsDirectIndexEnabled (), true, "the direct index is not enabled");
+
+  // the longer prefixes first, so that the shorter ones have to leave their slots alone
+  AddPrefix ("10.1.2.130", 32, "192.168.0.32");
+  AddPrefix ("10.1.2.128", 25, "192.168.0.25");
+  AddPrefix ("10.1.2.0", 24, "192.168.0.24");
+  AddPrefix ("10.0.0.0", 8, "192.168.0.8");
+  {
+    const char * const expected[] = {
+      0, "192.168.0.8", "192.168.0.8", "192.168.0.24", "192.168.0.24", "192.168.0.25", 
+      "192.168.0.25", "192.168.0.32", "192.168.0.25", "192.168.0.25", "192.168.0.8", "192.168.0.8", 0
+    };
+    CheckLookups (expected);
+  }
+
+  // the /24 takes the slots of the /25 back, the /32 keeps its own
+  RemovePrefix ("10.1.2.128", 25);
+  {
+    const char * const expected[] = {
+      0, "192.168.0.8", "192.168.0.8", "192.168.0.24", "192.168.0.24", "192.168.0.24", 
+      "192.168.0.24", "192.168.0.32", "192.168.0.24", "192.168.0.24", "192.168.0.8", "192.168.0.8", 0
+    };
+    CheckLookups (expected);
+  }
+
+  // the /8 covers the /24, the /32 is left in a second level group
+  RemovePrefix ("10.1.2.0", 24);
+  {
+    const char * const expected[] = {
+      0, "192.168.0.8", "192.168.0.8", "192.168.0.8", "192.168.0.8", "192.168.0.8", 
+      "192.168.0.8", "192.168.0.32", "192.168.0.8", "192.168.0.8", "192.168.0.8", "192.168.0.8", 0
+    };
+    CheckLookups (expected);
+  }
+
+  // a /25 added under an existing /32, then the /32 is removed
+  AddPrefix ("10.1.2.128", 25, "192.168.0.25");
+  RemovePrefix ("10.1.2.130", 32);
+  {
+    const char * const expected[] = {
+      0, "192.168.0.8", "192.168.0.8", "192.168.0.8", "192.168.0.8", "192.168.0.25", 
+      "192.168.0.25", "192.168.0.25", "192.168.0.25", "192.168.0.25", "192.168.0.8", "192.168.0.8", 0
+    };
+    CheckLookups (expected);
+  }
+
+  // without a covering prefix, only the /25 is left
+  RemovePrefix ("10.0.0.0", 8);
+  {
+    const char * const expected[] = {
+      0, 0, 0, 0, 0, "192.168.0.25", 
+      "192.168.0.25", "192.168.0.25", "192.168.0.25", "192.168.0.25", 0, 0, 0
+    };
+    CheckLookups (expected);
+  }
+
+  RemovePrefix ("10.1.2.128", 25);
+  NS_TEST_ASSERT_MSG_EQ (m_direct.GetNEntries (), uint32_t (0), "entries are left in the forwarding table");
+  {
+    const char * const expected[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    CheckLookups (expected);
+  }
+
+  m_direct.Clear ();
+  m_trie.Clear ();
+}
+
+/**
+ * \brief Predicate of the prefix trie test, accepting all values but one.
+ */
+struct PrefixTrieSelector
+{
+  PrefixTrieSelector (uint32_t rejected) : m_rejected (rejected)
+  {
+    /*cstrctr*/
+  }
+
+  bool operator() (const uint32_t &value) const
+  {
+    return (value != m_rejected);
+  }
+
+  uint32_t m_rejected; //!< the value that is not accepted
+};
+
+/**
+ * \brief Longest prefix match of the prefix trie.
+ */
+class EslrPrefixTrieTestCase : public TestCase
 {
 public:
-  EslrTestCase1 ();
-  virtual ~EslrTestCase1 ();
+  EslrPrefixTrieTestCase ();
+  virtual ~EslrPrefixTrieTestCase ();
 
 private:
   virtual void DoRun (void);
+
+  /**
+   * \brief Look up an address and check the selected value.
+   * \param destination the address
+   * \param found true if a prefix is expected to match
+   * \param value the expected value
+   * \param rejected the value the lookup does not accept
+   */
+  void CheckMatch (const char *destination, bool found, uint32_t value, uint32_t rejected = 0xffffffff);
+
+  PrefixTrie<uint32_t> m_trie; //!< the trie under test, the values are the prefix lengths
 };
 
-// Add some help text to this case to describe what it is intended to test
-EslrTestCase1::EslrTestCase1 ()
-  : TestCase ("Eslr test case (does nothing)")
+EslrPrefixTrieTestCase::EslrPrefixTrieTestCase ()
+  : TestCase ("ESLR prefix trie longest prefix match")
+{
+  /*cstrctr*/
+}
+
+EslrPrefixTrieTestCase::~EslrPrefixTrieTestCase ()
 {
+  /*dstrctr*/
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-EslrTestCase1::~EslrTestCase1 ()
+void
+EslrPrefixTrieTestCase::CheckMatch (const char *destination, bool found, uint32_t value, uint32_t rejected)
 {
+  uint32_t match = 0xffffffff;
+  bool matched = m_trie.LongestMatch (Ipv4Address (destination), PrefixTrieSelector (rejected), match);
+  NS_TEST_ASSERT_MSG_EQ (matched, found, "wrong match of " << destination);
+  if (found)
+    NS_TEST_ASSERT_MSG_EQ (match, value, "wrong prefix selected for " << destination);
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-EslrTestCase1::DoRun (void)
+EslrPrefixTrieTestCase::DoRun (void)
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+  // nested prefixes and a host route
+  m_trie.Insert (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"), 8, false);
+  m_trie.Insert (Ipv4Address ("10.1.0.0"), Ipv4Mask ("255.255.0.0"), 16, false);
+  m_trie.Insert (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), 24, false);
+  m_trie.Insert (Ipv4Address ("10.1.2.3"), Ipv4Mask ("255.255.255.255"), 32, false);
+  NS_TEST_ASSERT_MSG_EQ (m_trie.GetNValues (), uint32_t (4), "wrong number of values");
+
+  CheckMatch ("10.1.2.3", true, 32);
+  CheckMatch ("10.1.2.4", true, 24);
+  CheckMatch ("10.1.3.1", true, 16);
+  CheckMatch ("10.2.0.0", true, 8);
+  CheckMatch ("11.0.0.1", false, 0);
+
+  // a value the predicate rejects leaves the shorter prefixes
+  CheckMatch ("10.1.2.3", true, 24, 32);
+
+  // the default route matches what no other prefix does
+  m_trie.Insert (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), 0, false);
+  CheckMatch ("11.0.0.1", true, 0);
+  CheckMatch ("10.1.2.3", true, 32);
+
+  // without the inner prefix, its addresses fall back to the covering one, but not the host route
+  NS_TEST_ASSERT_MSG_EQ (m_trie.Remove (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), 24), true, "the /24 was not removed");
+  NS_TEST_ASSERT_MSG_EQ (m_trie.Remove (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0"), 24), false, "the /24 was removed twice");
+  NS_TEST_ASSERT_MSG_EQ ((m_trie.Find (Ipv4Address ("10.1.2.0"), Ipv4Mask ("255.255.255.0")) == 0), true, "the /24 is still found");
+  CheckMatch ("10.1.2.4", true, 16);
+  CheckMatch ("10.1.2.3", true, 32);
+
+  // the miss again, without the default route
+  NS_TEST_ASSERT_MSG_EQ (m_trie.Remove (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), 0), true, "the default route was not removed");
+  CheckMatch ("11.0.0.1", false, 0);
+  NS_TEST_ASSERT_MSG_EQ (m_trie.GetNValues (), uint32_t (3), "wrong number of values");
+
+  m_trie.Clear ();
+  CheckMatch ("10.1.2.3", false, 0);
 }
 
-// The TestSuite class names the TestSuite, identifies what type of TestSuite,
-// and enables the TestCases to be run.  Typically, only the constructor for
-// this class must be defined
-//
+/**
+ * \brief The ESLR unit tests.
+ */
 class EslrTestSuite : public TestSuite
 {
 public:
@@ -59,10 +762,12 @@ public:
 EslrTestSuite::EslrTestSuite ()
   : TestSuite ("eslr", UNIT)
 {
-  // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
-  AddTestCase (new EslrTestCase1, TestCase::QUICK);
+  AddTestCase (new EslrCompactRumTestCase, TestCase::QUICK);
+  AddTestCase (new EslrRouteUpdateHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new EslrKamCapabilityTestCase, TestCase::QUICK);
+  AddTestCase (new EslrTimerWheelTestCase, TestCase::QUICK);
+  AddTestCase (new EslrDirectIndexTestCase, TestCase::QUICK);
+  AddTestCase (new EslrPrefixTrieTestCase, TestCase::QUICK);
 }
 
-// Do not forget to allocate an instance of this TestSuite
-static EslrTestSuite eslrTestSuite;
-
+static EslrTestSuite eslrTestSuite; //!< the test suite instance